@@ -0,0 +1,1163 @@
+/** \file Benchmarks for the intexer load and lookup paths
+
+    Build:  g++ -O2 -o bench better-intexer-bench.cpp -lbenchmark -pthread
+    Run:    ./bench --benchmark_format=json > results.json
+
+    Databases go from 31 records (data.txt) up to INTEXER_BENCH_MAX records, 2^20 by
+    default and 100M at most. They are generated by siggen_write() with its defaults
+    once into INTEXER_BENCH_DIR, the current directory by default, and reused by later
+    runs.
+*/
+
+#include <benchmark/benchmark.h>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C"
+{
+#define TEST
+#include "better-intexer.c"
+#include "intexer-gen.c"
+}
+
+#include "intexer-sigdb.hpp"
+
+static const size_t bench_sizes[] = { 31, 1 << 10, 1 << 14, 1 << 17, 1 << 20, 1 << 23, 100000000 };
+
+static size_t bench_max( void )
+{
+	const char *env = getenv("INTEXER_BENCH_MAX");
+	return env ? strtoul(env, NULL, 10) : 1 << 20;
+}
+
+/** \brief The database of \p count records, written on first use. 31 records is data.txt. */
+static std::string bench_db( size_t count )
+{
+	const char *dir = getenv("INTEXER_BENCH_DIR");
+	std::string path = std::string(dir ? dir : ".") + "/bench-" + std::to_string(count) + ".db";
+	struct siggen_opts opts;
+	struct stat st;
+	int fd;
+
+	if( count == 31 && stat("data.txt", &st) == 0 ) return "data.txt";
+	if( stat(path.c_str(), &st) == 0 ) return path;
+
+	siggen_defaults(&opts);
+	opts.count = count;
+	fd = open((path + ".tmp").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if( fd < 0 ) return "";
+	if( siggen_write(fd, &opts, NULL) != 0 || close(fd) != 0
+		|| rename((path + ".tmp").c_str(), path.c_str()) != 0 )
+	{
+		return "";
+	}
+	return path;
+}
+
+/** \brief An open and indexed table per size, kept for the lookup benchmarks. */
+static struct sigtable *bench_table( size_t count )
+{
+	static std::map<size_t, struct sigtable *> tables;
+	struct sigtable *&tab = tables[count];
+
+	if( tab == NULL )
+	{
+		tab = sigtable_open(bench_db(count).c_str());
+		if( tab != NULL && sigtable_index(tab) != 0 )
+		{
+			sigtable_close(tab);
+			tab = NULL;
+		}
+	}
+	return tab;
+}
+
+static void size_args( benchmark::internal::Benchmark *b )
+{
+	for( size_t size : bench_sizes )
+	{
+		if( size <= bench_max() ) b->Arg((int64_t)size);
+	}
+}
+
+static void file_throughput( benchmark::State &state, const std::string &path )
+{
+	struct stat st;
+
+	if( stat(path.c_str(), &st) == 0 ) state.SetBytesProcessed((int64_t)state.iterations() * st.st_size);
+	state.SetItemsProcessed((int64_t)state.iterations() * state.range(0));
+}
+
+static void BM_datafile_open( benchmark::State &state )
+{
+	std::string path = bench_db(31);
+
+	for( auto _ : state )
+	{
+		FILE *fh = datafile_open(path.c_str());
+
+		if( fh == NULL ) state.SkipWithError("cannot open");
+		else fclose(fh);
+	}
+}
+
+BENCHMARK(BM_datafile_open);
+
+static void BM_checked_fgets( benchmark::State &state )
+{
+	std::string path = bench_db(31);
+	FILE *fh = datafile_open(path.c_str());
+	struct sigrecord rec;
+	size_t size;
+	long first;
+
+	if( fh == NULL || !read_size(fh, &size) )
+	{
+		state.SkipWithError("cannot open");
+		if( fh ) fclose(fh);
+		return;
+	}
+
+	first = ftell(fh);
+	for( auto _ : state )
+	{
+		if( checked_fgets(&rec, fh) == NULL )
+		{
+			state.PauseTiming();
+			fseek(fh, first, SEEK_SET);
+			state.ResumeTiming();
+		}
+		benchmark::DoNotOptimize(rec);
+	}
+	state.SetItemsProcessed((int64_t)state.iterations());
+	fclose(fh);
+}
+
+BENCHMARK(BM_checked_fgets);
+
+static void BM_read_records( benchmark::State &state )
+{
+	std::string path = bench_db((size_t)state.range(0));
+
+	for( auto _ : state )
+	{
+		FILE *fh = datafile_open(path.c_str());
+		size_t size;
+		struct sigrecord *recs = fh ? read_records(fh, &size) : NULL;
+
+		if( recs == NULL ) state.SkipWithError("cannot read");
+		free(recs);
+		if( fh ) fclose(fh);
+	}
+	file_throughput(state, path);
+}
+
+BENCHMARK(BM_read_records)->Apply(size_args)->Unit(benchmark::kMillisecond);
+
+static void BM_sigtable_open( benchmark::State &state )
+{
+	std::string path = bench_db((size_t)state.range(0));
+
+	for( auto _ : state )
+	{
+		struct sigtable *tab = sigtable_open(path.c_str());
+
+		if( tab == NULL ) state.SkipWithError("cannot open");
+		sigtable_close(tab);
+	}
+	file_throughput(state, path);
+}
+
+BENCHMARK(BM_sigtable_open)->Apply(size_args)->Unit(benchmark::kMillisecond);
+
+/** \brief A pattern matching \p count records split into \p shards files, written on first use. */
+static std::string bench_shards( size_t count, size_t shards )
+{
+	const char *dir = getenv("INTEXER_BENCH_DIR");
+	std::string prefix = std::string(dir ? dir : ".") + "/bench-" + std::to_string(count) + "-of-" + std::to_string(shards);
+	struct siggen_opts opts;
+	struct stat st;
+
+	for( size_t i = 0; i < shards; i++ )
+	{
+		std::string path = prefix + "-" + std::to_string(i) + ".db";
+		int fd;
+
+		if( stat(path.c_str(), &st) == 0 ) continue;
+		siggen_defaults(&opts);
+		opts.count = count / shards;
+		opts.seed = i + 1;
+		fd = open((path + ".tmp").c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+		if( fd < 0 ) return "";
+		if( siggen_write(fd, &opts, NULL) != 0 || close(fd) != 0
+			|| rename((path + ".tmp").c_str(), path.c_str()) != 0 )
+		{
+			return "";
+		}
+	}
+	return prefix + "-*.db";
+}
+
+/** \brief Loads range(0) records split into range(1) shards, which are parsed in parallel. */
+static void BM_sigtable_open_shards( benchmark::State &state )
+{
+	std::string pattern = bench_shards((size_t)state.range(0), (size_t)state.range(1));
+	struct stat st;
+	int64_t bytes = 0;
+
+	for( auto _ : state )
+	{
+		struct sigtable *tab = sigtable_open(pattern.c_str());
+
+		if( tab == NULL ) state.SkipWithError("cannot open");
+		sigtable_close(tab);
+	}
+
+	for( int64_t i = 0; i < state.range(1); i++ )
+	{
+		std::string path = pattern.substr(0, pattern.size() - 4) + std::to_string(i) + ".db";
+		if( stat(path.c_str(), &st) == 0 ) bytes += st.st_size;
+	}
+	state.SetBytesProcessed((int64_t)state.iterations() * bytes);
+	state.SetItemsProcessed((int64_t)state.iterations() * state.range(0));
+}
+
+static void shard_args( benchmark::internal::Benchmark *b )
+{
+	for( size_t size : bench_sizes )
+	{
+		if( size < (1 << 14) || size > bench_max() ) continue;
+		for( int64_t shards : { 1, 4, 16 } ) b->Args({ (int64_t)size, shards });
+	}
+}
+
+BENCHMARK(BM_sigtable_open_shards)->Apply(shard_args)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/** \brief How BM_load_cold() loads its shards. */
+enum cold_load {
+	COLD_STDIO,
+	COLD_MAP,
+	COLD_URING,
+	COLD_PREAD
+};
+
+/** \brief Evicts \p path from the page cache, false if it cannot. */
+static bool drop_cache( const std::string &path )
+{
+	int fd = open(path.c_str(), O_RDONLY);
+	bool ok = fd >= 0 && posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED) == 0;
+
+	if( fd >= 0 ) close(fd);
+	return ok;
+}
+
+/** \brief Loads range(0) records in 16 shards that are evicted from the page cache first.
+
+    COLD_STDIO reads the shards one after the other with datafile_open() and
+    read_records(), the other ways load them as one table with sigtable_open() or
+    sigtable_load().
+*/
+static void BM_load_cold( benchmark::State &state, enum cold_load how )
+{
+	const size_t shards = 16;
+	std::string pattern = bench_shards((size_t)state.range(0), shards);
+	std::vector<std::string> paths;
+	struct stat st;
+	int64_t bytes = 0;
+
+	for( size_t i = 0; i < shards; i++ )
+	{
+		paths.push_back(pattern.substr(0, pattern.size() - 4) + std::to_string(i) + ".db");
+		if( stat(paths.back().c_str(), &st) == 0 ) bytes += st.st_size;
+	}
+
+	sigio_backend = how == COLD_PREAD ? SIGIO_PREAD : SIGIO_URING;
+	for( auto _ : state )
+	{
+		state.PauseTiming();
+		for( const std::string &path : paths )
+		{
+			if( !drop_cache(path) ) state.SkipWithError("cannot drop the page cache");
+		}
+		state.ResumeTiming();
+
+		if( how == COLD_STDIO )
+		{
+			for( const std::string &path : paths )
+			{
+				FILE *fh = datafile_open(path.c_str());
+				size_t size;
+				struct sigrecord *recs = fh ? read_records(fh, &size) : NULL;
+
+				if( recs == NULL ) state.SkipWithError("cannot read");
+				free(recs);
+				if( fh ) fclose(fh);
+			}
+		}
+		else
+		{
+			struct sigtable *tab = how == COLD_MAP ? sigtable_open(pattern.c_str()) : sigtable_load(pattern.c_str());
+
+			if( tab == NULL ) state.SkipWithError("cannot load");
+			sigtable_close(tab);
+		}
+	}
+	sigio_backend = SIGIO_AUTO;
+
+	state.SetBytesProcessed((int64_t)state.iterations() * bytes);
+	state.SetItemsProcessed((int64_t)state.iterations() * state.range(0));
+}
+
+static void cold_args( benchmark::internal::Benchmark *b )
+{
+	for( size_t size : bench_sizes )
+	{
+		if( size >= (1 << 17) && size <= bench_max() ) b->Arg((int64_t)size);
+	}
+}
+
+BENCHMARK_CAPTURE(BM_load_cold, stdio, COLD_STDIO)->Apply(cold_args)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_load_cold, map, COLD_MAP)->Apply(cold_args)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_load_cold, uring, COLD_URING)->Apply(cold_args)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_load_cold, pread, COLD_PREAD)->Apply(cold_args)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+/** \brief What a server does on every reload: load a private copy, build all indexes and
+    release the generation before, with the region backed as \p flags say.
+*/
+static void BM_reload( benchmark::State &state, unsigned flags )
+{
+	std::string path = bench_db((size_t)state.range(0));
+	struct sigtable *old = NULL;
+
+	sigregion_flags = flags;
+	for( auto _ : state )
+	{
+		struct sigtable *tab = sigtable_load(path.c_str());
+
+		if( tab == NULL || sigtable_index(tab) != 0 ) state.SkipWithError("cannot load");
+		sigtable_close(old);
+		old = tab;
+	}
+	sigtable_close(old);
+	sigregion_flags = SIGREGION_THP;
+	file_throughput(state, path);
+}
+
+BENCHMARK_CAPTURE(BM_reload, base_pages, 0u)->Apply(size_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_reload, thp, SIGREGION_THP)->Apply(size_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_reload, hugetlb, SIGREGION_HUGETLB)->Apply(size_args)->Unit(benchmark::kMillisecond);
+
+static void BM_map_records_parallel( benchmark::State &state )
+{
+	struct sigtable *tab = bench_table((size_t)state.range(0));
+	unsigned threads = (unsigned)state.range(1);
+
+	if( tab == NULL )
+	{
+		state.SkipWithError("cannot open");
+		return;
+	}
+
+	for( auto _ : state )
+	{
+		size_t size;
+		struct sighot *hot = map_records_parallel(tab->arena, tab->arena_len, &size, threads);
+
+		if( hot == NULL ) state.SkipWithError("parse failed");
+		benchmark::DoNotOptimize(hot);
+		free(hot);
+	}
+
+	state.SetBytesProcessed((int64_t)(state.iterations() * tab->arena_len));
+	state.SetItemsProcessed((int64_t)state.iterations() * state.range(0));
+}
+
+static void parallel_args( benchmark::internal::Benchmark *b )
+{
+	unsigned cpus = std::thread::hardware_concurrency();
+	size_t size = bench_max() < (1 << 20) ? bench_max() : 1 << 20;
+
+	for( unsigned threads = 1; threads <= (cpus ? cpus : 1); threads *= 2 )
+	{
+		b->Args({(int64_t)size, threads});
+	}
+}
+
+BENCHMARK(BM_map_records_parallel)->Apply(parallel_args)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+static void BM_scan_fields( benchmark::State &state, scan_fields_fn fn )
+{
+	struct sigtable *tab = bench_table(1 << 10);
+	size_t lines = 0;
+
+#ifdef SCAN_FIELDS_X86
+	if( fn == scan_fields_avx2 && !__builtin_cpu_supports("avx2") )
+	{
+		state.SkipWithError("no AVX2");
+		return;
+	}
+#endif
+	if( tab == NULL )
+	{
+		state.SkipWithError("cannot open");
+		return;
+	}
+
+	for( auto _ : state )
+	{
+		const char *pos = tab->arena, *end = pos + tab->arena_len;
+
+		while( pos < end )
+		{
+			const char *sep, *nl;
+
+			fn(pos, (size_t)(end - pos) < SIGLINE_MAX ? (size_t)(end - pos) : SIGLINE_MAX, &sep, &nl);
+			benchmark::DoNotOptimize(sep);
+			pos = nl ? nl + 1 : end;
+			lines++;
+		}
+	}
+
+	state.SetBytesProcessed((int64_t)(state.iterations() * tab->arena_len));
+	state.SetItemsProcessed((int64_t)lines);
+}
+
+BENCHMARK_CAPTURE(BM_scan_fields, scalar, scan_fields_scalar);
+#ifdef SCAN_FIELDS_X86
+BENCHMARK_CAPTURE(BM_scan_fields, sse2, scan_fields_sse2);
+BENCHMARK_CAPTURE(BM_scan_fields, avx2, scan_fields_avx2);
+#endif
+
+static void BM_lookup_index( benchmark::State &state )
+{
+	struct sigtable *tab = bench_table((size_t)state.range(0));
+	unsigned seed = 1;
+
+	if( tab == NULL )
+	{
+		state.SkipWithError("cannot open");
+		return;
+	}
+
+	for( auto _ : state )
+	{
+		struct sigview view;
+
+		benchmark::DoNotOptimize(sigtable_get(tab, (size_t)rand_r(&seed) % tab->size, &view));
+	}
+	state.SetItemsProcessed((int64_t)state.iterations());
+}
+
+BENCHMARK(BM_lookup_index)->Apply(size_args);
+
+/** \brief The table of \p count records, compressed by sigtable_pack() if \p packed. */
+static struct sigtable *pack_table( size_t count, bool packed )
+{
+	static std::map<size_t, struct sigtable *> tables;
+	struct sigtable *&tab = tables[count];
+
+	if( !packed ) return bench_table(count);
+	if( tab == NULL )
+	{
+		tab = sigtable_open(bench_db(count).c_str());
+		if( tab != NULL && sigtable_pack(tab) != 0 )
+		{
+			sigtable_close(tab);
+			tab = NULL;
+		}
+	}
+	return tab;
+}
+
+/** \brief Random lookups that read every byte of the strings, and the bytes stored per record. */
+static void BM_get( benchmark::State &state, bool packed )
+{
+	struct sigtable *tab = pack_table((size_t)state.range(0), packed);
+	unsigned seed = 1;
+
+	if( tab == NULL )
+	{
+		state.SkipWithError("cannot open");
+		return;
+	}
+
+	for( auto _ : state )
+	{
+		struct sigview view;
+		unsigned sum = 0;
+
+		if( sigtable_get(tab, (size_t)rand_r(&seed) % tab->size, &view) == NULL )
+		{
+			state.SkipWithError("cannot get");
+			break;
+		}
+		for( unsigned i = 0; i < view.name_len; i++ ) sum += (unsigned char)view.name[i];
+		for( unsigned i = 0; i < view.desc_len; i++ ) sum += (unsigned char)view.desc[i];
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed((int64_t)state.iterations());
+	state.counters["string_bytes"] = (double)tab->arena_len / (double)tab->size;
+}
+
+BENCHMARK_CAPTURE(BM_get, plain, false)->Apply(size_args);
+BENCHMARK_CAPTURE(BM_get, packed, true)->Apply(size_args);
+
+#define GET_BATCH 4096
+
+/* Renders \p rec as its answer line and adds up the line length and its last byte */
+static unsigned view_sum( const struct sigview *rec )
+{
+	char line[RENDER_MAX];
+	size_t len = render_record(rec, line);
+
+	return (unsigned)len + (unsigned char)line[len - 2];
+}
+
+static int sum_batch( void *arg, size_t, const struct sigview *rec )
+{
+	if( rec == NULL ) return -1;
+	*(unsigned *)arg += view_sum(rec);
+	return 0;
+}
+
+/** \brief GET_BATCH random lookups, each rendered as an answer, one sigtable_get() after the
+    other or all at once with sigtable_get_batch(), which prefetches ahead. Both must add up the same.
+*/
+static void BM_get_batch( benchmark::State &state, bool batched, bool packed )
+{
+	struct sigtable *tab = pack_table((size_t)state.range(0), packed);
+	std::vector<size_t> idx(GET_BATCH);
+	unsigned seed = 1, expected = 0;
+	struct sigview view;
+
+	if( tab == NULL )
+	{
+		state.SkipWithError("cannot open");
+		return;
+	}
+	for( size_t &rec : idx ) rec = (size_t)rand_r(&seed) % tab->size;
+	for( size_t rec : idx ) expected += view_sum(sigtable_get(tab, rec, &view));
+
+	for( auto _ : state )
+	{
+		unsigned sum = 0;
+
+		if( batched )
+		{
+			if( sigtable_get_batch(tab, idx.data(), idx.size(), sum_batch, &sum) < 0 ) sum = ~expected;
+		}
+		else
+		{
+			for( size_t rec : idx )
+			{
+				if( sigtable_get(tab, rec, &view) == NULL ) break;
+				sum += view_sum(&view);
+			}
+		}
+		if( sum != expected )
+		{
+			state.SkipWithError("different records");
+			break;
+		}
+		benchmark::DoNotOptimize(sum);
+	}
+	state.SetItemsProcessed((int64_t)state.iterations() * GET_BATCH);
+}
+
+BENCHMARK_CAPTURE(BM_get_batch, one_at_a_time, false, false)->Apply(size_args);
+BENCHMARK_CAPTURE(BM_get_batch, prefetched, true, false)->Apply(size_args);
+BENCHMARK_CAPTURE(BM_get_batch, packed_one_at_a_time, false, true)->Apply(size_args);
+BENCHMARK_CAPTURE(BM_get_batch, packed_prefetched, true, true)->Apply(size_args);
+
+/** \brief Random lookups in a table paged within a budget of 1/range(1) of its file. */
+static void BM_lookup_bounded( benchmark::State &state )
+{
+	std::string path = bench_db((size_t)state.range(0));
+	struct stat st;
+	struct sigtable *tab;
+	unsigned seed = 1;
+
+	if( stat(path.c_str(), &st) != 0
+		|| (tab = sigtable_open_bounded(path.c_str(), (size_t)st.st_size / (size_t)state.range(1))) == NULL )
+	{
+		state.SkipWithError("cannot open");
+		return;
+	}
+
+	for( auto _ : state )
+	{
+		struct sigview view;
+
+		benchmark::DoNotOptimize(sigtable_get(tab, (size_t)rand_r(&seed) % tab->size, &view));
+	}
+	state.SetItemsProcessed((int64_t)state.iterations());
+	state.counters["hit_rate"] = (double)tab->pager->hits / (double)(tab->pager->hits + tab->pager->misses);
+	state.counters["resident"] = (double)tab->pager->resident;
+	sigtable_close(tab);
+}
+
+static void bounded_args( benchmark::internal::Benchmark *b )
+{
+	for( size_t size : bench_sizes )
+	{
+		if( size > 31 && size <= bench_max() )
+		{
+			for( int64_t fraction : { 1, 8, 64 } ) b->Args({(int64_t)size, fraction});
+		}
+	}
+}
+
+BENCHMARK(BM_lookup_bounded)->Apply(bounded_args);
+
+static void BM_lookup_name( benchmark::State &state )
+{
+	struct sigtable *tab = bench_table((size_t)state.range(0));
+	std::vector<std::string> names;
+	size_t i = 0;
+
+	if( tab == NULL )
+	{
+		state.SkipWithError("cannot open");
+		return;
+	}
+
+	for( unsigned seed = 1; names.size() < 1024; )
+	{
+		struct sigview view;
+
+		if( sigtable_get(tab, (size_t)rand_r(&seed) % tab->size, &view) ) names.emplace_back(view.name, view.name_len);
+	}
+
+	for( auto _ : state )
+	{
+		const std::string &name = names[i++ % names.size()];
+		const uint32_t *recs;
+
+		benchmark::DoNotOptimize(sigtable_find_name(tab, name.data(), name.size(), &recs));
+	}
+	state.SetItemsProcessed((int64_t)state.iterations());
+}
+
+BENCHMARK(BM_lookup_name)->Apply(size_args);
+
+static int count_match( void *arg, size_t rec )
+{
+	(void)rec;
+	(*(size_t *)arg)++;
+	return 0;
+}
+
+/** \brief Phrase searches for two neighbouring words of random descriptions. */
+static void BM_search( benchmark::State &state )
+{
+	struct sigtable *tab = bench_table((size_t)state.range(0));
+	std::vector<std::string> queries;
+	size_t i = 0, matches = 0;
+
+	if( tab == NULL )
+	{
+		state.SkipWithError("cannot open");
+		return;
+	}
+
+	for( unsigned seed = 1; queries.size() < 1024; )
+	{
+		struct sigview view;
+		size_t pos = 0, start, wlen;
+
+		if( sigtable_get(tab, (size_t)rand_r(&seed) % tab->size, &view) == NULL ) continue;
+		if( (wlen = next_word(view.desc, view.desc_len, &pos)) == 0 ) continue;
+		start = pos;
+		pos += wlen;
+		if( (wlen = next_word(view.desc, view.desc_len, &pos)) == 0 ) continue;
+		queries.push_back("\"" + std::string(view.desc + start, pos + wlen - start) + "\"");
+	}
+
+	for( auto _ : state )
+	{
+		const std::string &query = queries[i++ % queries.size()];
+
+		sigtable_search(tab, query.data(), query.size(), count_match, &matches);
+	}
+	state.SetItemsProcessed((int64_t)state.iterations());
+	state.counters["matches"] = benchmark::Counter((double)matches, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_search)->Apply(size_args);
+
+/* Random signal numbers for the BM_signum benchmarks, drawn once */
+static const std::vector<unsigned> &signum_queries( void )
+{
+	static std::vector<unsigned> queries;
+	unsigned seed = 1;
+
+	while( queries.size() < 4096 ) queries.push_back((unsigned)rand_r(&seed) % 65536);
+	return queries;
+}
+
+/** \brief Lower bound of a signal number in the Eytzinger layout of sigtable_index_signums(). */
+static void BM_signum_eytzinger( benchmark::State &state )
+{
+	struct sigtable *tab = bench_table((size_t)state.range(0));
+	const std::vector<unsigned> &queries = signum_queries();
+	size_t i = 0;
+
+	if( tab == NULL )
+	{
+		state.SkipWithError("cannot open");
+		return;
+	}
+
+	for( auto _ : state )
+	{
+		benchmark::DoNotOptimize(signum_lower_bound(&tab->nums, queries[i++ % queries.size()]));
+	}
+	state.SetItemsProcessed((int64_t)state.iterations());
+}
+
+BENCHMARK(BM_signum_eytzinger)->Apply(size_args);
+
+/** \brief The same lower bound with std::lower_bound() over the sorted signal numbers. */
+static void BM_signum_lower_bound( benchmark::State &state )
+{
+	struct sigtable *tab = bench_table((size_t)state.range(0));
+	const std::vector<unsigned> &queries = signum_queries();
+	std::vector<uint16_t> sorted;
+	size_t i = 0;
+
+	if( tab == NULL )
+	{
+		state.SkipWithError("cannot open");
+		return;
+	}
+
+	for( size_t k = 0; k < tab->size; k++ ) sorted.push_back(tab->hot[tab->nums.order[k]].signum);
+
+	for( auto _ : state )
+	{
+		uint16_t key = (uint16_t)queries[i++ % queries.size()];
+
+		benchmark::DoNotOptimize(std::lower_bound(sorted.begin(), sorted.end(), key) - sorted.begin());
+	}
+	state.SetItemsProcessed((int64_t)state.iterations());
+}
+
+BENCHMARK(BM_signum_lower_bound)->Apply(size_args);
+
+/** \brief The same lower bound from a dense array with the first rank of every signal number. */
+static void BM_signum_dense( benchmark::State &state )
+{
+	struct sigtable *tab = bench_table((size_t)state.range(0));
+	const std::vector<unsigned> &queries = signum_queries();
+	std::vector<uint32_t> first(65537, 0);
+	size_t i = 0;
+
+	if( tab == NULL )
+	{
+		state.SkipWithError("cannot open");
+		return;
+	}
+
+	for( size_t k = 0; k < tab->size; k++ ) first[tab->hot[k].signum + 1]++;
+	for( size_t k = 1; k < first.size(); k++ ) first[k] += first[k - 1];
+
+	for( auto _ : state )
+	{
+		benchmark::DoNotOptimize(first[queries[i++ % queries.size()]]);
+	}
+	state.SetItemsProcessed((int64_t)state.iterations());
+}
+
+BENCHMARK(BM_signum_dense)->Apply(size_args);
+
+/** \brief Range queries of 32 signal numbers streamed through sigtable_find_signums(). */
+static void BM_signum_range( benchmark::State &state )
+{
+	struct sigtable *tab = bench_table((size_t)state.range(0));
+	const std::vector<unsigned> &queries = signum_queries();
+	size_t i = 0, matches = 0;
+
+	if( tab == NULL )
+	{
+		state.SkipWithError("cannot open");
+		return;
+	}
+
+	for( auto _ : state )
+	{
+		unsigned lo = queries[i++ % queries.size()];
+
+		sigtable_find_signums(tab, lo, lo + 31, count_match, &matches);
+	}
+	state.SetItemsProcessed((int64_t)state.iterations());
+	state.counters["matches"] = benchmark::Counter((double)matches, benchmark::Counter::kAvgIterations);
+}
+
+BENCHMARK(BM_signum_range)->Apply(size_args);
+
+/* Queries per BM_batch iteration */
+#define BATCH_QUERIES 100000
+
+/** \brief run_batch() answering index and name queries into /dev/null, timing each
+    query into sigstats if \p stats, to show what --stats costs.
+*/
+static void BM_batch( benchmark::State &state, bool stats )
+{
+	struct sigtable *tab = bench_table((size_t)state.range(0));
+	FILE *in = tmpfile();
+	int out = open("/dev/null", O_WRONLY);
+	unsigned seed = 1;
+
+	if( tab == NULL || in == NULL || out < 0 )
+	{
+		state.SkipWithError("cannot open");
+		if( in ) fclose(in);
+		if( out >= 0 ) close(out);
+		return;
+	}
+
+	for( int i = 0; i < BATCH_QUERIES; i++ )
+	{
+		struct sigview view;
+		size_t rec = (size_t)rand_r(&seed) % tab->size;
+
+		if( i % 4 == 0 && sigtable_get(tab, rec, &view) ) fprintf(in, "%.*s\n", (int)view.name_len, view.name);
+		else fprintf(in, "%zu\n", rec);
+	}
+	fflush(in);
+
+	sigstats.enabled = stats;
+	for( auto _ : state )
+	{
+		lseek(fileno(in), 0, SEEK_SET);
+		if( run_batch(tab, fileno(in), out) != 0 ) state.SkipWithError("batch failed");
+	}
+	sigstats.enabled = false;
+
+	state.SetItemsProcessed((int64_t)state.iterations() * BATCH_QUERIES);
+	fclose(in);
+	close(out);
+}
+
+BENCHMARK_CAPTURE(BM_batch, plain, false)->Apply(size_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_batch, stats, true)->Apply(size_args)->Unit(benchmark::kMillisecond);
+
+/** \brief The indexed table of \p count records with its answers rendered by sigtable_render() if \p rendered. */
+static struct sigtable *render_table( size_t count, bool rendered )
+{
+	static std::map<size_t, struct sigtable *> tables;
+	struct sigtable *&tab = tables[count];
+
+	if( !rendered ) return bench_table(count);
+	if( tab == NULL )
+	{
+		tab = sigtable_open(bench_db(count).c_str());
+		if( tab != NULL && (sigtable_index(tab) != 0 || sigtable_render(tab) != 0) )
+		{
+			sigtable_close(tab);
+			tab = NULL;
+		}
+	}
+	return tab;
+}
+
+/** \brief run_batch() answering index queries into /dev/null, from pre-rendered lines if
+    \p rendered, for uniform keys or, if \p hot, nine in ten queries on 16 keys. Records
+    are prefetched ahead unless \p prefetch is false, the answers are the same either way.
+*/
+static void BM_answer( benchmark::State &state, bool rendered, bool hot, bool prefetch )
+{
+	struct sigtable *tab = render_table((size_t)state.range(0), rendered);
+	FILE *in = tmpfile();
+	int out = open("/dev/null", O_WRONLY);
+	unsigned seed = 1;
+
+	if( tab == NULL || in == NULL || out < 0 )
+	{
+		state.SkipWithError("cannot open");
+		if( in ) fclose(in);
+		if( out >= 0 ) close(out);
+		return;
+	}
+
+	for( int i = 0; i < BATCH_QUERIES; i++ )
+	{
+		size_t rec = (size_t)rand_r(&seed);
+
+		fprintf(in, "%zu\n", hot && rec % 10 != 0 ? rec / 10 % 16 % tab->size : rec % tab->size);
+	}
+	fflush(in);
+
+	sigprefetch_distance = prefetch ? SIGPREFETCH_DISTANCE : 0;
+	for( auto _ : state )
+	{
+		lseek(fileno(in), 0, SEEK_SET);
+		if( run_batch(tab, fileno(in), out) != 0 ) state.SkipWithError("batch failed");
+	}
+	sigprefetch_distance = SIGPREFETCH_DISTANCE;
+
+	state.SetItemsProcessed((int64_t)state.iterations() * BATCH_QUERIES);
+	fclose(in);
+	close(out);
+}
+
+BENCHMARK_CAPTURE(BM_answer, uniform, false, false, true)->Apply(size_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_answer, uniform_rendered, true, false, true)->Apply(size_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_answer, hot, false, true, true)->Apply(size_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_answer, hot_rendered, true, true, true)->Apply(size_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_answer, uniform_no_prefetch, false, false, false)->Apply(size_args)->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_answer, uniform_rendered_no_prefetch, true, false, false)->Apply(size_args)->Unit(benchmark::kMillisecond);
+
+/** \brief Changing one record: appended to the journal by sigjournal_append(), or by
+    rewriting the whole file, synced and renamed over the old one, as an editor does.
+    Both work on a copy of the database, whose journal is compacted every 1000 appends.
+*/
+static void BM_update( benchmark::State &state, bool journal )
+{
+	std::string db = bench_db((size_t)state.range(0)), copy = db + ".update";
+	struct sigtable *tab = sigtable_load(db.c_str());
+	struct sigchange change;
+	std::vector<char> text;
+	struct stat st;
+	int fd = open(db.c_str(), O_RDONLY), n = 0;
+
+	if( tab == NULL || fd < 0 || fstat(fd, &st) != 0 )
+	{
+		state.SkipWithError("cannot open");
+		sigtable_close(tab);
+		if( fd >= 0 ) close(fd);
+		return;
+	}
+	text.resize((size_t)st.st_size);
+	if( pread(fd, text.data(), text.size(), 0) != (ssize_t)text.size() ) state.SkipWithError("cannot read");
+	close(fd);
+
+	fd = open(copy.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if( fd < 0 || write(fd, text.data(), text.size()) != (ssize_t)text.size() ) state.SkipWithError("cannot copy");
+	if( fd >= 0 ) close(fd);
+	unlink((copy + SIGJOURNAL_SUFFIX).c_str());
+
+	memset(&change, 0, sizeof(change));
+	strcpy(change.rec.signame, "UPD");
+	strcpy(change.rec.sigdesc, "Changed by the benchmark");
+	for( auto _ : state )
+	{
+		change.rec.signum = tab->hot[(size_t)n % tab->size].signum;
+		if( journal )
+		{
+			if( sigjournal_append(copy.c_str(), &change, 1) != 0 ) state.SkipWithError("append failed");
+			if( ++n % 1000 == 0 )
+			{
+				state.PauseTiming();
+				sigjournal_compact(copy.c_str());
+				state.ResumeTiming();
+			}
+		}
+		else
+		{
+			/* the record would be edited in place, the cost is in writing it all out */
+			std::string tmp = copy + ".tmp";
+			fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+			if( fd < 0 || write(fd, text.data(), text.size()) != (ssize_t)text.size() || fdatasync(fd) != 0
+				|| close(fd) != 0 || rename(tmp.c_str(), copy.c_str()) != 0 )
+			{
+				state.SkipWithError("rewrite failed");
+			}
+			n++;
+		}
+	}
+
+	state.SetItemsProcessed((int64_t)state.iterations());
+	sigtable_close(tab);
+	unlink(copy.c_str());
+	unlink((copy + SIGJOURNAL_SUFFIX).c_str());
+}
+
+BENCHMARK_CAPTURE(BM_update, journal, true)->Apply(size_args)->Unit(benchmark::kMicrosecond);
+BENCHMARK_CAPTURE(BM_update, rewrite, false)->Apply(size_args)->Unit(benchmark::kMicrosecond);
+
+/** \brief Loading a database with a journal of \p state.range(1) changes replayed on top. */
+static void BM_replay( benchmark::State &state )
+{
+	std::string db = bench_db((size_t)state.range(0)), copy = db + ".replay";
+	struct sigtable *tab = sigtable_load(db.c_str());
+	std::vector<struct sigchange> changes((size_t)state.range(1));
+	std::vector<char> text;
+	struct stat st;
+	int fd = open(db.c_str(), O_RDONLY);
+
+	if( tab == NULL || fd < 0 || fstat(fd, &st) != 0 )
+	{
+		state.SkipWithError("cannot open");
+		sigtable_close(tab);
+		if( fd >= 0 ) close(fd);
+		return;
+	}
+	text.resize((size_t)st.st_size);
+	if( pread(fd, text.data(), text.size(), 0) != (ssize_t)text.size() ) state.SkipWithError("cannot read");
+	close(fd);
+	fd = open(copy.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+	if( fd < 0 || write(fd, text.data(), text.size()) != (ssize_t)text.size() ) state.SkipWithError("cannot copy");
+	if( fd >= 0 ) close(fd);
+	unlink((copy + SIGJOURNAL_SUFFIX).c_str());
+
+	for( size_t i = 0; i < changes.size(); i++ )
+	{
+		memset(&changes[i], 0, sizeof(changes[i]));
+		changes[i].rec.signum = tab->hot[i * 7919 % tab->size].signum;
+		strcpy(changes[i].rec.signame, "UPD");
+		strcpy(changes[i].rec.sigdesc, "Changed by the benchmark");
+	}
+	sigtable_close(tab);
+	if( !changes.empty() && sigjournal_append(copy.c_str(), changes.data(), changes.size()) != 0 )
+	{
+		state.SkipWithError("append failed");
+	}
+
+	for( auto _ : state )
+	{
+		tab = sigtable_open(copy.c_str());
+		if( tab == NULL ) state.SkipWithError("open failed");
+		sigtable_close(tab);
+	}
+
+	unlink(copy.c_str());
+	unlink((copy + SIGJOURNAL_SUFFIX).c_str());
+}
+
+static void replay_args( benchmark::internal::Benchmark *b )
+{
+	for( size_t size : bench_sizes )
+	{
+		if( size > bench_max() || size < (1 << 14) ) continue;
+		for( int64_t changes : { 0, 100, 10000 } ) b->Args({ (int64_t)size, changes });
+	}
+}
+
+BENCHMARK(BM_replay)->Apply(replay_args)->Unit(benchmark::kMillisecond);
+
+/** \brief A SigDb per size, made by whichever benchmark thread asks first. */
+static const SigDb *bench_sigdb( size_t count )
+{
+	static std::mutex lock;
+	static std::map<size_t, std::unique_ptr<SigDb>> dbs;
+	std::lock_guard<std::mutex> guard(lock);
+	std::unique_ptr<SigDb> &db = dbs[count];
+
+	if( db == nullptr ) db = SigDb::open(bench_db(count).c_str());
+	return db.get();
+}
+
+/** \brief SigDb lookups by signal number and by name from every benchmark thread at once,
+    reading the strings of each match.
+*/
+static void BM_sigdb_find( benchmark::State &state )
+{
+	const SigDb *db = bench_sigdb((size_t)state.range(0));
+	std::vector<std::string> names;
+	const std::vector<unsigned> &signums = signum_queries();
+	size_t i = (size_t)state.thread_index() * 997, bytes = 0;
+
+	if( db == nullptr )
+	{
+		state.SkipWithError("cannot open");
+		return;
+	}
+
+	for( unsigned seed = 1; names.size() < 1024; ) names.emplace_back((*db)[(size_t)rand_r(&seed) % db->size()].name);
+
+	for( auto _ : state )
+	{
+		for( const SigDb::Record &rec : db->find(signums[i % signums.size()]) ) bytes += rec.name.size() + rec.desc.size();
+		for( const SigDb::Record &rec : db->find(std::string_view(names[i % names.size()])) ) bytes += rec.desc.size();
+		i++;
+	}
+	benchmark::DoNotOptimize(bytes);
+	state.SetItemsProcessed((int64_t)state.iterations() * 2);
+}
+
+BENCHMARK(BM_sigdb_find)->Apply(size_args)->ThreadRange(1, 8)->UseRealTime();
+
+/* How BM_export() writes a table: the interactive loop answering every index, or sigtable_export() */
+enum export_how {
+	EXPORT_QUERIES,
+	EXPORT_LINE,
+	EXPORT_JSONL,
+	EXPORT_CSV
+};
+
+/** \brief Exporting all records into a pipe that a thread drains, as a consumer would.
+
+    EXPORT_QUERIES feeds the indexes 0 to size - 1 into run_interactive(), which
+    writes every answer on its own. The others run sigtable_export(), from rendered
+    lines spliced into the pipe if \p rendered.
+*/
+static void BM_export( benchmark::State &state, enum export_how how, bool rendered )
+{
+	struct sigtable *tab = render_table((size_t)state.range(0), rendered);
+	static const enum sigexport_format formats[] = { SIGEXPORT_LINE, SIGEXPORT_LINE, SIGEXPORT_JSONL, SIGEXPORT_CSV };
+	FILE *in = tmpfile();
+	size_t bytes = 0;
+
+	if( tab == NULL || in == NULL )
+	{
+		state.SkipWithError("cannot open");
+		if( in ) fclose(in);
+		return;
+	}
+	for( size_t i = 0; how == EXPORT_QUERIES && i < tab->size; i++ ) fprintf(in, "%zu\n", i);
+	fflush(in);
+
+	for( auto _ : state )
+	{
+		int fds[2];
+		int ret;
+
+		if( pipe(fds) != 0 )
+		{
+			state.SkipWithError("cannot make a pipe");
+			break;
+		}
+		std::thread reader([&]{
+			std::vector<char> buf(1 << 20);
+			ssize_t n;
+
+			while( (n = read(fds[0], buf.data(), buf.size())) > 0 ) bytes += (size_t)n;
+		});
+
+		rewind(in);
+		ret = how == EXPORT_QUERIES ? run_interactive(tab, in, fds[1])
+			: sigtable_export(tab, 0, SIZE_MAX, formats[how], fds[1]);
+		close(fds[1]);
+		reader.join();
+		close(fds[0]);
+		if( ret != 0 )
+		{
+			state.SkipWithError("export failed");
+			break;
+		}
+	}
+
+	state.SetBytesProcessed((int64_t)bytes);
+	state.SetItemsProcessed((int64_t)state.iterations() * (int64_t)tab->size);
+	fclose(in);
+}
+
+static void export_args( benchmark::internal::Benchmark *b )
+{
+	for( size_t size : bench_sizes )
+	{
+		if( size >= 1 << 14 && size <= bench_max() ) b->Arg((int64_t)size);
+	}
+}
+
+BENCHMARK_CAPTURE(BM_export, queries, EXPORT_QUERIES, false)->Apply(export_args)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_export, line, EXPORT_LINE, false)->Apply(export_args)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_export, line_rendered, EXPORT_LINE, true)->Apply(export_args)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_export, jsonl, EXPORT_JSONL, false)->Apply(export_args)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_CAPTURE(BM_export, csv, EXPORT_CSV, false)->Apply(export_args)->UseRealTime()->Unit(benchmark::kMillisecond);
+
+BENCHMARK_MAIN();
@@ -1,11 +1,23 @@
 
 #include <gtest/gtest.h>
+#include <algorithm>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
 
 extern "C"
 {
 #include "better-intexer.c"
+#include "intexer-client.c"
+#include "intexer-gen.c"
 }
 
+#include "intexer-data.h"
+#include "intexer-sigdb.hpp"
+
 #define DATA_PATH "DATA_PATH"
 
 TEST(handle_path, test_input)
@@ -75,6 +87,40 @@ TEST(handle_path, test_sep)
 	ASSERT_STREQ("abc/xyz", full_path);
 }
 
+TEST(handle_path, test_list)
+{
+	char full_path[MAX_PATH];
+	FILE *fh;
+
+	mkdir("test.d1", 0755);
+	mkdir("test.d2", 0755);
+	fh = fopen("test.d2/only", "w");
+	ASSERT_TRUE( NULL != fh );
+	fclose(fh);
+
+	/* the first directory that has the file */
+	ASSERT_EQ(0, setenv(DATA_PATH, "test.d1:test.d2/", 1));
+	ASSERT_EQ((int)strlen("test.d2/only"), handle_path_arg(sizeof(full_path), full_path, "only"));
+	ASSERT_STREQ("test.d2/only", full_path);
+
+	/* or the first one if none has it */
+	ASSERT_EQ((int)strlen("test.d1/none"), handle_path_arg(sizeof(full_path), full_path, "none"));
+	ASSERT_STREQ("test.d1/none", full_path);
+	ASSERT_EQ((int)strlen("test.d1/"), handle_path_arg(sizeof(full_path), full_path, NULL));
+	ASSERT_STREQ("test.d1/", full_path);
+
+	/* an empty entry is the current directory */
+	fh = fopen("only", "w");
+	ASSERT_TRUE( NULL != fh );
+	fclose(fh);
+	ASSERT_EQ(0, setenv(DATA_PATH, "test.d1::test.d2", 1));
+	ASSERT_EQ((int)strlen("only"), handle_path_arg(sizeof(full_path), full_path, "only"));
+	ASSERT_STREQ("only", full_path);
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	unlink("only");
+	unlink("test.d2/only");
+}
+
 static FILE *writestr( const char *str )
 {
 	FILE *fh = fopen("test.tmp", "w");
@@ -192,29 +238,2204 @@ struct sigrecord desc2[2] = {
 	{2, "XYZ", "BLAH"}
 };
 
+static const test_db db_cases[] = {
+	test_db{true,  "1\n1 ABC DESC\n", 1, &onerec},
+	test_db{true,  "1\n+1 ABC DESC\n", 1, &onerec},
+	test_db{false, "1\n-1 ABC DESC\n", 1, &onerec},
+	test_db{false, "1\n65537 ABC DESC\n", 1, &onerec},
+	test_db{true,  "1\n1 A ", 1, &onebadrec},
+	test_db{true,  "1 \n1 A \n", 1, &onebadrec},
+	test_db{true,  "2\n1 ABC DESC\n2 XYZ BLAH\n", 2, tworec},
+	test_db{true,  "1\n1 ABC DESC\n2 XYZ BLAH\n", 1, &tworec[0]},
+	test_db{true,  "2\n1 01234 DESC\n2 XYZ BLAH\n", 2, name1},
+	test_db{true,  "2\n1 012345 DESC\n2 XYZ BLAH\n", 2, name2},
+	test_db{false, "2\n1 0123456 DESC\n2 XYZ BLAH\n", 2, name3},
+	test_db{true,  "2\n1 012345 xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\n2 XYZ BLAH\n", 2, desc1},
+	test_db{true,  "2\n1 012345 xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\n2 XYZ BLAH\n", 2, desc2},
+	test_db{false, "2\n1 012345 xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\n2 XYZ BLAH\n", 2, desc1},
+	test_db{false, "1 \n1  \n", 1, &onebadrec},
+	test_db{false, "1\n1  DESC\n", 1, &onebadrec},
+	test_db{false, "1", 1, &onebadrec},
+	test_db{false, "1\n", 1, &onebadrec},
+	test_db{false, "1\n1", 1, &onebadrec},
+	test_db{false, "1\n1 ", 1, &onebadrec},
+	test_db{false, "1\n1 A", 1, &onebadrec},
+	test_db{false, "2\n1 A \n", 1, &onebadrec},
+	test_db{false, "-1\n1 A \n", 1, &onebadrec},
+	test_db{false, "0\n1 A \n", 0, &onebadrec},
+	test_db{false, "100000000000000000000000000000000000000000000000\n1 A \n", 1, &onebadrec}
+};
+
 INSTANTIATE_TEST_CASE_P(InstantiationName,
                         DbTestFixture,
-                        ::testing::Values(
-				test_db{true,  "1\n1 ABC DESC\n", 1, &onerec},
-				test_db{true,  "1\n1 A ", 1, &onebadrec},
-				test_db{true,  "1 \n1 A \n", 1, &onebadrec},
-				test_db{true,  "2\n1 ABC DESC\n2 XYZ BLAH\n", 2, tworec},
-				test_db{true,  "1\n1 ABC DESC\n2 XYZ BLAH\n", 1, &tworec[0]},
-				test_db{true,  "2\n1 01234 DESC\n2 XYZ BLAH\n", 2, name1},
-				test_db{true,  "2\n1 012345 DESC\n2 XYZ BLAH\n", 2, name2},
-				test_db{false, "2\n1 0123456 DESC\n2 XYZ BLAH\n", 2, name3},
-				test_db{true,  "2\n1 012345 xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\n2 XYZ BLAH\n", 2, desc1},
-				test_db{true,  "2\n1 012345 xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\n2 XYZ BLAH\n", 2, desc2},
-				test_db{false, "2\n1 012345 xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxx\n2 XYZ BLAH\n", 2, desc1},
-				test_db{false, "1 \n1  \n", 1, &onebadrec},
-				test_db{false, "1\n1  DESC\n", 1, &onebadrec},
-				test_db{false, "1", 1, &onebadrec},
-				test_db{false, "1\n", 1, &onebadrec},
-				test_db{false, "1\n1", 1, &onebadrec},
-				test_db{false, "1\n1 ", 1, &onebadrec},
-				test_db{false, "1\n1 A", 1, &onebadrec},
-				test_db{false, "2\n1 A \n", 1, &onebadrec},
-				test_db{false, "-1\n1 A \n", 1, &onebadrec},
-				test_db{false, "0\n1 A \n", 0, &onebadrec},
-				test_db{false, "100000000000000000000000000000000000000000000000\n1 A \n", 1, &onebadrec}
-				));
+                        ::testing::ValuesIn(db_cases));
+
+class MapTestFixture : public ::testing::TestWithParam<test_db>
+{
+};
+
+TEST_P(MapTestFixture, test_db_values)
+{
+	test_db data = GetParam();
+
+	struct sighot *hot = NULL;
+	size_t size = 0;
+
+	hot = map_records(data.db, strlen(data.db), &size);
+	if( data.success )
+	{
+		ASSERT_TRUE( NULL != hot );
+		ASSERT_EQ(data.exp_size, size);
+
+		for( size_t i = 0; i < data.exp_size; i++ )
+		{
+			const char *name = data.db + hot[i].off;
+
+			EXPECT_EQ( data.exp_records[i].signum, hot[i].signum );
+			EXPECT_EQ( std::string(data.exp_records[i].signame), std::string(name, hot[i].name_len) );
+			EXPECT_EQ( std::string(data.exp_records[i].sigdesc), std::string(name + hot[i].name_len + 1, hot[i].desc_len) );
+		}
+	}
+	else
+	{
+		ASSERT_TRUE( NULL == hot );
+	}
+
+	free(hot);
+}
+
+static void expect_same_records( const char *db, size_t len, unsigned threads )
+{
+	size_t size = 0, par_size = 0;
+	struct sighot *hot = map_records(db, len, &size);
+	struct sighot *par = map_records_parallel(db, len, &par_size, threads);
+
+	ASSERT_EQ( NULL == hot, NULL == par ) << threads << " threads";
+	if( hot != NULL )
+	{
+		ASSERT_EQ(size, par_size);
+		EXPECT_EQ(0, memcmp(hot, par, size * sizeof(hot[0]))) << threads << " threads";
+	}
+	free(hot);
+	free(par);
+}
+
+TEST_P(MapTestFixture, test_parallel)
+{
+	test_db data = GetParam();
+
+	for( unsigned threads = 2; threads <= 5; threads++ )
+	{
+		expect_same_records(data.db, strlen(data.db), threads);
+	}
+}
+INSTANTIATE_TEST_CASE_P(InstantiationName,
+                        MapTestFixture,
+                        ::testing::ValuesIn(db_cases));
+
+static std::string generate( const struct siggen_opts &opts, uint64_t *malformed = NULL )
+{
+	std::string db;
+	char buf[4096];
+	ssize_t n;
+	int fd = open("test.gen", O_RDWR | O_CREAT | O_TRUNC, 0644);
+
+	if( fd < 0 ) return "";
+	if( siggen_write(fd, &opts, malformed) == 0 )
+	{
+		lseek(fd, 0, SEEK_SET);
+		while( (n = read(fd, buf, sizeof(buf))) > 0 ) db.append(buf, (size_t)n);
+	}
+	close(fd);
+	return db;
+}
+
+TEST(siggen, test_deterministic)
+{
+	struct siggen_opts opts;
+
+	siggen_defaults(&opts);
+	std::string first = generate(opts);
+	EXPECT_EQ(first, generate(opts));
+	EXPECT_EQ("1000\n", first.substr(0, 5));
+	EXPECT_EQ(1001, std::count(first.begin(), first.end(), '\n'));
+
+	opts.seed = 2;
+	EXPECT_NE(first, generate(opts));
+
+	opts.crlf = true;
+	std::string crlf = generate(opts);
+	EXPECT_EQ(1001, std::count(crlf.begin(), crlf.end(), '\r'));
+
+	opts.desc_max = 100;
+	EXPECT_EQ(-1, siggen_write(-1, &opts, NULL));
+	EXPECT_EQ(EINVAL, errno);
+}
+
+/** \brief read_records(), map_records() and map_records_parallel() agree on generated databases.
+
+    INTEXER_TEST_RECORDS sets the size, to run this on databases of realistic size.
+*/
+TEST(siggen, test_parsers_agree)
+{
+	const char *env = getenv("INTEXER_TEST_RECORDS");
+	struct siggen_opts opts;
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+
+	for( int variant = 0; variant < 12; variant++ )
+	{
+		uint64_t broken = 0;
+		size_t size = 0, map_size = 0, par_size = 0;
+
+		siggen_defaults(&opts);
+		opts.count = env ? strtoull(env, NULL, 10) : 20000;
+		opts.seed = (uint64_t)variant + 1;
+		opts.short_bias = variant & 1;
+		opts.sparse = variant & 2;
+		opts.crlf = variant & 4;
+		if( variant >= 8 )
+		{
+			/* a broken line somewhere, or in the first few hundred records */
+			opts.malformed = variant == 8 ? 0.0001 : 0.01;
+			opts.count = variant == 11 ? 300 : opts.count;
+		}
+
+		std::string db = generate(opts, &broken);
+		ASSERT_FALSE(db.empty());
+
+		FILE *fh = datafile_open("test.gen");
+		ASSERT_TRUE( NULL != fh );
+		struct sigrecord *recs = read_records(fh, &size);
+		fclose(fh);
+		struct sighot *hot = map_records(db.data(), db.size(), &map_size);
+		struct sighot *par = map_records_parallel(db.data(), db.size(), &par_size, 4);
+
+		EXPECT_EQ(broken == 0, NULL != recs) << "variant " << variant;
+		ASSERT_EQ(NULL == recs, NULL == hot) << "variant " << variant;
+		ASSERT_EQ(NULL == recs, NULL == par) << "variant " << variant;
+
+		if( recs )
+		{
+			ASSERT_EQ(size, map_size);
+			ASSERT_EQ(size, par_size);
+			for( size_t i = 0; i < size; i++ )
+			{
+				const char *name = db.data() + hot[i].off;
+
+				ASSERT_EQ(recs[i].signum, hot[i].signum) << "record " << i;
+				ASSERT_EQ(std::string(recs[i].signame), std::string(name, hot[i].name_len)) << "record " << i;
+				ASSERT_EQ(std::string(recs[i].sigdesc), std::string(name + hot[i].name_len + 1, hot[i].desc_len)) << "record " << i;
+			}
+			EXPECT_EQ(0, memcmp(hot, par, size * sizeof(hot[0])));
+		}
+
+		free(recs);
+		free(hot);
+		free(par);
+	}
+}
+
+static std::vector<scan_fields_fn> scan_fields_impls( void )
+{
+	std::vector<scan_fields_fn> impls;
+
+	impls.push_back(scan_fields_select());
+#ifdef SCAN_FIELDS_X86
+	impls.push_back(scan_fields_sse2);
+	if( __builtin_cpu_supports("avx2") ) impls.push_back(scan_fields_avx2);
+#endif
+	return impls;
+}
+
+static void expect_same_fields( const char *line, size_t len )
+{
+	const char *sep, *nl;
+
+	scan_fields_scalar(line, len, &sep, &nl);
+	for( scan_fields_fn fn : scan_fields_impls() )
+	{
+		const char *vsep = line, *vnl = line;
+
+		fn(line, len, &vsep, &vnl);
+		EXPECT_EQ(sep, vsep) << std::string(line, len);
+		EXPECT_EQ(nl, vnl) << std::string(line, len);
+	}
+}
+
+TEST(scan_fields, test_db_cases)
+{
+	for( const test_db &data : db_cases )
+	{
+		size_t len = strlen(data.db);
+
+		for( size_t i = 0; i < len; i++ ) expect_same_fields(data.db + i, len - i);
+	}
+}
+
+TEST(scan_fields, test_random)
+{
+	static const char alphabet[] = { ' ', '\n', 'a', '\t', '\0', '\r', (char)0x80, (char)0xff };
+	std::vector<char> buf(256);
+	unsigned seed = 1;
+
+	for( int round = 0; round < 20000; round++ )
+	{
+		size_t len = rand_r(&seed) % (buf.size() - 16);
+		size_t skew = rand_r(&seed) % 16;
+		unsigned density = 1 + rand_r(&seed) % 64;
+
+		for( size_t i = 0; i < buf.size(); i++ )
+		{
+			buf[i] = rand_r(&seed) % density ? 'x' : alphabet[rand_r(&seed) % sizeof(alphabet)];
+		}
+		expect_same_fields(buf.data() + skew, len);
+	}
+}
+
+TEST(scan_fields, test_checked_fgets)
+{
+	struct sigrecord rec;
+	FILE *fh = writestr("1 NAME a description with spaces\r\n2 X \n3 Y  xyz");
+
+	ASSERT_TRUE( NULL != fh );
+	ASSERT_TRUE( NULL != checked_fgets(&rec, fh) );
+	EXPECT_EQ(std::string("NAME"), rec.signame);
+	EXPECT_EQ(std::string("a description with spaces\r"), rec.sigdesc);
+	ASSERT_TRUE( NULL != checked_fgets(&rec, fh) );
+	EXPECT_EQ(std::string("X"), rec.signame);
+	EXPECT_EQ(std::string(""), rec.sigdesc);
+	ASSERT_TRUE( NULL != checked_fgets(&rec, fh) );
+	EXPECT_EQ(std::string("Y"), rec.signame);
+	EXPECT_EQ(std::string(" xyz"), rec.sigdesc);
+	fclose(fh);
+}
+
+TEST(map_records, test_parallel_random)
+{
+	/* blank lines and records spanning lines move record starts off the chunk cuts */
+	static const char *const seps[] = { " ", "  ", "\n", "\t", " \n " };
+	unsigned seed = 1;
+
+	for( int round = 0; round < 200; round++ )
+	{
+		size_t count = 1 + rand_r(&seed) % 300;
+		std::string db = std::to_string(count) + (rand_r(&seed) % 4 ? "\n" : "\n\n");
+
+		for( size_t i = 0; i < count; i++ )
+		{
+			db += std::to_string(rand_r(&seed) % 70000);
+			db += seps[rand_r(&seed) % 5];
+			db += std::string(1 + rand_r(&seed) % 6, 'A' + rand_r(&seed) % 26);
+			db += " " + std::string(rand_r(&seed) % 120, 'd');
+			db += rand_r(&seed) % 10 ? "\n" : "\n\n";
+		}
+		if( rand_r(&seed) % 3 == 0 ) db.resize(db.size() - rand_r(&seed) % db.size());
+
+		for( unsigned threads = 2; threads <= 16; threads *= 2 )
+		{
+			expect_same_records(db.data(), db.size(), threads);
+		}
+	}
+}
+
+TEST(sigtable, test_open)
+{
+	struct sigtable *tab;
+	struct sigview view;
+	FILE *fh = writestr("2\n1 ABC DESC\n2 XYZ BLAH\n");
+
+	ASSERT_TRUE( NULL != fh );
+	fclose(fh);
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	tab = sigtable_open("test.tmp");
+	ASSERT_TRUE( NULL != tab );
+	ASSERT_EQ(2u, tab->size);
+	ASSERT_TRUE( NULL != sigtable_get(tab, 1, &view) );
+	EXPECT_EQ(2, view.signum);
+	EXPECT_EQ(std::string("XYZ"), std::string(view.name, view.name_len));
+	EXPECT_EQ(std::string("BLAH"), std::string(view.desc, view.desc_len));
+	EXPECT_TRUE( NULL == sigtable_get(tab, 2, &view) );
+	sigtable_close(tab);
+
+	errno = 0;
+	EXPECT_TRUE( NULL == sigtable_open("does-not-exist.tmp") );
+	EXPECT_EQ(ENOENT, errno);
+}
+
+static void write_file( const char *path, const std::string &text )
+{
+	FILE *fh = fopen(path, "w");
+
+	ASSERT_TRUE( NULL != fh );
+	ASSERT_EQ(text.size(), fwrite(text.data(), 1, text.size(), fh));
+	ASSERT_EQ(0, fclose(fh));
+}
+
+static std::string read_file( const char *path )
+{
+	std::string text;
+	FILE *fh = fopen(path, "r");
+
+	if( fh == NULL ) return "NULL";
+	for( int c; (c = fgetc(fh)) != EOF; ) text += (char)c;
+	fclose(fh);
+	return text;
+}
+
+/* The records of \p tab as "signum name desc" lines */
+static std::string table_lines( const struct sigtable *tab )
+{
+	std::string lines;
+	struct sigview view;
+
+	if( tab == NULL ) return "NULL";
+	for( size_t i = 0; i < tab->size; i++ )
+	{
+		if( NULL == sigtable_get(tab, i, &view) ) return lines + "corrupt";
+		lines += std::to_string(view.signum) + " " + std::string(view.name, view.name_len)
+			+ " " + std::string(view.desc, view.desc_len) + "\n";
+	}
+	return lines;
+}
+
+static std::string open_lines( const char *path_arg, bool copy = false )
+{
+	struct sigtable *tab = copy ? sigtable_load(path_arg) : sigtable_open(path_arg);
+	std::string lines = table_lines(tab);
+
+	sigtable_close(tab);
+	return lines;
+}
+
+TEST(sigshards, test_precedence)
+{
+	struct sigtable *tab;
+	const uint32_t *recs;
+
+	mkdir("test.d1", 0755);
+	mkdir("test.d2", 0755);
+	write_file("test.d1/a.db", "2\n1 HUP Hangup\n2 INT Interrupt\n");
+	write_file("test.d1/b.db", "3\n2 XINT Other\n3 QUIT Quit\n3 QUIT2 Quit too\n");
+	write_file("test.d2/a.db", "1\n3 ZZ Shadows\n");
+	write_file("test.d1/list", "#intexer-shards\r\nb.db\n# a.db comes second\n\na.db\n");
+	write_file("test.d1/none", "#intexer-shards\nmissing-*.db\n");
+	write_file("test.d1/x.bad", "2\n1 HUP Hangup\n");
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	/* files a pattern matches in name order, records of one shard all kept */
+	EXPECT_EQ("1 HUP Hangup\n2 INT Interrupt\n3 QUIT Quit\n3 QUIT2 Quit too\n", open_lines("test.d1/*.db"));
+	EXPECT_EQ(open_lines("test.d1/*.db"), open_lines("test.d1/*.db", true));
+	/* in manifest order */
+	EXPECT_EQ("2 XINT Other\n3 QUIT Quit\n3 QUIT2 Quit too\n1 HUP Hangup\n", open_lines("test.d1/list"));
+
+	/* and in DATA_PATH order */
+	ASSERT_EQ(0, setenv(DATA_PATH, "test.d2:test.d1", 1));
+	EXPECT_EQ("3 ZZ Shadows\n1 HUP Hangup\n2 INT Interrupt\n", open_lines("*.db"));
+	EXPECT_EQ("3 ZZ Shadows\n", open_lines("a.db"));
+	EXPECT_EQ("2 XINT Other\n3 QUIT Quit\n3 QUIT2 Quit too\n1 HUP Hangup\n", open_lines("list"));
+
+	/* a directory that does not exist matches nothing, wherever it is listed */
+	ASSERT_EQ(0, setenv(DATA_PATH, "test.missing:test.d2:test.d1/a.db:test.d1", 1));
+	EXPECT_EQ("3 ZZ Shadows\n1 HUP Hangup\n2 INT Interrupt\n", open_lines("*.db"));
+	ASSERT_EQ(0, setenv(DATA_PATH, "test.d2:test.d1:test.missing", 1));
+	EXPECT_EQ("3 ZZ Shadows\n1 HUP Hangup\n2 INT Interrupt\n", open_lines("*.db"));
+
+	/* indexes see the merged table */
+	tab = sigtable_open("*.db");
+	ASSERT_TRUE( NULL != tab );
+	ASSERT_EQ(0, sigtable_index(tab));
+	ASSERT_EQ(1u, sigtable_find_name(tab, "INT", 3, &recs));
+	EXPECT_EQ(2u, recs[0]);
+	ASSERT_EQ(1u, sigtable_find_name(tab, "ZZ", 2, &recs));
+	EXPECT_EQ(0u, recs[0]);
+	EXPECT_EQ(0u, sigtable_find_name(tab, "XINT", 4, &recs));
+	sigtable_close(tab);
+
+	/* shards that name nothing, fail to parse or cannot be paged */
+	errno = 0;
+	EXPECT_TRUE( NULL == sigtable_open("*.none") );
+	EXPECT_EQ(ENOENT, errno);
+	errno = 0;
+	EXPECT_TRUE( NULL == sigtable_open("none") );
+	EXPECT_EQ(ENOENT, errno);
+	errno = 0;
+	EXPECT_TRUE( NULL == sigtable_open("*.bad") );
+	EXPECT_EQ(EINVAL, errno);
+	errno = 0;
+	EXPECT_TRUE( NULL == sigtable_open("*") );
+	EXPECT_EQ(EINVAL, errno);
+	errno = 0;
+	EXPECT_TRUE( NULL == sigtable_open_bounded("*.db", 1 << 20) );
+	EXPECT_EQ(ENOTSUP, errno);
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+}
+
+TEST(sigshards, test_random)
+{
+	struct siggen_opts opts;
+	std::string expected, pattern = "test.d3/shard-*.db";
+	bool seen[65536] = { false };
+
+	mkdir("test.d3", 0755);
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	for( int i = 0; i < 6; i++ )
+	{
+		std::string path = "test.d3/shard-" + std::to_string(i) + ".db";
+		struct sigtable *tab;
+		struct sigview view;
+
+		siggen_defaults(&opts);
+		opts.count = 3000 + 7000 * (uint64_t)i;
+		opts.seed = (uint64_t)i + 1;
+		opts.sparse = true;
+		opts.crlf = i == 2;
+		write_file(path.c_str(), generate(opts));
+
+		/* what the merge should keep of this shard */
+		tab = sigtable_open(path.c_str());
+		ASSERT_TRUE( NULL != tab );
+		for( size_t k = 0; k < tab->size; k++ )
+		{
+			ASSERT_TRUE( NULL != sigtable_get(tab, k, &view) );
+			if( !seen[view.signum] ) expected += std::to_string(view.signum) + " "
+				+ std::string(view.name, view.name_len) + " " + std::string(view.desc, view.desc_len) + "\n";
+		}
+		for( size_t k = 0; k < tab->size; k++ )
+		{
+			ASSERT_TRUE( NULL != sigtable_get(tab, k, &view) );
+			seen[view.signum] = true;
+		}
+		sigtable_close(tab);
+	}
+
+	EXPECT_EQ(expected, open_lines(pattern.c_str()));
+	EXPECT_EQ(expected, open_lines(pattern.c_str(), true));
+	sigpack_on_load = true;
+	EXPECT_EQ(expected, open_lines(pattern.c_str()));
+	sigpack_on_load = false;
+}
+
+/* A change for sigjournal_append() */
+static struct sigchange change( unsigned signum, const char *name = NULL, const char *desc = "" )
+{
+	struct sigchange ch;
+
+	memset(&ch, 0, sizeof(ch));
+	ch.remove = name == NULL;
+	ch.rec.signum = (unsigned short)signum;
+	if( name ) snprintf(ch.rec.signame, sizeof(ch.rec.signame), "%s", name);
+	snprintf(ch.rec.sigdesc, sizeof(ch.rec.sigdesc), "%s", desc);
+	return ch;
+}
+
+/* \p lines with \p changes applied as sigjournal_merge() describes it: the last change of a signal number wins */
+static std::string apply_changes( const std::string &lines, const std::vector<struct sigchange> &changes )
+{
+	std::map<unsigned, size_t> last;
+	std::set<unsigned> done;
+	std::string out, line;
+	std::istringstream in(lines);
+
+	for( size_t k = 0; k < changes.size(); k++ ) last[changes[k].rec.signum] = k;
+	auto put = [&]( size_t k ) {
+		const struct sigrecord &rec = changes[k].rec;
+		if( !changes[k].remove && done.insert(rec.signum).second )
+		{
+			out += std::to_string(rec.signum) + " " + rec.signame + " " + rec.sigdesc + "\n";
+		}
+	};
+	while( std::getline(in, line) )
+	{
+		unsigned signum = (unsigned)std::stoul(line);
+		if( last.count(signum) ) put(last[signum]);
+		else out += line + "\n";
+	}
+	for( size_t k = 0; k < changes.size(); k++ )
+	{
+		if( last[changes[k].rec.signum] == k ) put(k);
+	}
+	return out;
+}
+
+TEST(sigjournal, test_replay)
+{
+	struct siggen_opts opts;
+	std::vector<struct sigchange> applied;
+	unsigned seed = 1;
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	unlink("test.j.journal");
+	siggen_defaults(&opts);
+	opts.count = 3000;
+	opts.sparse = true;
+	write_file("test.j", generate(opts));
+	std::string base = open_lines("test.j");
+
+	/* nothing changes without a journal, or with an empty one */
+	EXPECT_EQ(0, sigjournal_append("test.j", NULL, 0));
+	EXPECT_EQ(base, open_lines("test.j"));
+	write_file("test.j.journal", "");
+	EXPECT_EQ(base, open_lines("test.j"));
+
+	for( int batch = 0; batch < 20; batch++ )
+	{
+		std::vector<struct sigchange> changes;
+		struct sigtable *tab = sigtable_open("test.j");
+
+		ASSERT_TRUE( NULL != tab );
+		for( int i = 0; i < 1 + batch % 7; i++ )
+		{
+			/* mostly signal numbers the table has, some new ones */
+			unsigned signum = i % 3 ? tab->hot[(size_t)rand_r(&seed) % tab->size].signum : (unsigned)rand_r(&seed) % 65536;
+			std::string name = "N" + std::to_string(rand_r(&seed) % 100000);
+
+			changes.push_back(rand_r(&seed) % 4 == 0 ? change(signum)
+				: change(signum, name.c_str(), batch % 5 ? "changed in the journal" : ""));
+		}
+		sigtable_close(tab);
+		ASSERT_EQ(0, sigjournal_append("test.j", changes.data(), changes.size()));
+		applied.insert(applied.end(), changes.begin(), changes.end());
+
+		std::string expected = apply_changes(base, applied);
+		ASSERT_EQ(expected, open_lines("test.j")) << batch;
+		EXPECT_EQ(expected, open_lines("test.j", true)) << batch;
+	}
+	std::string expected = apply_changes(base, applied);
+
+	/* packed and rendered tables are built from the records with the journal applied */
+	sigpack_on_load = true;
+	sigrender_on_load = true;
+	struct sigtable *tab = sigtable_open("test.j");
+	sigpack_on_load = false;
+	sigrender_on_load = false;
+	EXPECT_EQ(expected, table_lines(tab));
+	sigtable_close(tab);
+
+	/* a batch cut short is ignored, and cut off by the next append */
+	std::string journal = read_file("test.j.journal");
+	struct sigchange torn[] = { change(1, "TORN", "never committed"), change(2) };
+	ASSERT_EQ(0, sigjournal_append("test.j", torn, 2));
+	std::string torn_journal = read_file("test.j.journal");
+	ASSERT_EQ(0, truncate("test.j.journal", (off_t)journal.size() + 30));
+	EXPECT_EQ(expected, open_lines("test.j"));
+	/* the first line whole, the second cut */
+	write_file("test.j.journal", torn_journal.substr(0, journal.size() + 50));
+	EXPECT_EQ(expected, open_lines("test.j"));
+	struct sigchange after = change(7, "AFTER", "after the crash");
+	ASSERT_EQ(0, sigjournal_append("test.j", &after, 1));
+	applied.push_back(after);
+	expected = apply_changes(base, applied);
+	EXPECT_EQ(expected, open_lines("test.j"));
+	EXPECT_NE(std::string::npos, expected.find("\n7 AFTER after the crash\n"));
+
+	/* a damaged line loses its batch only */
+	FILE *fh = fopen("test.j.journal", "a");
+	ASSERT_TRUE( NULL != fh );
+	fputs("0000000000000000 + 8 BAD Bad checksum\n0000000000000000 = 1\n", fh);
+	fclose(fh);
+	struct sigchange last[] = { change(65535, "LAST", "the highest number"), change(0, "ZERO") };
+	ASSERT_EQ(0, sigjournal_append("test.j", last, 2));
+	applied.insert(applied.end(), last, last + 2);
+	expected = apply_changes(base, applied);
+	EXPECT_EQ(expected, open_lines("test.j"));
+
+	/* compaction writes the same records, and replaying the journal again changes nothing */
+	journal = read_file("test.j.journal");
+	ASSERT_EQ(0, sigjournal_compact("test.j"));
+	EXPECT_EQ("", read_file("test.j.journal"));
+	EXPECT_EQ(expected, open_lines("test.j"));
+	write_file("test.j.journal", journal);
+	EXPECT_EQ(expected, open_lines("test.j"));
+	EXPECT_EQ(0, sigjournal_compact("test.j"));
+	EXPECT_EQ(expected, open_lines("test.j"));
+	EXPECT_EQ(0, sigjournal_compact("test.j"));
+
+	/* a table loaded before an append is not folded, the file is loaded again; its mode is kept */
+	struct sigsource source;
+	struct sigchange late[] = { change(9, "LATE", "appended after the load"), change(10, "LATER") };
+	ASSERT_EQ(0, chmod("test.j", 0600));
+	ASSERT_EQ(0, sigjournal_append("test.j", &late[0], 1));
+	tab = sigtable_map("test.j", true, 0, &source);
+	ASSERT_TRUE( NULL != tab );
+	EXPECT_EQ(read_file("test.j.journal").size(), source.journal_len);
+	ASSERT_EQ(0, sigjournal_append("test.j", &late[1], 1));
+	applied.insert(applied.end(), late, late + 2);
+	expected = apply_changes(base, applied);
+	EXPECT_EQ(0, sigjournal_fold("test.j", tab, &source));
+	sigtable_close(tab);
+	EXPECT_EQ("", read_file("test.j.journal"));
+	EXPECT_EQ(expected, open_lines("test.j"));
+	struct stat st;
+	ASSERT_EQ(0, stat("test.j", &st));
+	EXPECT_EQ(0600u, st.st_mode & 0777);
+
+	/* a current table is written as it is, without loading the file */
+	ASSERT_EQ(0, sigjournal_append("test.j", &after, 1));
+	tab = sigtable_map("test.j", true, 0, &source);
+	ASSERT_TRUE( NULL != tab );
+	const char other[] = "1\n5 OTHER Not from the file\n";
+	struct sigtable *written = sigtable_parse(other, sizeof(other) - 1);
+	ASSERT_TRUE( NULL != written );
+	EXPECT_EQ(0, sigjournal_fold("test.j", written, &source));
+	sigtable_close(written);
+	sigtable_close(tab);
+	EXPECT_EQ("5 OTHER Not from the file\n", open_lines("test.j"));
+
+	/* changes that are not records, tables that cannot replay */
+	struct sigchange bad[] = { change(1, ""), change(1, "A B"), change(1, "OK", "two\nlines") };
+	for( const struct sigchange &ch : bad )
+	{
+		errno = 0;
+		EXPECT_EQ(-1, sigjournal_append("test.j", &ch, 1));
+		EXPECT_EQ(EINVAL, errno);
+	}
+	errno = 0;
+	EXPECT_EQ(-1, sigjournal_append("test.j*", &after, 1));
+	EXPECT_EQ(EINVAL, errno);
+	ASSERT_EQ(0, sigjournal_append("test.j", &after, 1));
+	errno = 0;
+	EXPECT_TRUE( NULL == sigtable_open_bounded("test.j", 1) );
+	EXPECT_EQ(ENOTSUP, errno);
+	EXPECT_EQ(0, unlink("test.j.journal"));
+}
+
+TEST(sigjournal, test_parse_change)
+{
+	struct sigchange ch;
+
+	ASSERT_EQ(0, sigchange_parse("+ 11 SEGV Invalid memory reference", 34, &ch));
+	EXPECT_FALSE(ch.remove);
+	EXPECT_EQ(11, ch.rec.signum);
+	EXPECT_STREQ("SEGV", ch.rec.signame);
+	EXPECT_STREQ("Invalid memory reference", ch.rec.sigdesc);
+	ASSERT_EQ(0, sigchange_parse("+ 3 QUIT ", 9, &ch));
+	EXPECT_STREQ("", ch.rec.sigdesc);
+	ASSERT_EQ(0, sigchange_parse("- 65535", 7, &ch));
+	EXPECT_TRUE(ch.remove);
+	EXPECT_EQ(65535, ch.rec.signum);
+
+	for( const char *line : { "", "+", "- ", "- 65536", "- 1x", "+ 1 LONGNAME x", "+ 1 NODESC", "* 1 A b", "+ x A b" } )
+	{
+		errno = 0;
+		EXPECT_EQ(-1, sigchange_parse(line, strlen(line), &ch)) << line;
+		EXPECT_EQ(EINVAL, errno) << line;
+	}
+}
+
+static void count_done( void *arg, struct sigio_file *file )
+{
+	std::vector<int> *done = (std::vector<int> *)arg;
+
+	__atomic_fetch_add(&(*done)[(size_t)file->fd], 1, __ATOMIC_RELAXED);
+}
+
+TEST(sigio, test_backends)
+{
+	static const size_t sizes[] = { 1, 4096, SIGIO_CHUNK, SIGIO_CHUNK + 1, 3 * SIGIO_CHUNK + 12345, 0, 77 };
+	const size_t n = sizeof(sizes) / sizeof(sizes[0]);
+	std::vector<std::string> texts;
+	unsigned seed = 1;
+	bool uring;
+	struct sigio_ring ring;
+
+	uring = sigio_ring_init(&ring, 4) == 0;
+	if( uring ) sigio_ring_free(&ring);
+
+	for( size_t i = 0; i < n; i++ )
+	{
+		std::string text(sizes[i], '\0');
+
+		for( char &c : text ) c = (char)rand_r(&seed);
+		write_file(("test.io" + std::to_string(i)).c_str(), text);
+		texts.push_back(text);
+	}
+
+	for( enum sigio_backend backend : { SIGIO_AUTO, SIGIO_URING, SIGIO_PREAD } )
+	{
+		std::vector<struct sigio_file> files(n + 2);
+		std::vector<std::vector<char>> bufs(n + 2);
+		std::vector<int> done(1024);
+
+		if( backend == SIGIO_URING && !uring ) continue;
+		for( size_t i = 0; i < n + 2; i++ )
+		{
+			/* and a file that is shorter than its buffer, and one that is not open */
+			size_t len = i < n ? sizes[i] : 100;
+
+			files[i].fd = i <= n ? open(("test.io" + std::to_string(i < n ? i : 0)).c_str(), O_RDONLY) : 1000;
+			files[i].len = len;
+			bufs[i].resize(len + 1);
+			files[i].buf = bufs[i].data();
+			ASSERT_LE(0, files[i].fd);
+		}
+
+		sigio_backend = backend;
+		ASSERT_EQ(0, sigio_read(files.data(), files.size(), count_done, &done)) << backend;
+		sigio_backend = SIGIO_AUTO;
+
+		for( size_t i = 0; i < n; i++ )
+		{
+			EXPECT_EQ(0, files[i].err) << backend << " " << i;
+			EXPECT_EQ(1, done[(size_t)files[i].fd]);
+			EXPECT_TRUE( texts[i] == std::string(files[i].buf, files[i].len) ) << backend << " " << i;
+		}
+		EXPECT_EQ(EINVAL, files[n].err);
+		EXPECT_EQ(EBADF, files[n + 1].err);
+		EXPECT_EQ(1, done[1000]);
+		for( size_t i = 0; i <= n; i++ ) close(files[i].fd);
+	}
+
+	/* sharded and single file loads read alike with every backend */
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	std::string expected = open_lines("test.d3/shard-*.db", true);
+	ASSERT_NE("NULL", expected);
+	for( enum sigio_backend backend : { SIGIO_URING, SIGIO_PREAD } )
+	{
+		if( backend == SIGIO_URING && !uring ) continue;
+		sigio_backend = backend;
+		EXPECT_EQ(expected, open_lines("test.d3/shard-*.db", true)) << backend;
+		EXPECT_EQ(open_lines("test.d3/shard-5.db"), open_lines("test.d3/shard-5.db", true)) << backend;
+		sigio_backend = SIGIO_AUTO;
+	}
+}
+
+TEST(sigregion, test_alloc)
+{
+	const unsigned flags[] = { 0, SIGREGION_THP, SIGREGION_HUGETLB };
+
+	for( unsigned f : flags )
+	{
+		struct sigregion region;
+		std::vector<char *> blocks;
+		char *p;
+
+		sigregion_init(&region, f);
+		EXPECT_EQ(0u, region.mapped);
+
+		errno = 0;
+		EXPECT_TRUE( NULL == sigregion_alloc(&region, 0, 1, 1) );
+		EXPECT_TRUE( NULL == sigregion_alloc(&region, 1, 1, 3) );
+		EXPECT_TRUE( NULL == sigregion_alloc(&region, 1, 1, 8192) );
+		EXPECT_TRUE( NULL == sigregion_alloc(&region, SIZE_MAX / 2, 4, 1) );
+		EXPECT_EQ(EINVAL, errno);
+
+		/* small allocations share a block and keep their alignment */
+		for( size_t align = 1; align <= 4096; align *= 2 )
+		{
+			p = (char *)sigregion_alloc(&region, 3, 7, align);
+			ASSERT_TRUE( NULL != p );
+			EXPECT_EQ(0u, (uintptr_t)p % align);
+			for( int i = 0; i < 21; i++ ) EXPECT_EQ(0, p[i]);
+			memset(p, 0xff, 21);
+		}
+		EXPECT_EQ((size_t)64 << 10, region.mapped);
+
+		/* a large one takes a block of its own, in whole huge pages */
+		p = (char *)sigregion_alloc(&region, 5, 1 << 20, 64);
+		ASSERT_TRUE( NULL != p );
+		EXPECT_EQ(0, p[0]);
+		EXPECT_EQ(0, p[(5 << 20) - 1]);
+		memset(p, 1, 5 << 20);
+		EXPECT_EQ(((size_t)64 << 10) + ((size_t)6 << 20), region.mapped);
+		EXPECT_EQ(13u * 21 + (5u << 20), region.used);
+
+		sigregion_free(&region);
+		EXPECT_EQ(0u, region.mapped);
+		EXPECT_EQ(0u, region.used);
+		EXPECT_EQ(f, region.flags);
+	}
+
+	/* a table does not depend on how its region is backed */
+	for( unsigned f : flags )
+	{
+		struct sigtable *tab;
+		const uint32_t *recs;
+		FILE *fh = writestr("2\n1 ABC DESC\n2 XYZ BLAH\n");
+
+		ASSERT_TRUE( NULL != fh );
+		fclose(fh);
+		sigregion_flags = f;
+		tab = sigtable_open("test.tmp");
+		sigregion_flags = SIGREGION_THP;
+		ASSERT_TRUE( NULL != tab );
+		EXPECT_EQ(f, tab->region.flags);
+		ASSERT_EQ(0, sigtable_index(tab));
+		EXPECT_EQ(1u, sigtable_find_name(tab, "xyz", 3, &recs));
+		EXPECT_EQ(1u, recs[0]);
+		EXPECT_EQ(1u, sigtable_find_name(tab, "abc", 3, &recs));
+		EXPECT_EQ(0u, recs[0]);
+		EXPECT_LE(tab->region.used, tab->region.mapped);
+		sigtable_close(tab);
+	}
+}
+
+TEST(sigpager, test_matches_open)
+{
+	struct siggen_opts opts;
+	struct sigtable *tab, *bounded;
+	struct sigview view, want;
+	unsigned seed = 1;
+
+	siggen_defaults(&opts);
+	opts.count = 10000;
+	opts.crlf = true;
+	std::string db = generate(opts);
+	FILE *fh = writestr(db.c_str());
+	ASSERT_TRUE( NULL != fh );
+	fclose(fh);
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	tab = sigtable_open("test.tmp");
+	bounded = sigtable_open_bounded("test.tmp", 16 * 1024);
+	ASSERT_TRUE( NULL != tab );
+	ASSERT_TRUE( NULL != bounded );
+	ASSERT_TRUE( NULL != bounded->pager );
+	ASSERT_EQ(tab->size, bounded->size);
+	EXPECT_TRUE( NULL == bounded->hot );
+
+	for( int i = 0; i < 20000; i++ )
+	{
+		size_t idx = (size_t)rand_r(&seed) % tab->size;
+
+		ASSERT_TRUE( NULL != sigtable_get(tab, idx, &want) );
+		ASSERT_TRUE( NULL != sigtable_get(bounded, idx, &view) ) << idx;
+		EXPECT_EQ(want.signum, view.signum);
+		EXPECT_EQ(std::string(want.name, want.name_len), std::string(view.name, view.name_len));
+		EXPECT_EQ(std::string(want.desc, want.desc_len), std::string(view.desc, view.desc_len));
+		ASSERT_LE(bounded->pager->resident, bounded->pager->budget + sizeof(struct sigpage) + 64 * 128);
+	}
+	EXPECT_EQ(20000u, bounded->pager->hits + bounded->pager->misses);
+	EXPECT_GT(bounded->pager->evictions, 0u);
+	EXPECT_TRUE( NULL == sigtable_get(bounded, tab->size, &view) );
+
+	errno = 0;
+	EXPECT_EQ(-1, sigtable_index(bounded));
+	EXPECT_EQ(ENOTSUP, errno);
+	sigtable_close(bounded);
+
+	/* with room for everything every page is read once */
+	bounded = sigtable_open_bounded("test.tmp", db.size() * 4);
+	ASSERT_TRUE( NULL != bounded );
+	for( size_t pass = 0; pass < 2; pass++ )
+	{
+		for( size_t idx = 0; idx < bounded->size; idx++ ) ASSERT_TRUE( NULL != sigtable_get(bounded, idx, &view) );
+	}
+	EXPECT_EQ(bounded->pager->npages, bounded->pager->misses);
+	EXPECT_EQ(0u, bounded->pager->evictions);
+	sigtable_close(bounded);
+	sigtable_close(tab);
+
+	/* a file changed since it was indexed is an error, not garbage */
+	bounded = sigtable_open_bounded("test.tmp", 1);
+	ASSERT_TRUE( NULL != bounded );
+	fh = writestr("2\n1 ABC DESC\n2 XYZ BLAH\n");
+	ASSERT_TRUE( NULL != fh );
+	fclose(fh);
+	errno = 0;
+	EXPECT_TRUE( NULL == sigtable_get(bounded, 9999, &view) );
+	EXPECT_NE(0, errno);
+	sigtable_close(bounded);
+}
+
+static struct sigtable *compile_image( const char *db )
+{
+	FILE *fh = writestr(db);
+	int fd;
+	int ret;
+
+	if( NULL == fh ) return NULL;
+	fd = open("test.img", O_RDWR | O_CREAT | O_TRUNC, 0644);
+	ret = sigimage_compile(fh, fd);
+	close(fd);
+	fclose(fh);
+
+	return ret == 0 ? sigtable_open("test.img") : NULL;
+}
+
+TEST(sigimage, test_round_trip)
+{
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+
+	for( const test_db &data : db_cases )
+	{
+		struct sigtable *tab = compile_image(data.db);
+
+		if( !data.success )
+		{
+			EXPECT_TRUE( NULL == tab ) << data.db;
+			continue;
+		}
+
+		ASSERT_TRUE( NULL != tab ) << data.db;
+		ASSERT_TRUE( tab->image );
+		ASSERT_EQ(data.exp_size, tab->size);
+		EXPECT_EQ(0, sigimage_verify(tab));
+
+		for( size_t i = 0; i < data.exp_size; i++ )
+		{
+			struct sigview view;
+			ASSERT_TRUE( NULL != sigtable_get(tab, i, &view) );
+			EXPECT_EQ( data.exp_records[i].signum, view.signum );
+			EXPECT_STREQ( data.exp_records[i].signame, view.name );
+			EXPECT_STREQ( data.exp_records[i].sigdesc, view.desc );
+		}
+		sigtable_close(tab);
+	}
+}
+
+TEST(sigimage, test_corrupt)
+{
+	struct sigtable *tab;
+	struct sigimage_header hdr;
+	char byte;
+	int fd;
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	tab = compile_image("2\n1 ABC DESC\n2 XYZ BLAH\n");
+	ASSERT_TRUE( NULL != tab );
+	sigtable_close(tab);
+
+	/* a damaged heap opens but fails verification */
+	fd = open("test.img", O_RDWR);
+	ASSERT_EQ((ssize_t)sizeof(hdr), pread(fd, &hdr, sizeof(hdr), 0));
+	byte = 'Q';
+	ASSERT_EQ(1, pwrite(fd, &byte, 1, (off_t)hdr.heap_off));
+	tab = sigtable_open("test.img");
+	ASSERT_TRUE( NULL != tab );
+	EXPECT_EQ(-1, sigimage_verify(tab));
+	sigtable_close(tab);
+
+	/* a damaged header does not open at all */
+	hdr.count = 1000;
+	ASSERT_EQ((ssize_t)sizeof(hdr), pwrite(fd, &hdr, sizeof(hdr), 0));
+	close(fd);
+	errno = 0;
+	EXPECT_TRUE( NULL == sigtable_open("test.img") );
+	EXPECT_EQ(EINVAL, errno);
+}
+
+static const char *names_db = "5\n1 HUP Hangup\n2 INT Interrupt\n3 hup Again\n4 ILL Illegal instruction\n5 HUPX Extra\n";
+
+static std::vector<size_t> find_names( const struct sigtable *tab, const char *name, bool prefix )
+{
+	const uint32_t *recs = NULL;
+	size_t n = prefix ? sigtable_find_prefix(tab, name, strlen(name), &recs)
+		: sigtable_find_name(tab, name, strlen(name), &recs);
+
+	return std::vector<size_t>(recs, recs + n);
+}
+
+static void check_names( const struct sigtable *tab )
+{
+	typedef std::vector<size_t> recs;
+
+	EXPECT_EQ(recs({0, 2}), find_names(tab, "HUP", false));
+	EXPECT_EQ(recs({0, 2}), find_names(tab, "hUp", false));
+	EXPECT_EQ(recs({3}), find_names(tab, "ill", false));
+	EXPECT_EQ(recs(), find_names(tab, "HU", false));
+	EXPECT_EQ(recs(), find_names(tab, "QUIT", false));
+	EXPECT_EQ(recs(), find_names(tab, "HUPHUPHUP", false));
+	EXPECT_EQ(recs(), find_names(tab, "", false));
+
+	EXPECT_EQ(recs({0, 2, 4}), find_names(tab, "h", true));
+	EXPECT_EQ(recs({0, 2, 4}), find_names(tab, "HUP", true));
+	EXPECT_EQ(recs({4}), find_names(tab, "hupx", true));
+	EXPECT_EQ(recs({3, 1}), find_names(tab, "I", true));
+	EXPECT_EQ(recs(), find_names(tab, "Q", true));
+	EXPECT_EQ(5u, find_names(tab, "", true).size());
+}
+
+TEST(signame_index, test_text)
+{
+	struct sigtable *tab;
+	FILE *fh = writestr(names_db);
+
+	ASSERT_TRUE( NULL != fh );
+	fclose(fh);
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	tab = sigtable_open("test.tmp");
+	ASSERT_TRUE( NULL != tab );
+	EXPECT_EQ(0u, find_names(tab, "HUP", false).size());
+	ASSERT_EQ(0, sigtable_index_names(tab));
+	EXPECT_TRUE( NULL == tab->names.disp );
+	check_names(tab);
+	sigtable_close(tab);
+}
+
+TEST(signame_index, test_image)
+{
+	struct sigtable *tab;
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	tab = compile_image(names_db);
+	ASSERT_TRUE( NULL != tab );
+	EXPECT_TRUE( NULL != tab->names.disp );
+	EXPECT_EQ(4u, tab->names.nslots);
+	check_names(tab);
+	sigtable_close(tab);
+}
+
+TEST(signame_index, test_perfect_hash)
+{
+	std::string db = "20000\n";
+	struct sigtable *tab;
+
+	for( int i = 0; i < 20000; i++ )
+	{
+		char line[32];
+		snprintf(line, sizeof(line), "%d S%05d desc\n", i % 65536, i);
+		db += line;
+	}
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	tab = compile_image(db.c_str());
+	ASSERT_TRUE( NULL != tab );
+	ASSERT_EQ(20000u, tab->names.nslots);
+	EXPECT_EQ(0, sigimage_verify(tab));
+
+	for( size_t i = 0; i < 20000; i++ )
+	{
+		char name[8];
+		snprintf(name, sizeof(name), "s%05zu", i);
+		ASSERT_EQ(std::vector<size_t>({i}), find_names(tab, name, false));
+	}
+	EXPECT_EQ(0u, find_names(tab, "S20000", false).size());
+	EXPECT_EQ(10000u, find_names(tab, "S0", true).size());
+	sigtable_close(tab);
+}
+
+/* intexer-data.h is made from data.txt, whose records are known */
+static_assert(sigembed_find("hup").end - sigembed_find("hup").begin == 1, "HUP is in data.txt once");
+static_assert(sigembed_get(sigembed_names[sigembed_find("segv").begin].rec).signum == 11, "SEGV is signal 11");
+static_assert(sigembed_find("HUPX").begin == sigembed_find("HUPX").end, "HUPX is not in data.txt");
+
+TEST(sigembed, test_matches_index)
+{
+	struct sigtable *tab = sigtable_attach(sigembed_hot, sigembed_size, sigembed_arena, sizeof(sigembed_arena) - 1);
+	struct sigview view;
+
+	ASSERT_TRUE( NULL != tab );
+	ASSERT_EQ(0, sigtable_index_names(tab));
+
+	for( size_t i = 0; i < sigembed_size; i++ )
+	{
+		struct sigview want = sigembed_get(i);
+		std::string name(want.name, want.name_len);
+		struct sigembed_range range = sigembed_find(name);
+		std::vector<size_t> recs;
+
+		ASSERT_TRUE( NULL != sigtable_get(tab, i, &view) );
+		EXPECT_EQ(want.signum, view.signum);
+		EXPECT_EQ(name, std::string(view.name, view.name_len));
+		EXPECT_EQ(std::string(want.desc, want.desc_len), std::string(view.desc, view.desc_len));
+
+		for( size_t k = range.begin; k < range.end; k++ ) recs.push_back(sigembed_names[k].rec);
+		EXPECT_EQ(find_names(tab, name.c_str(), false), recs) << name;
+	}
+
+	for( const char *name : { "", "SIGHUPX", "H P", "NOSUCH", "hup\n" } )
+	{
+		struct sigembed_range range = sigembed_find(name);
+
+		EXPECT_EQ(range.begin, range.end) << name;
+		EXPECT_EQ(0u, find_names(tab, name, false).size()) << name;
+	}
+	sigtable_close(tab);
+}
+
+TEST(sigembed, test_write)
+{
+	struct sigtable *tab;
+	FILE *fh = writestr("3\n1 HUP Hangup\n2 Q say \"hi\" \\ ?" "?=\n3 hup Again\n");
+	FILE *out = tmpfile();
+	std::string header;
+	char buf[4096];
+	size_t n;
+
+	ASSERT_TRUE( NULL != fh );
+	fclose(fh);
+	ASSERT_TRUE( NULL != out );
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	tab = sigtable_open("test.tmp");
+	ASSERT_TRUE( NULL != tab );
+	ASSERT_EQ(0, sigembed_write(tab, "test.tmp", out));
+	sigtable_close(tab);
+
+	rewind(out);
+	while( (n = fread(buf, 1, sizeof(buf), out)) > 0 ) header.append(buf, n);
+	fclose(out);
+
+	EXPECT_NE(std::string::npos, header.find("static constexpr char sigembed_source[] = \"test.tmp\";\n"));
+	EXPECT_NE(std::string::npos, header.find("\t\"HUP Hangup\\n\"\n\t\"Q say \\\"hi\\\" \\\\ \\077\\077=\\n\"\n\t\"hup Again\\n\";\n"));
+	EXPECT_NE(std::string::npos, header.find("\t{ 0, 1, 3, 6, 0 },\n\t{ 11, 2, 1, 14, 0 },\n\t{ 28, 3, 3, 5, 0 },\n"));
+	EXPECT_NE(std::string::npos, header.find("static constexpr size_t sigembed_size = 3;\n"));
+	/* both HUPs share a key and stay in database order */
+	EXPECT_NE(std::string::npos, header.find("\t{ UINT64_C(0x0048555000000003), 0 },\n\t{ UINT64_C(0x0048555000000003), 2 },\n"));
+}
+
+static std::string run_queries( const char *db, const std::string &queries, bool batch )
+{
+	struct sigtable *tab;
+	FILE *fh = writestr(db);
+	FILE *in = fopen("test.in", "w+");
+	FILE *out = fopen("test.out", "w+");
+	std::string result;
+	char buf[4096];
+	size_t n;
+
+	if( fh ) fclose(fh);
+	tab = sigtable_open("test.tmp");
+	if( tab == NULL || in == NULL || out == NULL ) return "error";
+
+	fwrite(queries.data(), 1, queries.size(), in);
+	fflush(in);
+	rewind(in);
+
+	if( (batch ? run_batch(tab, fileno(in), fileno(out)) : run_interactive(tab, in, fileno(out))) != 0 )
+	{
+		result = "error";
+	}
+
+	rewind(out);
+	while( (n = fread(buf, 1, sizeof(buf), out)) > 0 ) result.append(buf, n);
+
+	fclose(in);
+	fclose(out);
+	sigtable_close(tab);
+	return result;
+}
+
+TEST(queries, test_batch_matches_interactive)
+{
+	std::string queries =
+		"0\n1\n2\n-0\n+1\n \t1\n-1\n3\nx\n\nhup\nHUP\nI*\n*\nABCDEFG\n"
+		"1234567890123\n99999999999999999999999\n0x1\n1 2\n";
+	std::string expected =
+		"1 HUP Hangup\n2 INT Interrupt\nValue out of range.\n1 HUP Hangup\n2 INT Interrupt\n"
+		"2 INT Interrupt\nValue out of range.\nValue out of range.\nNo such signal.\nInvalid argument.\n"
+		"1 HUP Hangup\n1 HUP Hangup\n2 INT Interrupt\n1 HUP Hangup\n2 INT Interrupt\nInvalid argument.\n"
+		"Value out of range.\nValue out of range.\nValue out of range.\nValue out of range.\nValue out of range.\n"
+		"1 HUP Hangup\n2 INT Interrupt\n";
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	EXPECT_EQ(expected, run_queries("2\n1 HUP Hangup\n2 INT Interrupt\n", queries, false));
+	EXPECT_EQ(expected, run_queries("2\n1 HUP Hangup\n2 INT Interrupt\n", queries, true));
+
+	/* a text search reads on to the end of its line */
+	std::string search_queries = "/hangup\n/\"INTERRUPT\"\n/hangup interrupt\n/nothing\n/\n"
+		"/" + std::string(300, 'x') + "\n" + "/        hangup";
+	std::string search_expected = "1 HUP Hangup\n2 INT Interrupt\nNo such signal.\nNo such signal.\n"
+		"Invalid argument.\nNo such signal.\n";
+	/* past SEARCH_MAX the line goes on as ordinary queries */
+	for( int i = 0; i < 5; i++ ) search_expected += "Invalid argument.\n";
+	search_expected += "No such signal.\n1 HUP Hangup\n";
+	EXPECT_EQ(search_expected, run_queries("2\n1 HUP Hangup\n2 INT Interrupt\n", search_queries, false));
+	EXPECT_EQ(search_expected, run_queries("2\n1 HUP Hangup\n2 INT Interrupt\n", search_queries, true));
+
+	/* signal numbers in order, however long the query */
+	const char *nums_db = "4\n7 SEVEN Seven\n2 INT Interrupt\n65535 MAX Last\n2 TWO Again\n";
+	std::string nums_queries = "#2\n#1-7\n#>=7\n#>7\n#<7\n#<=1\n#<0\n#7-2\n#0-65535\n#65536\n"
+		"#x\n#\n#2 \n#2x\n# 2\n#00000000000000000002\n";
+	std::string nums_expected = "2 INT Interrupt\n2 TWO Again\n"
+		"2 INT Interrupt\n2 TWO Again\n7 SEVEN Seven\n"
+		"7 SEVEN Seven\n65535 MAX Last\n"
+		"65535 MAX Last\n"
+		"2 INT Interrupt\n2 TWO Again\n"
+		"No such signal.\nNo such signal.\nInvalid argument.\n"
+		"2 INT Interrupt\n2 TWO Again\n7 SEVEN Seven\n65535 MAX Last\n"
+		"Value out of range.\nInvalid argument.\nInvalid argument.\n"
+		"2 INT Interrupt\n2 TWO Again\nInvalid argument.\nInvalid argument.\n"
+		"2 INT Interrupt\n2 TWO Again\n";
+	EXPECT_EQ(nums_expected, run_queries(nums_db, nums_queries, false));
+	EXPECT_EQ(nums_expected, run_queries(nums_db, nums_queries, true));
+
+	/* stops at 'q', a partial last line is still answered */
+	EXPECT_EQ("2 INT Interrupt\n", run_queries("2\n1 HUP Hangup\n2 INT Interrupt\n", "1\nq\n0\n", true));
+	EXPECT_EQ("1 HUP Hangup\n", run_queries("2\n1 HUP Hangup\n2 INT Interrupt\n", "0", true));
+
+	std::string many;
+	for( int i = 0; i < 300000; i++ ) many += i % 3 ? "1\n" : "HUP\n";
+	EXPECT_EQ(run_queries("2\n1 HUP Hangup\n2 INT Interrupt\n", many, false),
+		run_queries("2\n1 HUP Hangup\n2 INT Interrupt\n", many, true));
+}
+
+static int collect_match( void *arg, size_t rec )
+{
+	((std::vector<size_t> *)arg)->push_back(rec);
+	return 0;
+}
+
+static std::vector<size_t> search( const struct sigtable *tab, const char *query )
+{
+	std::vector<size_t> recs;
+	ssize_t n = sigtable_search(tab, query, strlen(query), collect_match, &recs);
+
+	if( n < 0 ) return std::vector<size_t>(1, SIZE_MAX);
+	EXPECT_EQ((size_t)n, recs.size());
+	return recs;
+}
+
+TEST(sigtext_index, test_search)
+{
+	struct sigtable *tab;
+	FILE *fh = writestr("6\n"
+		"1 HUP Hangup detected on controlling terminal\n"
+		"2 INT Interrupt from keyboard\n"
+		"3 FPE Floating-point exception\n"
+		"4 TTIN Terminal input for background process\n"
+		"5 X point floating, floating point\n"
+		"6 Y terminal terminal TERMINAL\n");
+
+	ASSERT_TRUE( NULL != fh );
+	fclose(fh);
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	tab = sigtable_open("test.tmp");
+	ASSERT_TRUE( NULL != tab );
+	ASSERT_EQ(0, sigtable_index_text(tab));
+	ASSERT_EQ(0, sigtable_index_text(tab));
+
+	EXPECT_EQ(std::vector<size_t>({0, 3, 5}), search(tab, "terminal"));
+	EXPECT_EQ(std::vector<size_t>({0, 3, 5}), search(tab, "TeRmInAl"));
+	EXPECT_EQ(std::vector<size_t>({0}), search(tab, "terminal hangup"));
+	EXPECT_EQ(std::vector<size_t>({2, 4}), search(tab, "point floating"));
+	EXPECT_EQ(std::vector<size_t>({2, 4}), search(tab, "\"floating point\""));
+	EXPECT_EQ(std::vector<size_t>({4}), search(tab, "\"point floating\""));
+	EXPECT_EQ(std::vector<size_t>({3}), search(tab, "\"terminal input\" ignored after the quote"));
+	EXPECT_EQ(std::vector<size_t>({1}), search(tab, "\"keyboard"));
+	EXPECT_EQ(std::vector<size_t>(), search(tab, "terminal keyboard"));
+	EXPECT_EQ(std::vector<size_t>(), search(tab, "termina"));
+	EXPECT_EQ(std::vector<size_t>(), search(tab, "HUP"));
+	EXPECT_EQ(std::vector<size_t>(1, SIZE_MAX), search(tab, " -- "));
+	EXPECT_EQ(EINVAL, errno);
+	EXPECT_EQ(std::vector<size_t>(1, SIZE_MAX), search(tab, "a b c d e f g h i j k l m n o p q"));
+
+	/* every term once per record */
+	EXPECT_EQ(tab->text.npostings, tab->text.terms[tab->text.nterms - 1].end);
+	sigtable_close(tab);
+}
+
+TEST(sigtext_index, test_random)
+{
+	static const char *const vocab[] = { "alpha", "beta", "gamma", "delta", "ALPHA", "x", "7" };
+	std::string db = "3000\n";
+	std::vector<std::vector<std::string>> words(3000);
+	struct sigtable *tab;
+	unsigned seed = 1;
+
+	for( size_t i = 0; i < words.size(); i++ )
+	{
+		db += std::to_string(i % 100) + " N ";
+		for( size_t w = rand_r(&seed) % 12; w > 0; w-- )
+		{
+			std::string word = vocab[rand_r(&seed) % 7];
+			db += word + (rand_r(&seed) % 2 ? " " : ", ");
+			for( char &c : word ) c = (char)tolower((unsigned char)c);
+			words[i].push_back(word);
+		}
+		db += "\n";
+	}
+
+	FILE *fh = writestr(db.c_str());
+	ASSERT_TRUE( NULL != fh );
+	fclose(fh);
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	tab = sigtable_open("test.tmp");
+	ASSERT_TRUE( NULL != tab );
+	ASSERT_EQ(0, sigtable_index_text(tab));
+
+	for( int round = 0; round < 300; round++ )
+	{
+		bool phrase = round % 2;
+		std::vector<std::string> query;
+		std::string text = phrase ? "\"" : "";
+		std::vector<size_t> expected;
+
+		for( size_t w = 1 + rand_r(&seed) % 3; w > 0; w-- )
+		{
+			query.push_back(vocab[rand_r(&seed) % 4]);
+			text += query.back() + " ";
+		}
+
+		for( size_t i = 0; i < words.size(); i++ )
+		{
+			const std::vector<std::string> &desc = words[i];
+			bool hit = false;
+
+			for( size_t at = 0; !hit && at + query.size() <= desc.size(); at++ )
+			{
+				hit = std::equal(query.begin(), query.end(), desc.begin() + at);
+			}
+			if( !phrase )
+			{
+				hit = true;
+				for( const std::string &q : query ) hit = hit && std::find(desc.begin(), desc.end(), q) != desc.end();
+			}
+			if( hit ) expected.push_back(i);
+		}
+
+		EXPECT_EQ(expected, search(tab, text.c_str())) << text;
+	}
+	sigtable_close(tab);
+}
+
+TEST(sigpack, test_matches_open)
+{
+	struct siggen_opts opts;
+	struct sigtable *tab, *packed;
+	struct sigview view, want;
+	const uint32_t *recs, *packed_recs;
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	for( int variant = 0; variant < 4; variant++ )
+	{
+		siggen_defaults(&opts);
+		opts.count = variant == 3 ? 1 : 20000;
+		opts.seed = (uint64_t)variant + 1;
+		opts.short_bias = variant == 1;
+		opts.crlf = variant == 2;
+		FILE *fh = writestr(generate(opts).c_str());
+		ASSERT_TRUE( NULL != fh );
+		fclose(fh);
+
+		tab = sigtable_open("test.tmp");
+		ASSERT_TRUE( NULL != tab );
+		sigpack_on_load = true;
+		packed = sigtable_open("test.tmp");
+		sigpack_on_load = false;
+		ASSERT_TRUE( NULL != packed );
+		ASSERT_TRUE( NULL != packed->pack );
+		EXPECT_TRUE( NULL == packed->map );
+		EXPECT_EQ(0, sigtable_pack(packed));
+		ASSERT_EQ(tab->size, packed->size);
+		if( variant != 3 )
+		{
+			EXPECT_LT(packed->arena_len * 2, packed->pack->text_len);
+		}
+
+		for( size_t i = 0; i < tab->size; i++ )
+		{
+			ASSERT_TRUE( NULL != sigtable_get(tab, i, &want) );
+			ASSERT_TRUE( NULL != sigtable_get(packed, i, &view) ) << i;
+			EXPECT_EQ(want.signum, view.signum);
+			ASSERT_EQ(std::string(want.name, want.name_len), std::string(view.name, view.name_len));
+			ASSERT_EQ(std::string(want.desc, want.desc_len), std::string(view.desc, view.desc_len));
+		}
+		EXPECT_TRUE( NULL == sigtable_get(packed, tab->size, &view) );
+
+		/* indexes of a packed table find the same records */
+		ASSERT_EQ(0, sigtable_index(tab));
+		ASSERT_EQ(0, sigtable_index(packed));
+		ASSERT_TRUE( NULL != sigtable_get(tab, tab->size / 2, &want) );
+		size_t n = sigtable_find_name(tab, want.name, want.name_len, &recs);
+		ASSERT_EQ(n, sigtable_find_name(packed, want.name, want.name_len, &packed_recs));
+		EXPECT_EQ(std::vector<uint32_t>(recs, recs + n), std::vector<uint32_t>(packed_recs, packed_recs + n));
+		EXPECT_EQ(search(tab, "signal"), search(packed, "signal"));
+		EXPECT_EQ(search(tab, "\"on controlling\""), search(packed, "\"on controlling\""));
+
+		sigtable_close(packed);
+		sigtable_close(tab);
+	}
+
+	/* codes out of range are an error, not garbage */
+	FILE *fh = writestr("2\n1 HUP Hangup\n2 INT Interrupt\n");
+	ASSERT_TRUE( NULL != fh );
+	fclose(fh);
+	packed = sigtable_open("test.tmp");
+	ASSERT_TRUE( NULL != packed );
+	ASSERT_EQ(0, sigtable_pack(packed));
+	ASSERT_LT(packed->pack->nsymbols, (size_t)SIGPACK_ESCAPE - 1);
+	((char *)packed->arena)[packed->hot[1].off] = (char)(SIGPACK_ESCAPE - 1);
+	errno = 0;
+	EXPECT_TRUE( NULL == sigtable_get(packed, 1, &view) );
+	EXPECT_EQ(EINVAL, errno);
+	ASSERT_TRUE( NULL != sigtable_get(packed, 0, &view) );
+	EXPECT_EQ("HUP Hangup", std::string(view.name, view.name_len) + " " + std::string(view.desc, view.desc_len));
+	sigtable_close(packed);
+
+	/* the same answers, packed or not */
+	std::string queries = "0\n1\nhup\nI*\n*\n/hangup\n/\"INTERRUPT\"\n#1-2\n3\nx\n";
+	std::string expected = run_queries("2\n1 HUP Hangup\n2 INT Interrupt\n", queries, true);
+	sigpack_on_load = true;
+	EXPECT_EQ(expected, run_queries("2\n1 HUP Hangup\n2 INT Interrupt\n", queries, true));
+	EXPECT_EQ(expected, run_queries("2\n1 HUP Hangup\n2 INT Interrupt\n", queries, false));
+	sigpack_on_load = false;
+
+	/* images and bounded tables are not packed */
+	tab = compile_image("2\n1 ABC DESC\n2 XYZ BLAH\n");
+	ASSERT_TRUE( NULL != tab );
+	errno = 0;
+	EXPECT_EQ(-1, sigtable_pack(tab));
+	EXPECT_EQ(ENOTSUP, errno);
+	sigtable_close(tab);
+	tab = sigtable_open_bounded("test.tmp", 1);
+	ASSERT_TRUE( NULL != tab );
+	errno = 0;
+	EXPECT_EQ(-1, sigtable_pack(tab));
+	EXPECT_EQ(ENOTSUP, errno);
+	sigtable_close(tab);
+}
+
+TEST(sigrender, test_matches_format)
+{
+	struct siggen_opts opts;
+	struct sigtable *tab;
+	struct sigview view;
+	char expected[256];
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	siggen_defaults(&opts);
+	opts.count = 5000;
+	opts.crlf = true;
+	std::string db = generate(opts);
+
+	/* every line as printf() prints it, packed or not */
+	for( bool pack : { false, true } )
+	{
+		FILE *fh = writestr(db.c_str());
+		ASSERT_TRUE( NULL != fh );
+		fclose(fh);
+
+		sigpack_on_load = pack;
+		sigrender_on_load = true;
+		tab = sigtable_open("test.tmp");
+		sigrender_on_load = false;
+		sigpack_on_load = false;
+		ASSERT_TRUE( NULL != tab );
+		ASSERT_TRUE( NULL != tab->render.off );
+		EXPECT_EQ(0, sigtable_render(tab));
+		for( size_t i = 0; i < tab->size; i++ )
+		{
+			ASSERT_TRUE( NULL != sigtable_get(tab, i, &view) );
+			int n = snprintf(expected, sizeof(expected), "%d %.*s %.*s\n", view.signum,
+				(int)view.name_len, view.name, (int)view.desc_len, view.desc);
+			ASSERT_EQ(std::string(expected, (size_t)n), std::string(tab->render.lines + tab->render.off[i],
+				(size_t)(tab->render.off[i + 1] - tab->render.off[i]))) << i;
+		}
+		sigtable_close(tab);
+	}
+
+	/* and the same answers */
+	std::string queries;
+	unsigned seed = 1;
+	for( int i = 0; i < 2000; i++ )
+	{
+		queries += i % 3 == 0 ? std::to_string(rand_r(&seed) % 6000) + "\n" : i % 3 == 1 ? "A*\n" : "#7-9\n";
+	}
+	std::string batch = run_queries(db.c_str(), queries, true);
+	std::string interactive = run_queries(db.c_str(), queries, false);
+	sigrender_on_load = true;
+	EXPECT_EQ(batch, run_queries(db.c_str(), queries, true));
+	EXPECT_EQ(interactive, run_queries(db.c_str(), queries, false));
+	sigrender_on_load = false;
+
+	/* a bounded table is not rendered */
+	tab = sigtable_open_bounded("test.tmp", 1);
+	ASSERT_TRUE( NULL != tab );
+	errno = 0;
+	EXPECT_EQ(-1, sigtable_render(tab));
+	EXPECT_EQ(ENOTSUP, errno);
+	sigtable_close(tab);
+}
+
+/* Collects what sigtable_get_batch() hands out as "k signum name desc" lines, stopping after stop_at */
+struct batch_lines {
+	std::string lines;
+	size_t stop_at;
+};
+
+static int collect_batch( void *arg, size_t k, const struct sigview *rec )
+{
+	struct batch_lines *got = (struct batch_lines *)arg;
+
+	got->lines += std::to_string(k) + (rec ? " " + std::to_string(rec->signum) + " " + std::string(rec->name, rec->name_len)
+		+ " " + std::string(rec->desc, rec->desc_len) : " -") + "\n";
+	return k == got->stop_at;
+}
+
+TEST(sigprefetch, test_batch_matches_get)
+{
+	struct siggen_opts opts;
+	struct sigview view;
+	unsigned seed = 7;
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	siggen_defaults(&opts);
+	opts.count = 3000;
+	std::string db = generate(opts);
+	FILE *fh = writestr(db.c_str());
+	ASSERT_TRUE( NULL != fh );
+	fclose(fh);
+
+	std::vector<size_t> idx;
+	for( int i = 0; i < 5000; i++ ) idx.push_back(i % 50 == 0 ? 3000 + rand_r(&seed) % 10 : rand_r(&seed) % 3000);
+	idx.push_back(SIZE_MAX);
+
+	/* the same records as one sigtable_get() after the other, whatever the table and distance */
+	for( int kind = 0; kind < 4; kind++ )
+	{
+		sigpack_on_load = kind == 1;
+		sigrender_on_load = kind == 2;
+		struct sigtable *tab = kind == 3 ? sigtable_open_bounded("test.tmp", 1) : sigtable_open("test.tmp");
+		sigpack_on_load = false;
+		sigrender_on_load = false;
+		ASSERT_TRUE( NULL != tab );
+
+		struct batch_lines expected = { "", SIZE_MAX };
+		for( size_t k = 0; k < idx.size(); k++ ) collect_batch(&expected, k, sigtable_get(tab, idx[k], &view));
+
+		for( unsigned distance : { 0u, 1u, (unsigned)SIGPREFETCH_DISTANCE, 100u } )
+		{
+			struct batch_lines got = { "", SIZE_MAX };
+			sigprefetch_distance = distance;
+			EXPECT_EQ((ssize_t)idx.size(), sigtable_get_batch(tab, idx.data(), idx.size(), collect_batch, &got));
+			EXPECT_EQ(expected.lines, got.lines) << kind << " " << distance;
+
+			/* stops where the callback asks to */
+			struct batch_lines stopped = { "", 17 };
+			EXPECT_EQ(-1, sigtable_get_batch(tab, idx.data(), idx.size(), collect_batch, &stopped));
+			EXPECT_EQ(expected.lines.substr(0, stopped.lines.size()), stopped.lines);
+			EXPECT_EQ(18, std::count(stopped.lines.begin(), stopped.lines.end(), '\n'));
+		}
+		sigprefetch_distance = SIGPREFETCH_DISTANCE;
+		EXPECT_EQ(0, sigtable_get_batch(tab, idx.data(), 0, collect_batch, NULL));
+		sigtable_close(tab);
+	}
+
+	/* grouped batch answers are those of one query at a time, up to a 'q' inside a group */
+	std::string queries;
+	for( int i = 0; i < 3000; i++ )
+	{
+		queries += i % 7 == 0 ? "HUP\n" : i % 11 == 0 ? "#1-3\n" : i % 13 == 0 ? "/a\n"
+			: std::to_string(rand_r(&seed) % 3100) + "\n";
+	}
+	std::string interactive = run_queries(db.c_str(), queries, false);
+	std::string quit = queries.substr(0, 30) + "q\n" + queries;
+	std::string quit_expected = run_queries(db.c_str(), quit, false);
+	for( unsigned distance : { 0u, 1u, (unsigned)SIGPREFETCH_DISTANCE, (unsigned)SIGPREFETCH_MAX } )
+	{
+		sigprefetch_distance = distance;
+		EXPECT_EQ(interactive, run_queries(db.c_str(), queries, true)) << distance;
+		EXPECT_EQ(quit_expected, run_queries(db.c_str(), quit, true)) << distance;
+	}
+	sigprefetch_distance = SIGPREFETCH_DISTANCE;
+}
+
+/* What sigtable_export() writes, "error" if it fails */
+static std::string export_string( const struct sigtable *tab, size_t first, size_t end, enum sigexport_format format )
+{
+	int fd = open("test.out", O_RDWR | O_CREAT | O_TRUNC, 0644);
+	int ret;
+
+	if( fd < 0 ) return "error";
+	ret = sigtable_export(tab, first, end, format, fd);
+	close(fd);
+	return ret == 0 ? read_file("test.out") : "error";
+}
+
+TEST(sigexport, test_formats)
+{
+	struct siggen_opts opts;
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	FILE *fh = writestr("4\n1 HUP Hangup\n2 INT Say \"stop\", or \\ not\t!\n15 TERM Terminated\n2 A,B \n");
+	ASSERT_TRUE( NULL != fh );
+	fclose(fh);
+	struct sigtable *tab = sigtable_open("test.tmp");
+	ASSERT_TRUE( NULL != tab );
+
+	EXPECT_EQ("1 HUP Hangup\n2 INT Say \"stop\", or \\ not\t!\n15 TERM Terminated\n2 A,B \n",
+		export_string(tab, 0, SIZE_MAX, SIGEXPORT_LINE));
+	EXPECT_EQ("{\"index\":0,\"signum\":1,\"name\":\"HUP\",\"description\":\"Hangup\"}\n"
+		"{\"index\":1,\"signum\":2,\"name\":\"INT\",\"description\":\"Say \\\"stop\\\", or \\\\ not\\u0009!\"}\n"
+		"{\"index\":2,\"signum\":15,\"name\":\"TERM\",\"description\":\"Terminated\"}\n"
+		"{\"index\":3,\"signum\":2,\"name\":\"A,B\",\"description\":\"\"}\n",
+		export_string(tab, 0, SIZE_MAX, SIGEXPORT_JSONL));
+	EXPECT_EQ("index,signum,name,description\r\n0,1,HUP,Hangup\r\n1,2,INT,\"Say \"\"stop\"\", or \\ not\t!\"\r\n"
+		"2,15,TERM,Terminated\r\n3,2,\"A,B\",\r\n",
+		export_string(tab, 0, SIZE_MAX, SIGEXPORT_CSV));
+
+	/* bytes that are not well-formed UTF-8 are escaped in JSON, well-formed sequences are kept */
+	write_file("test.utf", "2\n1 HUP Caf\351 bad, caf\303\251 good\n"
+		"2 INT \300\257 overlong \355\240\200 surrogate \360\237\230\200 cut \342\202\n");
+	struct sigtable *utf = sigtable_open("test.utf");
+	ASSERT_TRUE( NULL != utf );
+	EXPECT_EQ("{\"index\":0,\"signum\":1,\"name\":\"HUP\",\"description\":\"Caf\\u00e9 bad, caf\303\251 good\"}\n"
+		"{\"index\":1,\"signum\":2,\"name\":\"INT\",\"description\":\"\\u00c0\\u00af overlong "
+		"\\u00ed\\u00a0\\u0080 surrogate \360\237\230\200 cut \\u00e2\\u0082\"}\n",
+		export_string(utf, 0, SIZE_MAX, SIGEXPORT_JSONL));
+	sigtable_close(utf);
+	EXPECT_EQ(0, unlink("test.utf"));
+
+	/* ranges are cut to the table */
+	EXPECT_EQ("15 TERM Terminated\n", export_string(tab, 2, 3, SIGEXPORT_LINE));
+	EXPECT_EQ("15 TERM Terminated\n2 A,B \n", export_string(tab, 2, 100, SIGEXPORT_LINE));
+	EXPECT_EQ("", export_string(tab, 5, 9, SIGEXPORT_JSONL));
+	EXPECT_EQ("index,signum,name,description\r\n", export_string(tab, 3, 1, SIGEXPORT_CSV));
+	errno = 0;
+	EXPECT_EQ(-1, sigtable_export(tab, 0, SIZE_MAX, (enum sigexport_format)7, STDOUT_FILENO));
+	EXPECT_EQ(EINVAL, errno);
+
+	/* rendered lines are spliced into a pipe and stay there after the table is gone */
+	int fds[2];
+	ASSERT_EQ(0, pipe(fds));
+	ASSERT_EQ(0, sigtable_render(tab));
+	EXPECT_EQ(0, sigtable_export(tab, 1, 3, SIGEXPORT_LINE, fds[1]));
+	close(fds[1]);
+	sigtable_close(tab);
+	char buf[256];
+	ssize_t n = read(fds[0], buf, sizeof(buf));
+	close(fds[0]);
+	EXPECT_EQ("2 INT Say \"stop\", or \\ not\t!\n15 TERM Terminated\n", std::string(buf, n > 0 ? (size_t)n : 0));
+
+	/* every kind of table exports the same, the lines as the queries for all indexes answer them */
+	siggen_defaults(&opts);
+	opts.count = 3000;
+	std::string db = generate(opts);
+	std::string queries;
+	for( int i = 0; i < 3000; i++ ) queries += std::to_string(i) + "\n";
+	std::string answers = run_queries(db.c_str(), queries, true);
+	std::string jsonl, csv;
+
+	for( int kind = 0; kind < 4; kind++ )
+	{
+		fh = writestr(db.c_str());
+		ASSERT_TRUE( NULL != fh );
+		fclose(fh);
+		sigpack_on_load = kind == 1;
+		sigrender_on_load = kind == 2;
+		tab = kind == 3 ? sigtable_open_bounded("test.tmp", 1) : sigtable_open("test.tmp");
+		sigpack_on_load = false;
+		sigrender_on_load = false;
+		ASSERT_TRUE( NULL != tab );
+
+		EXPECT_EQ(answers, export_string(tab, 0, SIZE_MAX, SIGEXPORT_LINE)) << kind;
+		if( kind == 0 )
+		{
+			jsonl = export_string(tab, 0, SIZE_MAX, SIGEXPORT_JSONL);
+			csv = export_string(tab, 0, SIZE_MAX, SIGEXPORT_CSV);
+			EXPECT_EQ(3000, std::count(jsonl.begin(), jsonl.end(), '\n'));
+			EXPECT_EQ(3001, std::count(csv.begin(), csv.end(), '\n'));
+		}
+		EXPECT_EQ(jsonl, export_string(tab, 0, SIZE_MAX, SIGEXPORT_JSONL)) << kind;
+		EXPECT_EQ(csv, export_string(tab, 0, SIZE_MAX, SIGEXPORT_CSV)) << kind;
+		sigtable_close(tab);
+	}
+}
+
+static std::vector<size_t> find_signums( const struct sigtable *tab, unsigned lo, unsigned hi )
+{
+	std::vector<size_t> recs;
+
+	EXPECT_LE(0, sigtable_find_signums(tab, lo, hi, collect_match, &recs));
+	return recs;
+}
+
+TEST(signum_index, test_random)
+{
+	struct siggen_opts opts;
+	unsigned seed = 1;
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	siggen_defaults(&opts);
+	opts.sparse = true;
+
+	/* every shape of the top of the tree, then a large sparse table */
+	for( uint64_t count : { 1, 2, 3, 4, 5, 7, 8, 9, 15, 16, 17, 31, 32, 33, 100, 20000 } )
+	{
+		struct sigtable *tab;
+		std::vector<std::pair<unsigned, size_t>> sorted;
+
+		opts.count = count;
+		opts.seed = count;
+		FILE *fh = writestr(generate(opts).c_str());
+		ASSERT_TRUE( NULL != fh );
+		fclose(fh);
+		tab = sigtable_open("test.tmp");
+		ASSERT_TRUE( NULL != tab );
+
+		/* not indexed yet, nothing is collected */
+		std::vector<size_t> unindexed;
+		errno = 0;
+		EXPECT_EQ(-1, sigtable_find_signums(tab, 0, USHRT_MAX, collect_match, &unindexed));
+		EXPECT_EQ(EINVAL, errno);
+		EXPECT_TRUE(unindexed.empty());
+		ASSERT_EQ(0, sigtable_index_signums(tab));
+
+		for( size_t i = 0; i < tab->size; i++ ) sorted.push_back(std::make_pair((unsigned)tab->hot[i].signum, i));
+		std::sort(sorted.begin(), sorted.end());
+
+		for( int q = 0; q < 200; q++ )
+		{
+			/* mostly around signal numbers that exist, some anywhere */
+			unsigned lo = q % 4 ? sorted[(size_t)rand_r(&seed) % sorted.size()].first : (unsigned)rand_r(&seed) % 65536;
+			unsigned hi = lo + (q % 3 ? (unsigned)rand_r(&seed) % 2000 : 0);
+			std::vector<size_t> expected;
+
+			if( q % 5 == 0 && lo > 0 ) lo--;
+			if( hi > USHRT_MAX ) hi = USHRT_MAX;
+			for( const auto &rec : sorted )
+			{
+				if( rec.first >= lo && rec.first <= hi ) expected.push_back(rec.second);
+			}
+			EXPECT_EQ(expected, find_signums(tab, lo, hi)) << lo << "-" << hi;
+		}
+		EXPECT_EQ(tab->size, find_signums(tab, 0, USHRT_MAX).size());
+		EXPECT_EQ(0u, find_signums(tab, 5, 4).size());
+		EXPECT_EQ(0u, find_signums(tab, USHRT_MAX + 1, UINT_MAX).size());
+		sigtable_close(tab);
+	}
+}
+
+/* The records of \p range as "signum name desc" lines */
+template <class Range> static std::string record_lines( const Range &range )
+{
+	std::string lines;
+
+	for( const SigDb::Record &rec : range )
+	{
+		lines += std::to_string(rec.signum) + " " + std::string(rec.name) + " " + std::string(rec.desc) + "\n";
+	}
+	return lines;
+}
+
+TEST(sigdb, test_matches_table)
+{
+	struct siggen_opts opts;
+	struct sigview view;
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	siggen_defaults(&opts);
+	opts.count = 20000;
+	opts.sparse = true;
+	opts.short_bias = true;
+	std::string db = generate(opts);
+	FILE *fh = writestr(db.c_str());
+	ASSERT_TRUE( NULL != fh );
+	fclose(fh);
+
+	struct sigtable *tab = sigtable_open("test.tmp");
+	ASSERT_TRUE( NULL != tab );
+	ASSERT_EQ(0, sigtable_index(tab));
+	std::string lines = table_lines(tab);
+
+	/* the same records however the database is loaded, packed ones decoded */
+	for( int how = 0; how < 4; how++ )
+	{
+		sigpack_on_load = how == 3;
+		std::unique_ptr<SigDb> sdb = how == 0 ? SigDb::open("test.tmp") : how == 1 ? SigDb::load("test.tmp")
+			: SigDb::parse(db);
+		sigpack_on_load = false;
+		ASSERT_TRUE( nullptr != sdb ) << how;
+		ASSERT_EQ(tab->size, sdb->size());
+		EXPECT_EQ(lines, record_lines(*sdb)) << how;
+
+		for( size_t i = 0; i < tab->size; i += 97 )
+		{
+			const uint32_t *recs;
+			ASSERT_TRUE( NULL != sigtable_get(tab, i, &view) );
+			std::string name(view.name, view.name_len);
+
+			SigDb::Range by_num = sdb->find(view.signum);
+			std::vector<size_t> nums;
+			for( const SigDb::Record &rec : by_num ) nums.push_back(rec.index);
+			EXPECT_EQ(find_signums(tab, view.signum, view.signum), nums);
+
+			SigDb::Range by_name = sdb->find(std::string_view(name));
+			ASSERT_EQ(sigtable_find_name(tab, name.data(), name.size(), &recs), by_name.size());
+			for( size_t k = 0; k < by_name.size(); k++ ) EXPECT_EQ(recs[k], by_name[k].index);
+			EXPECT_EQ(sigtable_find_prefix(tab, name.data(), 1, &recs), sdb->find_prefix(name.substr(0, 1)).size());
+		}
+		EXPECT_TRUE(sdb->find(65536u).empty());
+		EXPECT_TRUE(sdb->find(std::string_view("TOOLONG")).empty());
+	}
+	sigtable_close(tab);
+
+	/* an image, and the records compiled into the program */
+	tab = compile_image(names_db);
+	ASSERT_TRUE( NULL != tab );
+	lines = table_lines(tab);
+	std::unique_ptr<SigDb> sdb = SigDb::adopt(tab);
+	ASSERT_TRUE( nullptr != sdb );
+	EXPECT_EQ(lines, record_lines(*sdb));
+	EXPECT_EQ("1 HUP Hangup\n3 hup Again\n", record_lines(sdb->find(std::string_view("Hup"))));
+	EXPECT_EQ(3u, sdb->find_prefix("hu").size());
+
+	tab = sigtable_attach(sigembed_hot, sigembed_size, sigembed_arena, sizeof(sigembed_arena) - 1);
+	ASSERT_TRUE( NULL != tab );
+	lines = table_lines(tab);
+	sigtable_close(tab);
+	sdb = SigDb::attach(sigembed_hot, sigembed_size, sigembed_arena, sizeof(sigembed_arena) - 1);
+	ASSERT_TRUE( nullptr != sdb );
+	EXPECT_EQ(lines, record_lines(*sdb));
+	ASSERT_EQ(1u, sdb->find(std::string_view("segv")).size());
+	EXPECT_EQ(11, sdb->find(std::string_view("segv"))[0].signum);
+
+	/* what cannot be made into one */
+	errno = 0;
+	EXPECT_TRUE( nullptr == SigDb::parse("2\n1 HUP Hangup\n") );
+	EXPECT_EQ(EINVAL, errno);
+	errno = 0;
+	EXPECT_TRUE( nullptr == SigDb::adopt(sigtable_open_bounded("test.tmp", 1)) );
+	EXPECT_EQ(ENOTSUP, errno);
+	EXPECT_TRUE( nullptr == SigDb::open("test.missing") );
+
+	/* strings are kept whole, NUL bytes included, packed or not */
+	const char nul_db[] = "3\n1 HUP Ha\0ngup\n2 INT Interrupt\n3 Q\0T Last\0\n";
+	std::string with_nul(nul_db, sizeof(nul_db) - 1);
+	sdb = SigDb::parse(with_nul);
+	ASSERT_TRUE( nullptr != sdb );
+	EXPECT_EQ(std::string("Ha\0ngup", 7), std::string((*sdb)[0].desc));
+	EXPECT_EQ(std::string("Q\0T", 3), std::string((*sdb)[2].name));
+	EXPECT_EQ(std::string("Last\0", 5), std::string((*sdb)[2].desc));
+	lines = record_lines(*sdb);
+	sigpack_on_load = true;
+	sdb = SigDb::parse(with_nul);
+	sigpack_on_load = false;
+	ASSERT_TRUE( nullptr != sdb );
+	ASSERT_TRUE( NULL != sdb->table()->pack );
+	EXPECT_EQ(lines, record_lines(*sdb));
+}
+
+TEST(sigdb, test_concurrent_readers)
+{
+	struct siggen_opts opts;
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	siggen_defaults(&opts);
+	opts.count = 50000;
+	std::unique_ptr<SigDb> sdb = SigDb::parse(generate(opts));
+	ASSERT_TRUE( nullptr != sdb );
+
+	/* what each thread must find, worked out up front */
+	std::vector<size_t> matches;
+	for( const SigDb::Record &rec : *sdb ) matches.push_back(sdb->find(rec.signum).size() + sdb->find(rec.name).size());
+
+	std::vector<std::thread> threads;
+	std::vector<size_t> wrong(8, 0);
+	for( size_t t = 0; t < wrong.size(); t++ )
+	{
+		threads.emplace_back([&, t]() {
+			unsigned seed = (unsigned)t + 1;
+			for( int q = 0; q < 100000; q++ )
+			{
+				size_t i = (size_t)rand_r(&seed) % sdb->size();
+				SigDb::Record rec = (*sdb)[i];
+				wrong[t] += sdb->find(rec.signum).size() + sdb->find(rec.name).size() != matches[i];
+			}
+		});
+	}
+	for( std::thread &thread : threads ) thread.join();
+	EXPECT_EQ(std::vector<size_t>(wrong.size(), 0), wrong);
+}
+
+TEST(server, test_queries)
+{
+	struct sigtable *tab;
+	struct sigrcu rcu;
+	struct intexer_client *cl[3];
+	int stop[2], listen_fd, ret = -1;
+	char resp[256];
+	FILE *fh = writestr("2\n1 HUP Hangup\n2 INT Interrupt\n");
+
+	ASSERT_TRUE( NULL != fh );
+	fclose(fh);
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	tab = sigtable_open("test.tmp");
+	ASSERT_TRUE( NULL != tab );
+	ASSERT_EQ(0, sigtable_index(tab));
+	ASSERT_EQ(0, sigrcu_init(&rcu, tab));
+
+	ASSERT_EQ(0, pipe(stop));
+	listen_fd = server_listen("test.sock");
+	ASSERT_GE(listen_fd, 0);
+	std::thread server([&]{ ret = run_server(&rcu, listen_fd, stop[0]); });
+
+	for( auto &c : cl )
+	{
+		c = intexer_client_open("test.sock");
+		ASSERT_TRUE( NULL != c );
+	}
+
+	EXPECT_EQ(13, intexer_client_query(cl[0], "0", resp, sizeof(resp)));
+	EXPECT_STREQ("1 HUP Hangup\n", resp);
+	EXPECT_EQ(16, intexer_client_query(cl[1], "int", resp, sizeof(resp)));
+	EXPECT_STREQ("2 INT Interrupt\n", resp);
+	EXPECT_EQ(29, intexer_client_query(cl[2], "*", resp, sizeof(resp)));
+	EXPECT_STREQ("1 HUP Hangup\n2 INT Interrupt\n", resp);
+	EXPECT_EQ(20, intexer_client_query(cl[0], "5", resp, sizeof(resp)));
+	EXPECT_STREQ("Value out of range.\n", resp);
+	EXPECT_EQ(16, intexer_client_query(cl[1], "/\"interrupt\"", resp, sizeof(resp)));
+	EXPECT_STREQ("2 INT Interrupt\n", resp);
+
+	/* an answer that does not fit leaves the connection in sync */
+	EXPECT_EQ(-1, intexer_client_query(cl[2], "*", resp, 10));
+	EXPECT_EQ(ENOBUFS, errno);
+	EXPECT_EQ(16, intexer_client_query(cl[2], "1", resp, sizeof(resp)));
+
+	/* many clients interleaving their requests */
+	std::vector<std::thread> clients;
+	std::vector<int> failures(8, 0);
+	for( int t = 0; t < 8; t++ )
+	{
+		clients.emplace_back([t, &failures]{
+			struct intexer_client *c = intexer_client_open("test.sock");
+			char buf[256];
+			for( int i = 0; c && i < 2000; i++ )
+			{
+				if( intexer_client_query(c, i % 2 ? "1" : "HUP", buf, sizeof(buf)) < 0
+					|| 0 != strcmp(buf, i % 2 ? "2 INT Interrupt\n" : "1 HUP Hangup\n") )
+				{
+					failures[t]++;
+				}
+			}
+			if( c == NULL ) failures[t]++;
+			intexer_client_close(c);
+		});
+	}
+	for( auto &t : clients ) t.join();
+	EXPECT_EQ(std::vector<int>(8, 0), failures);
+
+	for( auto &c : cl ) intexer_client_close(c);
+
+	ASSERT_EQ(1, write(stop[1], "", 1));
+	server.join();
+	EXPECT_EQ(0, ret);
+
+	close(listen_fd);
+	close(stop[0]);
+	close(stop[1]);
+	unlink("test.sock");
+	sigrcu_destroy(&rcu);
+}
+
+static std::string stats_text( const struct sigstats *st, bool prometheus )
+{
+	char *text = NULL;
+	size_t len = 0;
+	FILE *mem = open_memstream(&text, &len);
+	std::string result;
+
+	if( mem == NULL ) return "error";
+	if( (prometheus ? sigstats_prometheus(st, mem) : sigstats_json(st, mem)) != 0 ) result = "error";
+	fclose(mem);
+	result += std::string(text, len);
+	free(text);
+	return result;
+}
+
+TEST(sigstats, test_counters)
+{
+	struct sigstats st;
+	uint64_t count = 0;
+
+	memset(&sigstats, 0, sizeof(sigstats));
+	sigstats.enabled = true;
+	EXPECT_EQ("1 HUP Hangup\n1 HUP Hangup\n1 HUP Hangup\n1 HUP Hangup\nNo such signal.\n",
+		run_queries("2\n1 HUP Hangup\n2 INT Interrupt\n", "0\nHUP\n/hangup\n#1\nx\n", true));
+	sigstats.enabled = false;
+
+	/* nothing is counted while disabled */
+	run_queries("2\n1 HUP Hangup\n2 INT Interrupt\n", "0\n", true);
+	sigstats_snapshot(&st);
+
+	EXPECT_EQ(31u, st.bytes_read);
+	EXPECT_EQ(2u, st.records_parsed);
+	EXPECT_EQ(0u, st.records_rejected);
+	EXPECT_EQ(1u, st.queries[SIGSTATS_QUERY_INDEX]);
+	EXPECT_EQ(2u, st.queries[SIGSTATS_QUERY_NAME]);
+	EXPECT_EQ(1u, st.queries[SIGSTATS_QUERY_SEARCH]);
+	EXPECT_EQ(1u, st.queries[SIGSTATS_QUERY_SIGNUM]);
+	for( size_t i = 0; i < SIGSTATS_BUCKETS; i++ ) count += st.latency[i];
+	EXPECT_EQ(5u, count);
+	EXPECT_LT(0u, st.wall_ns[SIGSTATS_QUERIES]);
+
+	/* a record that fails to parse, the table is given up as a whole */
+	memset(&sigstats, 0, sizeof(sigstats));
+	sigstats.enabled = true;
+	EXPECT_EQ("error", run_queries("2\n1 HUP Hangup\nx INT Interrupt\n", "", true));
+	sigstats.enabled = false;
+	EXPECT_EQ(0u, sigstats.records_parsed);
+	EXPECT_EQ(1u, sigstats.records_rejected);
+
+	st = sigstats;
+	st.queries[SIGSTATS_QUERY_NAME] = 3;
+	st.latency[0] = 1;
+	st.latency[2] = 2;
+	st.latency_sum_ns = 1500;
+	std::string json = stats_text(&st, false);
+	EXPECT_NE(std::string::npos, json.find("\"queries\": { \"index\": 0, \"name\": 3, \"search\": 0, \"signum\": 0 }"));
+	EXPECT_NE(std::string::npos, json.find("\"count\": 3,\n    \"sum_ns\": 1500,"));
+	EXPECT_NE(std::string::npos, json.find("{ \"lt_ns\": 1024, \"count\": 2 }"));
+	EXPECT_NE(std::string::npos, json.find("{ \"lt_ns\": null, \"count\": 0 }"));
+
+	std::string prom = stats_text(&st, true);
+	EXPECT_NE(std::string::npos, prom.find("\nintexer_records_rejected_total 1\n"));
+	EXPECT_NE(std::string::npos, prom.find("\nintexer_queries_total{kind=\"name\"} 3\n"));
+	EXPECT_NE(std::string::npos, prom.find("\nintexer_query_duration_seconds_bucket{le=\"0.000000512\"} 1\n"));
+	EXPECT_NE(std::string::npos, prom.find("\nintexer_query_duration_seconds_bucket{le=\"0.000001024\"} 3\n"));
+	EXPECT_NE(std::string::npos, prom.find("\nintexer_query_duration_seconds_bucket{le=\"+Inf\"} 3\n"));
+	EXPECT_NE(std::string::npos, prom.find("\nintexer_query_duration_seconds_count 3\n"));
+	memset(&sigstats, 0, sizeof(sigstats));
+}
+
+TEST(sigstats, test_metrics)
+{
+	struct sockaddr_un addr;
+	int stop[2], listen_fd, ret = -1;
+
+	memset(&sigstats, 0, sizeof(sigstats));
+	sigstats.queries[SIGSTATS_QUERY_SEARCH] = 7;
+
+	ASSERT_EQ(0, pipe(stop));
+	listen_fd = server_listen("test.metrics");
+	ASSERT_GE(listen_fd, 0);
+	std::thread metrics([&]{ ret = run_metrics(listen_fd, stop[0]); });
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, "test.metrics");
+	for( int i = 0; i < 3; i++ )
+	{
+		std::string text;
+		char buf[4096];
+		ssize_t n;
+		int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+
+		ASSERT_GE(fd, 0);
+		ASSERT_EQ(0, connect(fd, (struct sockaddr *)&addr, sizeof(addr)));
+		while( (n = read(fd, buf, sizeof(buf))) > 0 ) text.append(buf, (size_t)n);
+		close(fd);
+		EXPECT_EQ(0, n);
+		EXPECT_NE(std::string::npos, text.find("\nintexer_queries_total{kind=\"search\"} 7\n"));
+		EXPECT_EQ('\n', text.empty() ? 0 : text.back());
+	}
+
+	ASSERT_EQ(1, write(stop[1], "", 1));
+	metrics.join();
+	EXPECT_EQ(0, ret);
+
+	close(listen_fd);
+	close(stop[0]);
+	close(stop[1]);
+	unlink("test.metrics");
+	memset(&sigstats, 0, sizeof(sigstats));
+}
+
+/** \brief Writes a database whose records all carry generation \p gen, so a reader can
+    tell a consistent snapshot from a torn or freed one.
+*/
+static void write_generation( const char *path, int gen, int records )
+{
+	std::string db = std::to_string(records) + "\n";
+	FILE *fh;
+
+	for( int i = 0; i < records; i++ )
+	{
+		db += std::to_string(i) + " G" + std::to_string(gen % 1000) + " generation " + std::to_string(gen) + "\n";
+	}
+
+	fh = fopen(path, "w");
+	ASSERT_TRUE( NULL != fh );
+	fputs(db.c_str(), fh);
+	fclose(fh);
+}
+
+TEST(sigrcu, test_reload_under_load)
+{
+	struct sigrcu rcu;
+	struct sigtable *tab;
+	std::vector<std::thread> readers;
+	std::vector<long> lookups(4, 0), failures(4, 0);
+	bool done = false;
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	write_generation("test.gen", 0, 1000);
+	tab = sigtable_load("test.gen");
+	ASSERT_TRUE( NULL != tab );
+	ASSERT_EQ(0, sigrcu_init(&rcu, tab));
+
+	for( int t = 0; t < 4; t++ )
+	{
+		readers.emplace_back([&, t]{
+			struct sigrcu_reader reader;
+			sigrcu_register(&rcu, &reader);
+			while( !__atomic_load_n(&done, __ATOMIC_ACQUIRE) )
+			{
+				struct sigtable *cur = sigrcu_read_lock(&rcu, &reader);
+				struct sigview first, rec;
+				size_t idx = (size_t)lookups[t] % cur->size;
+
+				if( NULL == sigtable_get(cur, 0, &first) || NULL == sigtable_get(cur, idx, &rec)
+					|| std::string(first.name, first.name_len) != std::string(rec.name, rec.name_len)
+					|| std::string(first.desc, first.desc_len) != std::string(rec.desc, rec.desc_len) )
+				{
+					failures[t]++;
+				}
+				sigrcu_read_unlock(&reader);
+				lookups[t]++;
+			}
+			sigrcu_unregister(&rcu, &reader);
+		});
+	}
+
+	/* replace the table many times while the readers keep going */
+	for( int gen = 1; gen <= 50; gen++ )
+	{
+		write_generation("test.gen", gen, 1000 + gen);
+		tab = sigtable_load("test.gen");
+		ASSERT_TRUE( NULL != tab );
+		sigrcu_publish(&rcu, tab);
+	}
+
+	__atomic_store_n(&done, true, __ATOMIC_RELEASE);
+	for( auto &t : readers ) t.join();
+
+	EXPECT_EQ(std::vector<long>(4, 0), failures);
+	for( long n : lookups ) EXPECT_GT(n, 0);
+	EXPECT_EQ(1050u, rcu.current->size);
+	sigrcu_destroy(&rcu);
+}
+
+TEST(sigrcu, test_watch)
+{
+	struct sigrcu rcu;
+	struct sigwatch watch;
+	struct sigtable *tab;
+	struct sigrcu_reader reader;
+
+	ASSERT_EQ(0, unsetenv(DATA_PATH));
+	write_generation("test.gen", 0, 10);
+	tab = sigtable_load("test.gen");
+	ASSERT_TRUE( NULL != tab );
+	ASSERT_EQ(0, sigrcu_init(&rcu, tab));
+	ASSERT_EQ(0, sigwatch_start(&watch, &rcu, "test.gen"));
+	sigrcu_register(&rcu, &reader);
+
+	/* a broken file is not published */
+	FILE *fh = fopen("test.gen", "w");
+	ASSERT_TRUE( NULL != fh );
+	fputs("3\n1 A B\n", fh);
+	fclose(fh);
+
+	/* a replacement renamed over the file is */
+	write_generation("test.gen.new", 1, 20);
+	ASSERT_EQ(0, rename("test.gen.new", "test.gen"));
+
+	for( int i = 0; i < 500 && __atomic_load_n(&watch.reloads, __ATOMIC_ACQUIRE) == 0; i++ ) usleep(10000);
+
+	/* the broken file may or may not be seen before the rename, it is never published */
+	EXPECT_EQ(1u, watch.reloads);
+	tab = sigrcu_read_lock(&rcu, &reader);
+	const uint32_t *recs;
+	EXPECT_EQ(20u, tab->size);
+	EXPECT_EQ(20u, sigtable_find_name(tab, "g1", 2, &recs));
+	sigrcu_read_unlock(&reader);
+
+	sigrcu_unregister(&rcu, &reader);
+	sigwatch_stop(&watch);
+	sigrcu_destroy(&rcu);
+}
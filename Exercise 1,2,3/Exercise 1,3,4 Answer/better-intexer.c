@@ -1,12 +1,42 @@
 /** \file Header, library and main program for intexer */
 
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
+#include <stddef.h>
 #include <stdint.h>
 #include <stdbool.h>
 #include <string.h>
 #include <limits.h>
 #include <errno.h>
+#include <ctype.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <glob.h>
+#include <unistd.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <signal.h>
+#include <sys/epoll.h>
+#include <sys/file.h>
+#include <sys/inotify.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <sys/un.h>
+#include <time.h>
+#include <linux/io_uring.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define SCAN_FIELDS_X86 1
+#endif
 
 /** \file better-intexer.h */
 
@@ -19,8 +49,10 @@
 
 #ifdef _WIN32
 const char *OS_PATH_SEP = "\\";
+const char *OS_PATH_LIST_SEP = ";";
 #else
 const char *OS_PATH_SEP = "/";
+const char *OS_PATH_LIST_SEP = ":";
 #endif
 
 struct sigrecord {
@@ -29,10 +61,438 @@ struct sigrecord {
 	char sigdesc[100];
 };
 
+/* Room for the name, a space and the description of a record, plus 8 bytes a decoder may write past them */
+#define SIGVIEW_TEXT 128
+
+/** \brief A record that points into the string arena instead of copying.
+
+    The strings are not NUL terminated; print them with "%.*s". A record of a packed
+    table is decoded into \p text and points there, so such a view is only valid
+    where it was filled in, not in a copy.
+*/
+struct sigview {
+	const char *name;
+	const char *desc;
+	unsigned short signum;
+	unsigned char name_len;
+	unsigned char desc_len;
+	char text[SIGVIEW_TEXT];
+};
+
+typedef char sigview_text_check[SIGVIEW_TEXT >= sizeof(((struct sigrecord *)0)->signame)
+	+ sizeof(((struct sigrecord *)0)->sigdesc) + 8 ? 1 : -1];
+
+#define SIGIMAGE_MAGIC "SIGIMG\0\n"
+/* First line of a manifest listing the shards of a database, see sigtable_open() */
+#define SIGSHARDS_MAGIC "#intexer-shards"
+/* The journal of a database file is the file named like it plus this */
+#define SIGJOURNAL_SUFFIX ".journal"
+/* A watched database is compacted once its journal is this large */
+#define SIGJOURNAL_COMPACT_MIN (1 << 20)
+#define SIGIMAGE_VERSION 2
+#define SIGIMAGE_BYTE_ORDER 0x01020304u
+
+/** \brief Header of a compiled database image, see sigimage_compile().
+
+    The header is followed by \p count fixed-width entries at \p table_off, the
+    string heap at \p heap_off and the name index at \p index_off, laid out as
+    described for struct signame_index. All fields are in the byte order of the
+    machine that wrote the image, which \p byte_order records.
+*/
+struct sigimage_header {
+	char magic[8];
+	uint32_t version;
+	uint32_t byte_order;
+	uint64_t count;
+	uint64_t table_off;
+	uint64_t heap_off;
+	uint64_t heap_len;
+	uint64_t index_off;
+	uint64_t index_len;
+	uint64_t name_slots;
+	uint64_t name_disp;
+	uint64_t table_sum;
+	uint64_t heap_sum;
+	uint64_t index_sum;
+	uint64_t header_sum;
+};
+
+/** \brief Compact record holding only the fields a lookup touches first.
+
+    The name starts at \p off in the string arena and the description follows the
+    byte after the name, which is the separating space in a text database and a NUL
+    in an image heap. Four records share a cache line, where a struct sigrecord
+    spans two or three. This is also the entry format of the image table.
+*/
+struct sighot {
+	uint64_t off;
+	uint16_t signum;
+	uint8_t name_len;
+	uint8_t desc_len;
+	uint32_t reserved;
+};
+
+typedef char sighot_size_check[sizeof(struct sighot) == 16 ? 1 : -1];
+
+/* Longest signal name, names are packed into a 64-bit key by name_key() */
+#define SIGNAME_MAX (sizeof(((struct sigrecord *)0)->signame) - 1)
+
+typedef char signame_max_check[SIGNAME_MAX <= 7 ? 1 : -1];
+
+/** \brief A distinct name and the run of records in key order that carry it. */
+struct signame_slot {
+	uint64_t key;
+	uint32_t pos;
+	uint32_t count;
+};
+
+/** \brief Case-insensitive index over signal names.
+
+    \p keys holds the name key of every record in sorted order and \p order the
+    matching record numbers, so all records sharing a name or a name prefix form one
+    contiguous run. \p slots maps each distinct key to its run. When \p disp is set
+    the slots form a minimal perfect hash, otherwise an open-addressing table.
+
+    The arrays are laid out back to back in one block, which is also how a compiled
+    image stores them: keys, order padded to 8 bytes, slots, then disp.
+*/
+struct signame_index {
+	const uint64_t *keys;
+	const uint32_t *order;
+	const struct signame_slot *slots;
+	const int32_t *disp;
+	size_t nslots;
+	size_t ndisp;
+	void *mem;
+	size_t mem_len;
+};
+
+/** \brief A term of a struct sigtext_index.
+
+    The word itself is not stored, \p rec and \p off locate its first occurrence in a
+    description. \p end is where its posting list ends.
+*/
+struct sigtext_term {
+	uint64_t hash;
+	uint64_t end;
+	uint32_t rec;
+	uint8_t off;
+	uint8_t len;
+};
+
+/** \brief Inverted index over the words of the descriptions.
+
+    A word is a run of ASCII letters and digits, compared ignoring case. \p slots is an
+    open-addressing table of term numbers + 1 into \p terms. The records containing
+    term t are postings[terms[t - 1].end] up to postings[terms[t].end], ascending and
+    each once.
+*/
+struct sigtext_index {
+	uint32_t *slots;
+	size_t nslots;
+	struct sigtext_term *terms;
+	size_t nterms;
+	uint32_t *postings;
+	size_t npostings;
+};
+
+/** \brief Signal numbers in sorted order, searched in Eytzinger layout.
+
+    \p eytz holds the signal numbers of all records as an implicit binary search tree
+    in breadth-first order from eytz[1], so the first levels of every search share
+    cache lines and the next levels can be prefetched. \p rank maps a node to its
+    position in sorted order and \p order lists the records by signal number, records
+    with the same number in database order. All three live in \p mem.
+*/
+struct signum_index {
+	const uint16_t *eytz;
+	const uint32_t *rank;
+	const uint32_t *order;
+	size_t n;
+	void *mem;
+	size_t mem_len;
+};
+
+/* Records per page of a struct sigpager */
+#define SIGPAGE_RECORDS 64
+
+/** \brief A cached page of a struct sigpager: the text of its records as read, and their parsed form. */
+struct sigpage {
+	uint64_t page;
+	struct sigpage *newer;
+	struct sigpage *older;
+	struct sigpage *chain;
+	size_t len;
+	char *data;
+	struct sighot hot[SIGPAGE_RECORDS];
+};
+
+/** \brief Records of a text database read on demand into an LRU cache of pages.
+
+    The file is parsed once to note where every page of SIGPAGE_RECORDS records
+    starts, and that index is all that is kept of it. Looking up a page that is not
+    cached reads it with one pread() and then evicts the least recently used pages
+    until the cache fits in \p budget bytes again.
+*/
+struct sigpager {
+	int fd;
+	size_t size;
+	uint64_t *page_off;
+	size_t npages;
+	size_t budget;
+	size_t resident;
+	struct sigpage **buckets;
+	size_t nbuckets;
+	struct sigpage *newest;
+	struct sigpage *oldest;
+	uint64_t hits;
+	uint64_t misses;
+	uint64_t evictions;
+};
+
+/* Flags of a struct sigregion */
+#define SIGREGION_THP 1u
+#define SIGREGION_HUGETLB 2u
+
+/** \brief A mapping of a struct sigregion, its header sits at the start. */
+struct sigregion_block {
+	struct sigregion_block *next;
+	size_t len;
+	bool hugetlb;
+};
+
+/** \brief Bump allocator for everything one loaded database allocates.
+
+    Memory is handed out from mapped blocks in order and only given back all at once,
+    by sigregion_free(). A block that fills up is followed by one at least as large as
+    all before it, so even a large database takes only a few mappings. Blocks of a
+    huge page or more are aligned for transparent huge pages and advised to use them
+    with SIGREGION_THP, and come from the MAP_HUGETLB pool while it lasts with
+    SIGREGION_HUGETLB. Memory is zero when handed out.
+*/
+struct sigregion {
+	struct sigregion_block *blocks;
+	char *pos;
+	char *end;
+	size_t mapped;
+	size_t used;
+	unsigned flags;
+};
+
+/* Symbols of a struct sigpack, and the code that escapes a literal byte */
+#define SIGPACK_SYMBOLS 255
+#define SIGPACK_ESCAPE 255
+
+/** \brief Static symbol table the strings of a packed table are compressed with, FSST style.
+
+    A code below \p nsymbols stands for the first \p len[code] bytes of \p symbol[code],
+    1 to 8 of them, and SIGPACK_ESCAPE for the byte that follows it. A record decodes
+    on its own, one 8-byte copy per code, without a block to decompress first.
+*/
+struct sigpack {
+	uint64_t symbol[SIGPACK_SYMBOLS];
+	uint8_t len[SIGPACK_SYMBOLS];
+	size_t nsymbols;
+	size_t text_len;
+};
+
+/** \brief Every record's answer line, as printf("%d %s %s\n") prints it, rendered once.
+
+    The line of record i runs from lines + off[i] to lines + off[i + 1], so an answer
+    is copied instead of formatted. Both arrays live in the region of the table.
+*/
+struct sigrender {
+	const char *lines;
+	const uint64_t *off;
+};
+
+/** \brief How sigtable_export() writes records: as answers, as JSON Lines or as CSV. */
+enum sigexport_format {
+	SIGEXPORT_LINE,
+	SIGEXPORT_JSONL,
+	SIGEXPORT_CSV
+};
+
+/** \brief How sigtable_load() reads files: io_uring if the kernel allows, io_uring only or pread(). */
+enum sigio_backend {
+	SIGIO_AUTO,
+	SIGIO_URING,
+	SIGIO_PREAD
+};
+
+/** \brief A loaded database: compact records plus the arena their strings live in.
+
+    For a text database the arena is the mapped file itself and \p hot is allocated
+    by map_records(). A compiled image is used in place, \p hot and \p arena both
+    point into the mapping. A table opened with a memory budget has neither, its
+    records come from \p pager. sigtable_attach() makes a table without a mapping
+    over arrays the caller owns. Whatever is allocated for the table, \p hot of a text
+    database and the indexes, lives in \p region. A table packed by sigtable_pack()
+    has no mapping either, \p arena then holds the codes of \p pack. \p render is
+    only set once sigtable_render() has run.
+*/
+struct sigtable {
+	void *map;
+	size_t map_len;
+	struct sighot *hot;
+	const char *arena;
+	size_t arena_len;
+	size_t size;
+	bool image;
+	struct signame_index names;
+	struct sigtext_index text;
+	struct signum_index nums;
+	struct sigpager *pager;
+	struct sigregion region;
+	const struct sigpack *pack;
+	struct sigrender render;
+};
+
+/** \brief A change of a database, kept in its journal by sigjournal_append().
+
+    \p rec replaces all records of its signal number, or if \p remove is set they are
+    removed and only the signal number of \p rec is used.
+*/
+struct sigchange {
+	bool remove;
+	struct sigrecord rec;
+};
+
+/** \brief The phases of a run that struct sigstats times. */
+enum sigstats_phase {
+	SIGSTATS_OPEN,
+	SIGSTATS_PARSE,
+	SIGSTATS_INDEX,
+	SIGSTATS_QUERIES,
+	SIGSTATS_PHASES
+};
+
+/** \brief The kinds of query struct sigstats counts, see sigstats_query(). */
+enum sigstats_query {
+	SIGSTATS_QUERY_INDEX,
+	SIGSTATS_QUERY_NAME,
+	SIGSTATS_QUERY_SEARCH,
+	SIGSTATS_QUERY_SIGNUM,
+	SIGSTATS_QUERY_KINDS
+};
+
+/* Buckets of the query latency histogram, bucket i counts latencies below 2^(i + 8) ns
+   and the last one all that are longer */
+#define SIGSTATS_BUCKETS 24
+
+/** \brief Timings and counters of the process, collected while \p enabled is set.
+
+    Phases are timed in wall clock and process CPU time. Counters are updated with
+    relaxed atomics, so threads can share them; read them with sigstats_snapshot().
+    When disabled, which is the default, each instrumented point costs one branch.
+*/
+struct sigstats {
+	bool enabled;
+	uint64_t wall_ns[SIGSTATS_PHASES];
+	uint64_t cpu_ns[SIGSTATS_PHASES];
+	uint64_t bytes_read;
+	uint64_t records_parsed;
+	uint64_t records_rejected;
+	uint64_t queries[SIGSTATS_QUERY_KINDS];
+	uint64_t latency[SIGSTATS_BUCKETS];
+	uint64_t latency_sum_ns;
+};
+
+/** \brief A reader thread of a struct sigrcu. \p active is the epoch it entered in, 0 when outside. */
+struct sigrcu_reader {
+	uint64_t active;
+	struct sigrcu_reader *next;
+};
+
+/** \brief A published table that can be replaced while readers use it, RCU-style.
+
+    Readers never block or write shared state. A writer publishes a new table, then
+    waits until no reader is still inside a read section that began before, and only
+    then closes the old table.
+*/
+struct sigrcu {
+	struct sigtable *current;
+	uint64_t epoch;
+	pthread_mutex_t lock;
+	struct sigrcu_reader *readers;
+};
+
+/** \brief Background thread reloading a struct sigrcu when its data file changes. */
+struct sigwatch {
+	struct sigrcu *rcu;
+	char path_arg[MAX_PATH];
+	char name[MAX_PATH];
+	int inotify_fd;
+	int stop[2];
+	pthread_t thread;
+	unsigned long reloads;
+	unsigned long failures;
+};
+
 size_t checked_add( size_t lhs, size_t rhs );
 void *checked_malloc( size_t nmemb, size_t size );
 struct sigrecord *checked_fgets( struct sigrecord *rec, FILE *fh );
 FILE *datafile_open( const char *path_arg );
+int read_size( FILE *in, size_t *size );
+extern unsigned sigregion_flags;
+void sigregion_init( struct sigregion *region, unsigned flags );
+void *sigregion_alloc( struct sigregion *region, size_t nmemb, size_t size, size_t align );
+void sigregion_free( struct sigregion *region );
+extern enum sigio_backend sigio_backend;
+struct sighot *map_records( const char *buf, size_t len, size_t *size );
+struct sighot *map_records_parallel( const char *buf, size_t len, size_t *size, unsigned threads );
+struct sigtable *sigtable_open( const char *path_arg );
+struct sigtable *sigtable_load( const char *path_arg );
+struct sigtable *sigtable_open_bounded( const char *path_arg, size_t budget );
+struct sigtable *sigtable_attach( const struct sighot *hot, size_t size, const char *arena, size_t arena_len );
+struct sigtable *sigtable_parse( const char *buf, size_t len );
+const struct sigview *sigtable_get( const struct sigtable *tab, size_t idx, struct sigview *out );
+extern unsigned sigprefetch_distance;
+ssize_t sigtable_get_batch( const struct sigtable *tab, const size_t *idx, size_t n,
+	int (*found)( void *arg, size_t k, const struct sigview *rec ), void *arg );
+void sigtable_close( struct sigtable *tab );
+void sigtable_mem_report( const struct sigtable *tab, FILE *out );
+void sigpager_report( const struct sigpager *pager, FILE *out );
+int sigtable_index_names( struct sigtable *tab );
+size_t sigtable_find_name( const struct sigtable *tab, const char *name, size_t len, const uint32_t **recs );
+size_t sigtable_find_prefix( const struct sigtable *tab, const char *prefix, size_t len, const uint32_t **recs );
+int sigtable_index_text( struct sigtable *tab );
+ssize_t sigtable_search( const struct sigtable *tab, const char *query, size_t len,
+	int (*match)( void *arg, size_t rec ), void *arg );
+int sigtable_index_signums( struct sigtable *tab );
+size_t sigtable_find_signum( const struct sigtable *tab, unsigned signum, const uint32_t **recs );
+ssize_t sigtable_find_signums( const struct sigtable *tab, unsigned lo, unsigned hi,
+	int (*match)( void *arg, size_t rec ), void *arg );
+int sigtable_index( struct sigtable *tab );
+extern bool sigpack_on_load;
+int sigtable_pack( struct sigtable *tab );
+extern bool sigrender_on_load;
+int sigtable_render( struct sigtable *tab );
+int sigtable_export( const struct sigtable *tab, size_t first, size_t end, enum sigexport_format format, int fd );
+int sigchange_parse( const char *line, size_t len, struct sigchange *change );
+int sigjournal_append( const char *path_arg, const struct sigchange *changes, size_t n );
+int sigjournal_compact( const char *path_arg );
+int sigimage_compile( FILE *in, int fd );
+int sigimage_verify( const struct sigtable *tab );
+int sigembed_write( const struct sigtable *tab, const char *source, FILE *out );
+int run_interactive( struct sigtable *tab, FILE *in, int out_fd );
+int run_batch( struct sigtable *tab, int in_fd, int out_fd );
+int sigrcu_init( struct sigrcu *rcu, struct sigtable *tab );
+void sigrcu_destroy( struct sigrcu *rcu );
+void sigrcu_register( struct sigrcu *rcu, struct sigrcu_reader *reader );
+void sigrcu_unregister( struct sigrcu *rcu, struct sigrcu_reader *reader );
+struct sigtable *sigrcu_read_lock( struct sigrcu *rcu, struct sigrcu_reader *reader );
+void sigrcu_read_unlock( struct sigrcu_reader *reader );
+void sigrcu_publish( struct sigrcu *rcu, struct sigtable *tab );
+int sigwatch_start( struct sigwatch *watch, struct sigrcu *rcu, const char *path_arg );
+void sigwatch_stop( struct sigwatch *watch );
+int server_listen( const char *path );
+int run_server( struct sigrcu *rcu, int listen_fd, int stop_fd );
+extern struct sigstats sigstats;
+void sigstats_snapshot( struct sigstats *out );
+int sigstats_json( const struct sigstats *st, FILE *out );
+int sigstats_prometheus( const struct sigstats *st, FILE *out );
+int run_metrics( int listen_fd, int stop_fd );
 
 #endif /* end file better-intexer.h */
 
@@ -49,6 +509,47 @@ size_t checked_add( size_t lhs, size_t rhs )
 	return result;
 }
 
+/* The statistics of this process, see struct sigstats */
+struct sigstats sigstats;
+
+static uint64_t clock_ns( clockid_t clock )
+{
+	struct timespec ts;
+
+	clock_gettime(clock, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+/** \brief Start of a timed phase, \p wall is 0 if stats were disabled at the start. */
+struct sigstats_timer {
+	uint64_t wall;
+	uint64_t cpu;
+};
+
+static void sigstats_start( struct sigstats_timer *timer )
+{
+	timer->wall = 0;
+	if( sigstats.enabled )
+	{
+		timer->wall = clock_ns(CLOCK_MONOTONIC);
+		timer->cpu = clock_ns(CLOCK_PROCESS_CPUTIME_ID);
+	}
+}
+
+static void sigstats_add( uint64_t *counter, uint64_t n )
+{
+	if( sigstats.enabled ) __atomic_fetch_add(counter, n, __ATOMIC_RELAXED);
+}
+
+static void sigstats_stop( const struct sigstats_timer *timer, enum sigstats_phase phase )
+{
+	if( timer->wall != 0 )
+	{
+		__atomic_fetch_add(&sigstats.wall_ns[phase], clock_ns(CLOCK_MONOTONIC) - timer->wall, __ATOMIC_RELAXED);
+		__atomic_fetch_add(&sigstats.cpu_ns[phase], clock_ns(CLOCK_PROCESS_CPUTIME_ID) - timer->cpu, __ATOMIC_RELAXED);
+	}
+}
+
 /** \brief Wrapper for malloc that validates the arguments. Errno is set to EINVAL on error. */
 void *checked_malloc(size_t nmemb, size_t size )
 {
@@ -64,6 +565,262 @@ void *checked_malloc(size_t nmemb, size_t size )
 	return ret;
 }
 
+/* Huge page size, blocks this large or larger are rounded to it and use huge pages */
+#define SIGREGION_HUGE ((size_t)2 << 20)
+/* Smallest block, so that a small table does not pay for zeroing a huge page */
+#define SIGREGION_BLOCK_MIN ((size_t)64 << 10)
+/* Largest alignment sigregion_alloc() provides */
+#define SIGREGION_ALIGN_MAX 4096
+
+/* The region flags of tables opened from now on */
+unsigned sigregion_flags = SIGREGION_THP;
+
+/** \brief Starts an empty region, no memory is mapped until the first allocation. */
+void sigregion_init( struct sigregion *region, unsigned flags )
+{
+	memset(region, 0, sizeof(*region));
+	region->flags = flags;
+}
+
+/** \brief Maps a block of \p len bytes as \p flags ask, a multiple of SIGREGION_HUGE if that large. */
+static struct sigregion_block *sigregion_map( size_t len, unsigned flags )
+{
+	struct sigregion_block *block;
+	char *map;
+	size_t skip;
+
+	if( len < SIGREGION_HUGE ) flags = 0;
+	if( flags & SIGREGION_HUGETLB )
+	{
+		map = (char *) mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+		if( map != MAP_FAILED )
+		{
+			block = (struct sigregion_block *)map;
+			block->hugetlb = true;
+			return block;
+		}
+		/* the pool is empty or not configured, transparent huge pages may still do */
+		flags |= SIGREGION_THP;
+	}
+
+	if( !(flags & SIGREGION_THP) )
+	{
+		map = (char *) mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		return map == MAP_FAILED ? NULL : (struct sigregion_block *)map;
+	}
+
+	/* only whole aligned huge pages can be backed by one, so map more and trim */
+	map = (char *) mmap(NULL, len + SIGREGION_HUGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if( map == MAP_FAILED ) return NULL;
+
+	skip = (SIGREGION_HUGE - (uintptr_t)map % SIGREGION_HUGE) % SIGREGION_HUGE;
+	if( skip > 0 ) munmap(map, skip);
+	munmap(map + skip + len, SIGREGION_HUGE - skip);
+	map += skip;
+	madvise(map, len, MADV_HUGEPAGE);
+	return (struct sigregion_block *)map;
+}
+
+/** \brief Adds a block with room for \p need bytes at any alignment sigregion_alloc() allows. */
+static int sigregion_grow( struct sigregion *region, size_t need )
+{
+	struct sigregion_block *block;
+	size_t len = checked_add(checked_add(need, sizeof(*block)), SIGREGION_ALIGN_MAX);
+
+	if( len == 0 || len > SIZE_MAX - SIGREGION_HUGE * 2 )
+	{
+		errno = ENOMEM;
+		return -1;
+	}
+	if( len < region->mapped ) len = region->mapped;
+	if( len < SIGREGION_BLOCK_MIN ) len = SIGREGION_BLOCK_MIN;
+	if( len >= SIGREGION_HUGE ) len = (len + SIGREGION_HUGE - 1) / SIGREGION_HUGE * SIGREGION_HUGE;
+	else len = (len + SIGREGION_ALIGN_MAX - 1) / SIGREGION_ALIGN_MAX * SIGREGION_ALIGN_MAX;
+
+	block = sigregion_map(len, region->flags);
+	if( block == NULL ) return -1;
+
+	block->next = region->blocks;
+	block->len = len;
+	region->blocks = block;
+	region->pos = (char *)(block + 1);
+	region->end = (char *)block + len;
+	region->mapped += len;
+	return 0;
+}
+
+/* Where \p bytes aligned to \p align would go in the current block, NULL if they do not fit */
+static char *sigregion_fit( const struct sigregion *region, size_t bytes, size_t align )
+{
+	size_t skip;
+
+	if( region->blocks == NULL ) return NULL;
+	skip = (align - (uintptr_t)region->pos % align) % align;
+	if( (size_t)(region->end - region->pos) < skip || (size_t)(region->end - region->pos) - skip < bytes ) return NULL;
+	return region->pos + skip;
+}
+
+/** \brief Allocates \p nmemb zeroed elements of \p size bytes aligned to \p align from \p region.
+
+    \returns The memory, valid until sigregion_free(), or NULL with errno set on
+             error. errno is EINVAL for a zero size or an alignment that is not a
+             power of two up to SIGREGION_ALIGN_MAX.
+*/
+void *sigregion_alloc( struct sigregion *region, size_t nmemb, size_t size, size_t align )
+{
+	size_t bytes;
+	char *ret;
+
+	if( size == 0 || nmemb == 0 || nmemb > SIZE_MAX / size
+		|| align == 0 || (align & (align - 1)) != 0 || align > SIGREGION_ALIGN_MAX )
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+	bytes = nmemb * size;
+
+	ret = sigregion_fit(region, bytes, align);
+	if( ret == NULL )
+	{
+		if( sigregion_grow(region, bytes) != 0 ) return NULL;
+		ret = sigregion_fit(region, bytes, align);
+	}
+
+	region->pos = ret + bytes;
+	region->used += bytes;
+	return ret;
+}
+
+/** \brief Unmaps all blocks of \p region, which is empty again afterwards. */
+void sigregion_free( struct sigregion *region )
+{
+	struct sigregion_block *block = region->blocks;
+
+	while( block )
+	{
+		struct sigregion_block *next = block->next;
+		munmap(block, block->len);
+		block = next;
+	}
+	sigregion_init(region, region->flags);
+}
+
+/** \brief Finds the first space and the first newline in \p len bytes of \p line in one pass.
+
+    Only a space before the newline counts, as with strchr() on a line read by fgets().
+    \p *sep and \p *nl are NULL if not found.
+*/
+typedef void (*scan_fields_fn)( const char *line, size_t len, const char **sep, const char **nl );
+
+/* Scans [i, len) for a scan that has already been through [0, i) */
+static void scan_fields_tail( const char *line, size_t i, size_t len, const char **sep, const char **nl )
+{
+	for( ; i < len; i++ )
+	{
+		if( line[i] == '\n' )
+		{
+			*nl = line + i;
+			return;
+		}
+		if( line[i] == ' ' && *sep == NULL ) *sep = line + i;
+	}
+}
+
+static void scan_fields_scalar( const char *line, size_t len, const char **sep, const char **nl )
+{
+	*sep = NULL;
+	*nl = NULL;
+	scan_fields_tail(line, 0, len, sep, nl);
+}
+
+#ifdef SCAN_FIELDS_X86
+
+/* Records the hits of one block whose space and newline bitmasks are given */
+static bool scan_fields_hits( const char *block, uint32_t spaces, uint32_t newlines, const char **sep, const char **nl )
+{
+	if( newlines != 0 )
+	{
+		unsigned at = (unsigned)__builtin_ctz(newlines);
+
+		*nl = block + at;
+		spaces &= (1u << at) - 1;
+	}
+	if( spaces != 0 && *sep == NULL ) *sep = block + __builtin_ctz(spaces);
+	return newlines != 0;
+}
+
+__attribute__((target("sse2")))
+static void scan_fields_sse2_from( const char *line, size_t i, size_t len, const char **sep, const char **nl )
+{
+	const __m128i space = _mm_set1_epi8(' ');
+	const __m128i newline = _mm_set1_epi8('\n');
+
+	for( ; i + 16 <= len; i += 16 )
+	{
+		__m128i v = _mm_loadu_si128((const __m128i *)(line + i));
+		uint32_t spaces = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, space));
+		uint32_t newlines = (uint32_t)_mm_movemask_epi8(_mm_cmpeq_epi8(v, newline));
+
+		if( scan_fields_hits(line + i, spaces, newlines, sep, nl) ) return;
+	}
+	scan_fields_tail(line, i, len, sep, nl);
+}
+
+__attribute__((target("sse2")))
+static void scan_fields_sse2( const char *line, size_t len, const char **sep, const char **nl )
+{
+	*sep = NULL;
+	*nl = NULL;
+	scan_fields_sse2_from(line, 0, len, sep, nl);
+}
+
+__attribute__((target("avx2")))
+static void scan_fields_avx2( const char *line, size_t len, const char **sep, const char **nl )
+{
+	const __m256i space = _mm256_set1_epi8(' ');
+	const __m256i newline = _mm256_set1_epi8('\n');
+	size_t i;
+
+	*sep = NULL;
+	*nl = NULL;
+	for( i = 0; i + 32 <= len; i += 32 )
+	{
+		__m256i v = _mm256_loadu_si256((const __m256i *)(line + i));
+		uint32_t spaces = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, space));
+		uint32_t newlines = (uint32_t)_mm256_movemask_epi8(_mm256_cmpeq_epi8(v, newline));
+
+		if( scan_fields_hits(line + i, spaces, newlines, sep, nl) ) return;
+	}
+	scan_fields_sse2_from(line, i, len, sep, nl);
+}
+
+#endif /* SCAN_FIELDS_X86 */
+
+static scan_fields_fn scan_fields_select( void )
+{
+#ifdef SCAN_FIELDS_X86
+	__builtin_cpu_init();
+	if( __builtin_cpu_supports("avx2") ) return scan_fields_avx2;
+	if( __builtin_cpu_supports("sse2") ) return scan_fields_sse2;
+#endif
+	return scan_fields_scalar;
+}
+
+static scan_fields_fn scan_fields_impl;
+
+/** \brief scan_fields_scalar() or the widest vector version this CPU supports. */
+static void scan_fields( const char *line, size_t len, const char **sep, const char **nl )
+{
+	scan_fields_fn fn = __atomic_load_n(&scan_fields_impl, __ATOMIC_RELAXED);
+
+	if( fn == NULL )
+	{
+		fn = scan_fields_select();
+		__atomic_store_n(&scan_fields_impl, fn, __ATOMIC_RELAXED);
+	}
+	fn(line, len, sep, nl);
+}
+
 /** \brief Attempts to read the id, name and description of a \p rec from an \fh
 
     \returns \p rec or NULL on error, check errno.
@@ -71,23 +828,24 @@ void *checked_malloc(size_t nmemb, size_t size )
 struct sigrecord *checked_fgets( struct sigrecord *rec, FILE *fh )
 {
 	char buff[sizeof(rec->signame) + sizeof(rec->sigdesc)];
+	unsigned long signum;
 
-	if( 1 == fscanf(fh, "%hu ", &rec->signum)
+	/* %hu would silently wrap numbers that do not fit */
+	if( 1 == fscanf(fh, "%lu ", &signum) && signum <= USHRT_MAX
 		&& NULL != fgets(buff, sizeof(buff), fh) )
 	{
-		char *sep = strchr(buff, ' ');
+		const char *sep, *nl;
 
-		if( NULL != sep && sep - buff < sizeof(rec->signame) )
+		rec->signum = (unsigned short)signum;
+		scan_fields(buff, strlen(buff), &sep, &nl);
+		if( NULL != sep && sep - buff < (ptrdiff_t)sizeof(rec->signame) )
 		{
-			char *nl;
-
 			strncpy(rec->signame, buff, sep - buff);
 			rec->signame[sep - buff] = '\0';
 			strncpy(rec->sigdesc, sep + 1, sizeof(rec->sigdesc));
 			rec->sigdesc[sizeof(rec->sigdesc)-1] = '\0';
 
-			nl = strchr(rec->sigdesc, '\n');
-			if(nl) *nl = '\0';
+			if( nl && nl - (sep + 1) < (ptrdiff_t)sizeof(rec->sigdesc) ) rec->sigdesc[nl - (sep + 1)] = '\0';
 		}
 		else
 		{
@@ -104,31 +862,55 @@ struct sigrecord *checked_fgets( struct sigrecord *rec, FILE *fh )
 	return rec;
 }
 
-/** \brief handles concatenation of the DATA_PATH and the user-provided path */
-static int handle_path_arg(size_t size, char *full_path, const char *path_arg)
+/** \brief Joins the first \p dir_len bytes of \p dir and \p path_arg with a separator between them. */
+static int join_path(size_t size, char *full_path, const char *dir, size_t dir_len, const char *path_arg)
 {
-	int sret;
-	char *data_path = getenv("DATA_PATH");
-	size_t data_path_len = data_path ? strlen(data_path) : 0;
-
 	const char *sep = NULL;
 
-	if(data_path_len > 0 && data_path[data_path_len-1] != *OS_PATH_SEP)
+	if(dir_len > 0 && dir[dir_len-1] != *OS_PATH_SEP)
 	{
 		sep = OS_PATH_SEP;
 	}
 
-	sret = snprintf(full_path, size, "%s%s%s",
-			data_path ? data_path : "",
+	return snprintf(full_path, size, "%.*s%s%s",
+			(int)dir_len, dir,
 			sep ? sep : "",
 			path_arg ? path_arg : ""
 			);
-	return sret;
+}
+
+/** \brief handles concatenation of the DATA_PATH and the user-provided path
+
+    DATA_PATH may list several directories separated by OS_PATH_LIST_SEP. They are
+    tried in order and the first one holding \p path_arg is used, the first one at
+    all if none does. An empty entry stands for the current directory.
+*/
+static int handle_path_arg(size_t size, char *full_path, const char *path_arg)
+{
+	int sret;
+	char *data_path = getenv("DATA_PATH");
+	const char *dir, *next;
+
+	if( data_path == NULL || strchr(data_path, *OS_PATH_LIST_SEP) == NULL )
+	{
+		return join_path(size, full_path, data_path ? data_path : "", data_path ? strlen(data_path) : 0, path_arg);
+	}
+
+	for( dir = data_path; ; dir = next + 1 )
+	{
+		next = dir + strcspn(dir, OS_PATH_LIST_SEP);
+		sret = join_path(size, full_path, dir, (size_t)(next - dir), path_arg);
+		if( sret > 0 && (size_t)sret < size && access(full_path, F_OK) == 0 ) return sret;
+		if( *next == '\0' ) break;
+	}
+
+	return join_path(size, full_path, data_path, strcspn(data_path, OS_PATH_LIST_SEP), path_arg);
 }
 
 /** \brief Opens a handle to the file specified by path_arg.
 
-    Prepends file path with the DATA_PATH environment variable if set.
+    Prepends file path with the DATA_PATH environment variable if set, or with the
+    first of its directories that holds the file if it lists several.
 
     \returns A file pointer that the user is responsible for closing upon successful completion.
              Otherwise, NULL is return and errno is set to indicate the error.
@@ -137,8 +919,11 @@ FILE *datafile_open( const char *path_arg )
 {
 	FILE *ret = NULL;
 	char full_path[MAX_PATH];
-	int sret = handle_path_arg(sizeof(full_path), full_path, path_arg);
+	struct sigstats_timer timer;
+	int sret;
 
+	sigstats_start(&timer);
+	sret = handle_path_arg(sizeof(full_path), full_path, path_arg);
 	if( sret > 0 && sret < MAX_PATH )
 	{
 		ret = fopen( full_path, "r");
@@ -148,83 +933,6243 @@ FILE *datafile_open( const char *path_arg )
 		errno = EINVAL;
 	}
 
+	sigstats_stop(&timer, SIGSTATS_OPEN);
 	return ret;
 }
 
+/** \brief Reads the record count that starts a database.
+
+    \returns 1 on success, 0 on error.
+*/
+int read_size( FILE *in, size_t *size )
+{
+	return 1 == fscanf(in, "%zu", size);
+}
+
 struct sigrecord *read_records(FILE *in, size_t *size)
 {
 	struct sigrecord *sigdb = NULL;
+	struct sigstats_timer timer;
 	size_t i = 0;
 
-	if( 1 == fscanf(in, "%zu", size) )
+	sigstats_start(&timer);
+	if( read_size(in, size) )
 	{
 		sigdb = (struct sigrecord *) checked_malloc(*size, sizeof(sigdb[0]));
-		if (sigdb == NULL) return NULL;
 
-		for (i = 0; i < *size; i++)
+		for (i = 0; sigdb != NULL && i < *size; i++)
 		{
 			if( NULL == checked_fgets(&sigdb[i], in) )
 			{
+				sigstats_add(&sigstats.records_rejected, 1);
 				free(sigdb);
-				return NULL;
-
+				sigdb = NULL;
+				break;
 			}
 		}
 	}
 
+	if( sigstats.enabled )
+	{
+		sigstats_add(&sigstats.records_parsed, i);
+		sigstats_add(&sigstats.bytes_read, (uint64_t)ftell(in));
+	}
+	sigstats_stop(&timer, SIGSTATS_PARSE);
 	return sigdb;
 }
 
-#ifndef TEST
-int main(int argc, char* argv[]) {
-	size_t size, idx;
-	char input[10];
+/* The longest line checked_fgets() accepts in one fgets() call, excluding the terminator. */
+#define SIGLINE_MAX (sizeof(((struct sigrecord *)0)->signame) + sizeof(((struct sigrecord *)0)->sigdesc) - 1)
 
-	FILE *in;
-	struct sigrecord *sigdb;
+static bool is_space( char c )
+{
+	return isspace((unsigned char)c) != 0;
+}
 
-	if (argc != 2) {
-		printf("Usage: %s data_base\n", argv[0]);
-		return 0;
-	}
+static const char *skip_space( const char *pos, const char *end )
+{
+	while( pos < end && is_space(*pos) ) pos++;
+	return pos;
+}
 
-	if ((in = datafile_open(argv[1]) )== NULL) {
-		printf("Cannot open input file: %m\n");
-		return 1;
-	}
+/** \brief Parses the record count at the start of a database buffer.
 
-	sigdb = read_records(in, &size);
-	if (sigdb == NULL) goto close_files;
+    Accepts what fscanf("%zu") followed by a successful checked_malloc() would:
+    optional leading whitespace and a non-zero decimal number that fits in a size_t.
 
-	/* Loop until 'q' and print out signal information */
-	while (NULL != fgets(input, sizeof(input), stdin))
+    \returns The position after the number or NULL on error.
+*/
+static const char *parse_size( const char *pos, const char *end, size_t *size )
+{
+	size_t value = 0;
+	const char *digits;
+
+	pos = skip_space(pos, end);
+	digits = pos;
+	while( pos < end && *pos >= '0' && *pos <= '9' )
+	{
+		size_t digit = (size_t)(*pos - '0');
+		if( value > (SIZE_MAX - digit) / 10 ) return NULL;
+		value = value * 10 + digit;
+		pos++;
+	}
+
+	if( pos == digits || value == 0 ) return NULL;
+
+	*size = value;
+	return pos;
+}
+
+/** \brief Parses one record at \p pos into \p hot without copying.
+
+    Applies the same rules as checked_fgets(): the number and any whitespace after it
+    are skipped, then at most SIGLINE_MAX characters up to and including the newline
+    form the line. The name ends at the first space and must fit in signame, the
+    description is truncated to fit in sigdesc.
+
+    String offsets in \p hot are relative to \p base.
+
+    \returns The position where the next record starts or NULL on error.
+*/
+static const char *parse_record( const char *base, const char *pos, const char *end, struct sighot *hot )
+{
+	unsigned long signum = 0;
+	const char *digits, *line, *line_end, *sep, *nl;
+	size_t desc_len;
+	bool negative;
+
+	pos = skip_space(pos, end);
+	/* a sign is accepted as fscanf("%lu") does, only -0 is in range */
+	negative = pos < end && *pos == '-';
+	if( pos < end && (*pos == '+' || *pos == '-') ) pos++;
+	digits = pos;
+	while( pos < end && *pos >= '0' && *pos <= '9' )
+	{
+		signum = signum * 10 + (unsigned long)(*pos - '0');
+		if( signum > USHRT_MAX ) return NULL;
+		pos++;
+	}
+	if( pos == digits || (negative && signum != 0) ) return NULL;
+
+	line = skip_space(pos, end);
+	if( line == end ) return NULL;
+
+	line_end = end - line > (ptrdiff_t)SIGLINE_MAX ? line + SIGLINE_MAX : end;
+	scan_fields(line, (size_t)(line_end - line), &sep, &nl);
+	if( nl ) line_end = nl + 1;
+
+	if( NULL == sep || sep - line >= (ptrdiff_t)sizeof(((struct sigrecord *)0)->signame) )
+	{
+		return NULL;
+	}
+
+	desc_len = (size_t)((nl ? nl : line_end) - (sep + 1));
+	if( desc_len > sizeof(((struct sigrecord *)0)->sigdesc) - 1 )
+	{
+		desc_len = sizeof(((struct sigrecord *)0)->sigdesc) - 1;
+	}
+
+	hot->off = (uint64_t)(line - base);
+	hot->signum = (uint16_t)signum;
+	hot->name_len = (uint8_t)(sep - line);
+	hot->desc_len = (uint8_t)desc_len;
+	hot->reserved = 0;
+
+	return line_end;
+}
+
+/* Room for \p n records, from \p region or from malloc() if NULL */
+static struct sighot *records_alloc( struct sigregion *region, size_t n )
+{
+	if( region ) return (struct sighot *) sigregion_alloc(region, n, sizeof(struct sighot), 64);
+	return (struct sighot *) checked_malloc(n, sizeof(struct sighot));
+}
+
+/* map_records() allocating the records from \p region, or malloc() if NULL */
+static struct sighot *map_records_in( const char *buf, size_t len, size_t *size, struct sigregion *region )
+{
+	const char *pos, *end = buf + len;
+	struct sighot *recs;
+	size_t i;
+
+	pos = parse_size(buf, end, size);
+	/* every record takes at least four bytes, reject counts the buffer cannot hold */
+	if( NULL == pos || *size > len / 4 + 1 )
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	recs = records_alloc(region, *size);
+	if( recs == NULL ) return NULL;
+
+	for( i = 0; i < *size; i++ )
+	{
+		pos = parse_record(buf, pos, end, &recs[i]);
+		if( NULL == pos )
+		{
+			if( region == NULL ) free(recs);
+			errno = EINVAL;
+			return NULL;
+		}
+	}
+
+	return recs;
+}
+
+/** \brief Builds compact records for \p buf following the rules of read_records().
+
+    \returns An array of \p size records with offsets into \p buf that the caller
+             must free, or NULL with errno set on error.
+*/
+struct sighot *map_records( const char *buf, size_t len, size_t *size )
+{
+	return map_records_in(buf, len, size, NULL);
+}
+
+/** \brief The records starting in [\p start, \p stop), parsed by one thread of map_records_parallel(). */
+struct parse_chunk {
+	pthread_t thread;
+	const char *base;
+	const char *start;
+	const char *stop;
+	const char *end;
+	const char *next;
+	struct sighot *recs;
+	size_t count;
+	size_t cap;
+	bool failed;
+	int err;
+	struct sighot *dest;
+	size_t take;
+};
+
+static void *parse_chunk_run( void *arg )
+{
+	struct parse_chunk *chunk = (struct parse_chunk *)arg;
+	const char *pos = chunk->start;
+
+	chunk->count = 0;
+	chunk->failed = false;
+
+	while( pos < chunk->stop )
+	{
+		const char *next;
+
+		if( chunk->count == chunk->cap )
+		{
+			/* untouched pages cost nothing, so guess high: a record is rarely under 16 bytes */
+			size_t cap = chunk->cap ? chunk->cap * 2 : (size_t)(chunk->stop - pos) / 16 + 64;
+			struct sighot *grown = (struct sighot *) realloc(chunk->recs, cap * sizeof(grown[0]));
+
+			if( grown == NULL )
+			{
+				chunk->failed = true;
+				chunk->err = ENOMEM;
+				break;
+			}
+			chunk->recs = grown;
+			chunk->cap = cap;
+		}
+
+		/* a record starting here may run past stop, the next chunk checks where it ended */
+		next = parse_record(chunk->base, pos, chunk->end, &chunk->recs[chunk->count]);
+		if( next == NULL )
+		{
+			chunk->failed = true;
+			break;
+		}
+		chunk->count++;
+		pos = next;
+	}
+
+	chunk->next = pos;
+	return NULL;
+}
+
+static void *parse_chunk_copy( void *arg )
+{
+	struct parse_chunk *chunk = (struct parse_chunk *)arg;
+
+	memcpy(chunk->dest, chunk->recs, chunk->take * sizeof(chunk->recs[0]));
+	return NULL;
+}
+
+/** \brief Runs \p fn on every chunk, one thread each, the first on the calling thread. */
+static int parse_chunks_run( struct parse_chunk *chunks, size_t n, void *(*fn)( void * ) )
+{
+	size_t started, i;
+	int ret = 0;
+
+	for( started = 1; started < n; started++ )
+	{
+		if( pthread_create(&chunks[started].thread, NULL, fn, &chunks[started]) != 0 ) break;
+	}
+
+	/* chunks without a thread run here */
+	fn(&chunks[0]);
+	for( i = started; i < n; i++ ) fn(&chunks[i]);
+
+	for( i = 1; i < started; i++ )
+	{
+		if( pthread_join(chunks[i].thread, NULL) != 0 ) ret = -1;
+	}
+	return ret;
+}
+
+static unsigned online_cpus( void )
+{
+	long n = sysconf(_SC_NPROCESSORS_ONLN);
+	return n > 0 ? (unsigned)n : 1;
+}
+
+/* Smallest piece of input worth a thread of its own */
+#define PARSE_CHUNK_MIN (1 << 20)
+
+/* map_records_parallel() allocating the records from \p region, or malloc() if NULL */
+static struct sighot *map_records_parallel_in( const char *buf, size_t len, size_t *size, unsigned threads,
+		struct sigregion *region )
+{
+	const char *pos, *end = buf + len, *cur;
+	struct parse_chunk *chunks;
+	struct sighot *recs = NULL;
+	size_t n, k, total = 0, span;
+	int err = EINVAL;
+
+	if( threads == 0 )
+	{
+		threads = online_cpus();
+		if( len / PARSE_CHUNK_MIN < threads ) threads = (unsigned)(len / PARSE_CHUNK_MIN);
+	}
+	if( threads <= 1 ) return map_records_in(buf, len, size, region);
+
+	pos = parse_size(buf, end, size);
+	if( NULL == pos || *size > len / 4 + 1 )
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	chunks = (struct parse_chunk *) checked_malloc(threads, sizeof(chunks[0]));
+	if( chunks == NULL ) return NULL;
+
+	/* cut at line starts that hold a record rather than whitespace */
+	span = (size_t)(end - pos) / threads + 1;
+	for( n = 0, cur = pos; n < threads && cur < end; n++ )
+	{
+		const char *stop = (size_t)(end - cur) > span ? cur + span : end;
+
+		while( stop < end && !(stop[-1] == '\n' && !is_space(*stop)) ) stop++;
+
+		memset(&chunks[n], 0, sizeof(chunks[n]));
+		chunks[n].base = buf;
+		chunks[n].start = cur;
+		chunks[n].stop = stop;
+		chunks[n].end = end;
+		cur = stop;
+	}
+
+	if( n == 0 || parse_chunks_run(chunks, n, parse_chunk_run) != 0 ) goto done;
+
+	/* stitch in file order, reparsing a chunk whose start was not a record start */
+	for( k = 0, cur = pos; k < n && total < *size; k++ )
+	{
+		size_t need = *size - total;
+
+		if( chunks[k].start != cur )
+		{
+			if( cur >= chunks[k].stop )
+			{
+				chunks[k].next = cur;
+				continue;
+			}
+			chunks[k].start = cur;
+			parse_chunk_run(&chunks[k]);
+		}
+
+		chunks[k].take = chunks[k].count < need ? chunks[k].count : need;
+		total += chunks[k].take;
+		if( chunks[k].failed && total < *size )
+		{
+			if( chunks[k].err != 0 ) err = chunks[k].err;
+			goto done;
+		}
+		cur = chunks[k].next;
+	}
+
+	if( total < *size ) goto done;
+
+	recs = records_alloc(region, *size);
+	if( recs == NULL )
+	{
+		err = errno;
+		goto done;
+	}
+
+	for( k = 0, total = 0; k < n; k++ )
+	{
+		chunks[k].dest = recs + total;
+		total += chunks[k].take;
+	}
+	parse_chunks_run(chunks, n, parse_chunk_copy);
+
+done:
+	for( k = 0; k < n; k++ ) free(chunks[k].recs);
+	free(chunks);
+	if( recs == NULL ) errno = err;
+	return recs;
+}
+
+/** \brief Multi-threaded map_records() giving identical results.
+
+    The records are split into \p threads chunks at line starts and parsed in
+    parallel. Because a record may span lines, every chunk checks that the previous
+    one ended exactly where it began, and is parsed again from the right place if not.
+    Records are then stitched together in file order, and only as many as the count
+    asks for are used, so trailing content after them is ignored as before.
+
+    \p threads of 0 uses one thread per CPU for inputs large enough to profit.
+
+    \returns An array of \p size records with offsets into \p buf that the caller
+             must free, or NULL with errno set on error.
+*/
+struct sighot *map_records_parallel( const char *buf, size_t len, size_t *size, unsigned threads )
+{
+	return map_records_parallel_in(buf, len, size, threads, NULL);
+}
+
+/** \brief 64-bit FNV-1a, continued from \p sum. */
+static uint64_t fnv1a( uint64_t sum, const void *data, size_t len )
+{
+	const unsigned char *p = (const unsigned char *)data;
+	size_t i;
+
+	for( i = 0; i < len; i++ )
+	{
+		sum ^= p[i];
+		sum *= UINT64_C(1099511628211);
+	}
+	return sum;
+}
+
+#define FNV1A_INIT UINT64_C(14695981039346656037)
+
+static uint64_t sigimage_header_sum( const struct sigimage_header *hdr )
+{
+	return fnv1a(FNV1A_INIT, hdr, offsetof(struct sigimage_header, header_sum));
+}
+
+/** \brief Packs an upper-cased name into a key that sorts like the string.
+
+    The characters fill the top six bytes, most significant first, and the length the
+    lowest byte, so a name key is never 0.
+*/
+static uint64_t name_key( const char *name, size_t len )
+{
+	uint64_t key = 0;
+	size_t i;
+
+	for( i = 0; i < SIGNAME_MAX; i++ )
+	{
+		key <<= 8;
+		if( i < len ) key |= (unsigned char)toupper((unsigned char)name[i]);
+	}
+
+	return key << 8 | len;
+}
+
+/** \brief Finalizer of splitmix64, used to hash name keys. */
+static uint64_t mix64( uint64_t x )
+{
+	x ^= x >> 30;
+	x *= UINT64_C(0xbf58476d1ce4e5b9);
+	x ^= x >> 27;
+	x *= UINT64_C(0x94d049bb133111eb);
+	x ^= x >> 31;
+	return x;
+}
+
+static size_t mph_slot( uint64_t key, int32_t disp, size_t nslots )
+{
+	return (size_t)(mix64(key ^ (uint64_t)disp * UINT64_C(0x9e3779b97f4a7c15)) % nslots);
+}
+
+static uint64_t align8( uint64_t n )
+{
+	return (n + 7) & ~(uint64_t)7;
+}
+
+/** \brief Size of an index block for \p n records, or 0 if it cannot be represented. */
+static size_t name_index_len( size_t n, size_t nslots, size_t ndisp )
+{
+	uint64_t len;
+
+	if( n > INT32_MAX || nslots > INT32_MAX || ndisp > INT32_MAX ) return 0;
+
+	len = align8((uint64_t)n * (sizeof(uint64_t) + sizeof(uint32_t)))
+		+ (uint64_t)nslots * sizeof(struct signame_slot)
+		+ (uint64_t)ndisp * sizeof(int32_t);
+
+	return len > SIZE_MAX ? 0 : (size_t)len;
+}
+
+/** \brief Points the arrays of \p idx into \p block, whose length must match the layout.
+
+    \returns 0 on success, -1 otherwise.
+*/
+static int name_index_place( struct signame_index *idx, const char *block, size_t len, size_t n )
+{
+	size_t order_off = n * sizeof(uint64_t);
+	size_t slots_off = (size_t)align8(order_off + n * sizeof(uint32_t));
+	size_t disp_off = slots_off + idx->nslots * sizeof(struct signame_slot);
+
+	if( len == 0 || len != name_index_len(n, idx->nslots, idx->ndisp) ) return -1;
+
+	idx->keys = (const uint64_t *)block;
+	idx->order = (const uint32_t *)(block + order_off);
+	idx->slots = (const struct signame_slot *)(block + slots_off);
+	idx->disp = idx->ndisp ? (const int32_t *)(block + disp_off) : NULL;
+	idx->mem = NULL;
+	idx->mem_len = len;
+	return 0;
+}
+
+/** \brief A record number and its name key, sorted to build a struct signame_index. */
+struct name_pair {
+	uint64_t key;
+	uint32_t rec;
+};
+
+static int name_pair_cmp( const void *lhs, const void *rhs )
+{
+	const struct name_pair *a = (const struct name_pair *)lhs;
+	const struct name_pair *b = (const struct name_pair *)rhs;
+
+	if( a->key != b->key ) return a->key < b->key ? -1 : 1;
+	return a->rec < b->rec ? -1 : a->rec > b->rec;
+}
+
+/** \brief Places the \p m distinct runs in \p slots as a minimal perfect hash.
+
+    Hash and displace: runs are hashed into \p ndisp buckets, and buckets are placed
+    largest first by searching for a displacement that sends every member to a free
+    slot. Single-member buckets take the next free slot directly, stored as the
+    negated slot number.
+
+    \returns 0 on success, -1 with errno set otherwise.
+*/
+static int mph_build( const struct signame_slot *runs, size_t m, struct signame_slot *slots,
+		int32_t *disp, size_t ndisp )
+{
+	size_t *start, *by_size, *member, *pick;
+	size_t i, b, nb, max = 0, free_slot = 0;
+	int ret = -1;
+
+	start = (size_t *) checked_malloc(checked_add(checked_add(ndisp + 1, m), checked_add(ndisp, m + 1)), sizeof(size_t));
+	if( start == NULL ) return -1;
+	memset(start, 0, (ndisp + 1) * sizeof(size_t));
+	member = start + ndisp + 1;
+	by_size = member + m;
+	pick = by_size + ndisp;
+
+	/* group the runs by bucket */
+	for( i = 0; i < m; i++ ) start[mix64(runs[i].key) % ndisp + 1]++;
+	for( b = 0; b < ndisp; b++ )
+	{
+		if( start[b + 1] > max ) max = start[b + 1];
+		start[b + 1] += start[b];
+	}
+	for( i = 0; i < m; i++ )
+	{
+		size_t bucket = mix64(runs[i].key) % ndisp;
+		member[start[bucket]++] = i;
+	}
+	for( b = ndisp; b > 0; b-- ) start[b] = start[b - 1];
+	start[0] = 0;
+
+	/* largest buckets first, empty ones keep displacement 0 */
+	for( nb = 0, b = max; b > 0; b-- )
+	{
+		size_t k;
+		for( k = 0; k < ndisp; k++ )
+		{
+			if( start[k + 1] - start[k] == b ) by_size[nb++] = k;
+		}
+	}
+
+	for( i = 0; i < ndisp; i++ ) disp[i] = 0;
+
+	for( b = 0; b < nb; b++ )
+	{
+		size_t bucket = by_size[b];
+		size_t first = start[bucket], k = start[bucket + 1] - first, j, l;
+		int32_t d;
+
+		if( k == 1 )
+		{
+			while( slots[free_slot].key != 0 ) free_slot++;
+			slots[free_slot] = runs[member[first]];
+			disp[bucket] = -(int32_t)free_slot - 1;
+			continue;
+		}
+
+		for( d = 1; d < (1 << 24); d++ )
+		{
+			for( j = 0; j < k; j++ )
+			{
+				pick[j] = mph_slot(runs[member[first + j]].key, d, m);
+				if( slots[pick[j]].key != 0 ) break;
+				for( l = 0; l < j && pick[l] != pick[j]; l++ );
+				if( l < j ) break;
+			}
+			if( j == k ) break;
+		}
+
+		if( d == (1 << 24) )
+		{
+			errno = EOVERFLOW;
+			goto done;
+		}
+
+		for( j = 0; j < k; j++ ) slots[pick[j]] = runs[member[first + j]];
+		disp[bucket] = d;
+	}
+	ret = 0;
+
+done:
+	free(start);
+	return ret;
+}
+
+/** \brief Builds a name index in \p region over \p n records from their sorted-to-be \p pairs.
+
+    \returns 0 on success, -1 with errno set otherwise.
+*/
+static int build_name_index( struct name_pair *pairs, size_t n, bool perfect, struct sigregion *region,
+		struct signame_index *idx )
+{
+	struct signame_slot *runs = NULL, *slots;
+	uint64_t *keys;
+	uint32_t *order;
+	char *mem;
+	size_t m = 0, i, len;
+
+	qsort(pairs, n, sizeof(pairs[0]), name_pair_cmp);
+	for( i = 0; i < n; i++ )
+	{
+		if( i == 0 || pairs[i].key != pairs[i - 1].key ) m++;
+	}
+
+	if( perfect )
+	{
+		idx->nslots = m;
+		idx->ndisp = (m + 3) / 4;
+	}
+	else
+	{
+		for( idx->nslots = 2; idx->nslots < m * 2; idx->nslots *= 2 );
+		idx->ndisp = 0;
+	}
+
+	len = name_index_len(n, idx->nslots, idx->ndisp);
+	if( len == 0 )
+	{
+		errno = EOVERFLOW;
+		return -1;
+	}
+
+	mem = (char *) sigregion_alloc(region, len, 1, 64);
+	if( mem == NULL ) return -1;
+	name_index_place(idx, mem, len, n);
+
+	keys = (uint64_t *)mem;
+	order = (uint32_t *)idx->order;
+	slots = (struct signame_slot *)idx->slots;
+	for( i = 0; i < n; i++ )
+	{
+		keys[i] = pairs[i].key;
+		order[i] = pairs[i].rec;
+	}
+
+	if( perfect && (runs = (struct signame_slot *) checked_malloc(m, sizeof(runs[0]))) == NULL ) goto fail;
+
+	for( i = 0, m = 0; i < n; i++ )
+	{
+		struct signame_slot run;
+
+		if( i > 0 && keys[i] == keys[i - 1] ) continue;
+
+		run.key = keys[i];
+		run.pos = (uint32_t)i;
+		for( run.count = 1; i + run.count < n && keys[i + run.count] == run.key; run.count++ );
+
+		if( perfect )
+		{
+			runs[m] = run;
+		}
+		else
+		{
+			size_t h = (size_t)mix64(run.key) & (idx->nslots - 1);
+			while( slots[h].key != 0 ) h = (h + 1) & (idx->nslots - 1);
+			slots[h] = run;
+		}
+		m++;
+	}
+
+	if( perfect )
+	{
+		if( mph_build(runs, m, slots, (int32_t *)idx->disp, idx->ndisp) != 0 ) goto fail;
+		free(runs);
+	}
+
+	idx->mem = mem;
+	return 0;
+
+fail:
+	free(runs);
+	memset(idx, 0, sizeof(*idx));
+	return -1;
+}
+
+/** \brief Finds the slot of \p key in O(1).
+
+    Everything read from the index is range checked, since it may come from an image.
+*/
+static const struct signame_slot *name_slot( const struct signame_index *idx, size_t n, uint64_t key )
+{
+	const struct signame_slot *slot = NULL;
+
+	if( idx->nslots == 0 ) return NULL;
+
+	if( idx->disp )
+	{
+		int32_t d = idx->disp[mix64(key) % idx->ndisp];
+		size_t pos;
+
+		if( d == 0 ) return NULL;
+		pos = d < 0 ? (size_t)(-(int64_t)d - 1) : mph_slot(key, d, idx->nslots);
+		if( pos < idx->nslots && idx->slots[pos].key == key ) slot = &idx->slots[pos];
+	}
+	else
+	{
+		size_t h = (size_t)mix64(key) & (idx->nslots - 1);
+
+		for( ; idx->slots[h].key != 0; h = (h + 1) & (idx->nslots - 1) )
+		{
+			if( idx->slots[h].key == key )
+			{
+				slot = &idx->slots[h];
+				break;
+			}
+		}
+	}
+
+	if( slot && (slot->pos > n || n - slot->pos < slot->count) ) slot = NULL;
+	return slot;
+}
+
+static bool valid_name( const char *name, size_t len )
+{
+	size_t i;
+
+	if( len > SIGNAME_MAX ) return false;
+	for( i = 0; i < len; i++ )
+	{
+		if( is_space(name[i]) || name[i] == '\0' ) return false;
+	}
+	return true;
+}
+
+/* Times an index build as SIGSTATS_INDEX */
+static int sigstats_index( struct sigtable *tab, int (*build)( struct sigtable *tab ) )
+{
+	struct sigstats_timer timer;
+	int ret;
+
+	sigstats_start(&timer);
+	ret = build(tab);
+	sigstats_stop(&timer, SIGSTATS_INDEX);
+	return ret;
+}
+
+/* Builds the name index of sigtable_index_names() */
+static int build_names( struct sigtable *tab )
+{
+	struct name_pair *pairs;
+	size_t i;
+	int ret;
+
+	if( tab->names.nslots != 0 ) return 0;
+
+	if( tab->pager )
+	{
+		errno = ENOTSUP;
+		return -1;
+	}
+
+	if( tab->size > INT32_MAX )
+	{
+		errno = EOVERFLOW;
+		return -1;
+	}
+
+	pairs = (struct name_pair *) checked_malloc(tab->size, sizeof(pairs[0]));
+	if( pairs == NULL ) return -1;
+
+	for( i = 0; i < tab->size; i++ )
+	{
+		struct sigview view;
+
+		if( sigtable_get(tab, i, &view) == NULL )
+		{
+			free(pairs);
+			return -1;
+		}
+		pairs[i].key = name_key(view.name, view.name_len);
+		pairs[i].rec = (uint32_t)i;
+	}
+
+	ret = build_name_index(pairs, tab->size, false, &tab->region, &tab->names);
+	free(pairs);
+	return ret;
+}
+
+/** \brief Builds the name index of a text table, images carry their own.
+
+    \returns 0 on success or if the index exists, -1 with errno set otherwise.
+*/
+int sigtable_index_names( struct sigtable *tab )
+{
+	if( tab->names.nslots != 0 ) return 0;
+	return sigstats_index(tab, build_names);
+}
+
+/** \brief Looks up the records named \p name, ignoring case.
+
+    \returns The number of matches, whose record numbers are stored at \p *recs in
+             database order.
+*/
+size_t sigtable_find_name( const struct sigtable *tab, const char *name, size_t len, const uint32_t **recs )
+{
+	const struct signame_slot *slot;
+
+	if( len == 0 || !valid_name(name, len) ) return 0;
+
+	slot = name_slot(&tab->names, tab->size, name_key(name, len));
+	if( slot == NULL ) return 0;
+
+	*recs = tab->names.order + slot->pos;
+	return slot->count;
+}
+
+static size_t lower_bound_u64( const uint64_t *keys, size_t n, uint64_t key )
+{
+	size_t lo = 0;
+
+	while( n > 0 )
+	{
+		size_t half = n / 2;
+		if( keys[lo + half] < key )
+		{
+			lo += half + 1;
+			n -= half + 1;
+		}
+		else
+		{
+			n = half;
+		}
+	}
+	return lo;
+}
+
+/** \brief Looks up the records whose name starts with \p prefix, ignoring case.
+
+    Matching names sort next to each other, so this takes two binary searches over
+    the integer keys rather than a scan of the names.
+
+    \returns The number of matches, whose record numbers are stored at \p *recs
+             ordered by name.
+*/
+size_t sigtable_find_prefix( const struct sigtable *tab, const char *prefix, size_t len, const uint32_t **recs )
+{
+	uint64_t lo, hi;
+	size_t first, last;
+
+	if( tab->names.keys == NULL || !valid_name(prefix, len) ) return 0;
+
+	lo = name_key(prefix, len) & ~(uint64_t)0xff;
+	hi = lo | (((uint64_t)1 << (8 * (SIGNAME_MAX - len + 1))) - 1);
+
+	first = lower_bound_u64(tab->names.keys, tab->size, lo);
+	last = hi == UINT64_MAX ? tab->size : lower_bound_u64(tab->names.keys, tab->size, hi + 1);
+
+	*recs = tab->names.order + first;
+	return last - first;
+}
+
+static bool is_word( char c )
+{
+	return (c >= '0' && c <= '9') || ((c | 0x20) >= 'a' && (c | 0x20) <= 'z');
+}
+
+/** \brief Finds the next word of \p text at or after \p *pos.
+
+    \returns The length of the word starting at the updated \p *pos, 0 if there is none.
+*/
+static size_t next_word( const char *text, size_t len, size_t *pos )
+{
+	size_t i = *pos, start;
+
+	while( i < len && !is_word(text[i]) ) i++;
+	for( start = i; i < len && is_word(text[i]); i++ );
+
+	*pos = start;
+	return i - start;
+}
+
+static uint64_t word_hash( const char *word, size_t len )
+{
+	uint64_t sum = FNV1A_INIT;
+	size_t i;
+
+	for( i = 0; i < len; i++ )
+	{
+		sum ^= (unsigned char)(word[i] | 0x20);
+		sum *= UINT64_C(1099511628211);
+	}
+	return sum;
+}
+
+static bool word_eq( const char *lhs, const char *rhs, size_t len )
+{
+	size_t i;
+
+	for( i = 0; i < len; i++ )
+	{
+		if( (lhs[i] | 0x20) != (rhs[i] | 0x20) ) return false;
+	}
+	return true;
+}
+
+/** \brief The description of record \p rec as printed, up to a NUL byte, or empty if corrupt.
+
+    \p *desc may point into \p view, which must stay in scope while it is used.
+*/
+static size_t desc_text( const struct sigtable *tab, size_t rec, struct sigview *view, const char **desc )
+{
+	if( sigtable_get(tab, rec, view) == NULL )
+	{
+		*desc = "";
+		return 0;
+	}
+	*desc = view->desc;
+	return strnlen(view->desc, view->desc_len);
+}
+
+/** \brief Finds the slot of a word, or the empty slot it would go into. */
+static uint32_t *text_slot( const struct sigtable *tab, const struct sigtext_index *idx,
+	const char *word, size_t len, uint64_t hash )
+{
+	size_t h = (size_t)mix64(hash) & (idx->nslots - 1);
+
+	for( ; idx->slots[h] != 0; h = (h + 1) & (idx->nslots - 1) )
+	{
+		const struct sigtext_term *term = &idx->terms[idx->slots[h] - 1];
+		struct sigview view;
+		const char *desc;
+
+		if( term->hash == hash && term->len == len
+			&& desc_text(tab, term->rec, &view, &desc) >= (size_t)term->off + len
+			&& word_eq(desc + term->off, word, len) )
+		{
+			break;
+		}
+	}
+	return &idx->slots[h];
+}
+
+static int text_grow( struct sigtext_index *idx )
+{
+	size_t nslots = idx->nslots * 2, i;
+	uint32_t *slots = (uint32_t *) calloc(nslots, sizeof(slots[0]));
+
+	if( slots == NULL ) return -1;
+
+	for( i = 0; i < idx->nslots; i++ )
+	{
+		size_t h;
+
+		if( idx->slots[i] == 0 ) continue;
+		h = (size_t)mix64(idx->terms[idx->slots[i] - 1].hash) & (nslots - 1);
+		while( slots[h] != 0 ) h = (h + 1) & (nslots - 1);
+		slots[h] = idx->slots[i];
+	}
+
+	free(idx->slots);
+	idx->slots = slots;
+	idx->nslots = nslots;
+	return 0;
+}
+
+/* Builds the text index of sigtable_index_text() */
+static int build_text( struct sigtable *tab )
+{
+	struct sigtext_index idx;
+	struct sigtext_term *terms;
+	uint32_t *last = NULL, *seq = NULL, *slots;
+	uint8_t *per_rec = NULL;
+	size_t cap = 0, seq_cap = 0, rec, t, i;
+
+	if( tab->text.slots != NULL ) return 0;
+
+	if( tab->pager )
+	{
+		errno = ENOTSUP;
+		return -1;
+	}
+
+	if( tab->size >= UINT32_MAX )
+	{
+		errno = EOVERFLOW;
+		return -1;
+	}
+
+	memset(&idx, 0, sizeof(idx));
+	idx.nslots = 1024;
+	if( (idx.slots = (uint32_t *) calloc(idx.nslots, sizeof(idx.slots[0]))) == NULL ) return -1;
+	if( (per_rec = (uint8_t *) calloc(tab->size, sizeof(per_rec[0]))) == NULL ) goto fail;
+
+	/* terms[t].end counts the records of term t, last[t] is its latest record + 1,
+	   seq lists the terms of every record in turn and per_rec how many there are */
+	for( rec = 0; rec < tab->size; rec++ )
+	{
+		struct sigview view;
+		const char *desc;
+		size_t len = desc_text(tab, rec, &view, &desc), pos, wlen;
+
+		for( pos = 0; (wlen = next_word(desc, len, &pos)) != 0; pos += wlen )
+		{
+			uint64_t hash = word_hash(desc + pos, wlen);
+			uint32_t *slot = text_slot(tab, &idx, desc + pos, wlen, hash);
+
+			if( *slot == 0 )
+			{
+				struct sigtext_term *term;
+
+				if( idx.nterms == cap )
+				{
+					uint32_t *grown;
+
+					cap = cap ? cap * 2 : 1024;
+					if( (terms = (struct sigtext_term *) realloc(idx.terms, cap * sizeof(terms[0]))) == NULL ) goto fail;
+					idx.terms = terms;
+					if( (grown = (uint32_t *) realloc(last, cap * sizeof(grown[0]))) == NULL ) goto fail;
+					last = grown;
+				}
+
+				term = &idx.terms[idx.nterms];
+				term->hash = hash;
+				term->end = 0;
+				term->rec = (uint32_t)rec;
+				term->off = (uint8_t)pos;
+				term->len = (uint8_t)wlen;
+				last[idx.nterms] = 0;
+				*slot = (uint32_t)++idx.nterms;
+
+				if( idx.nterms * 2 > idx.nslots && text_grow(&idx) != 0 ) goto fail;
+				slot = text_slot(tab, &idx, desc + pos, wlen, hash);
+			}
+
+			t = *slot - 1;
+			if( last[t] != rec + 1 )
+			{
+				if( idx.npostings == seq_cap )
+				{
+					uint32_t *grown;
+
+					seq_cap = seq_cap ? seq_cap * 2 : 4096;
+					if( (grown = (uint32_t *) realloc(seq, seq_cap * sizeof(grown[0]))) == NULL ) goto fail;
+					seq = grown;
+				}
+
+				last[t] = (uint32_t)(rec + 1);
+				idx.terms[t].end++;
+				seq[idx.npostings++] = (uint32_t)t;
+				per_rec[rec]++;
+			}
+		}
+	}
+
+	/* turn the counts into the end of each list */
+	for( t = 1; t < idx.nterms; t++ ) idx.terms[t].end += idx.terms[t - 1].end;
+
+	idx.postings = (uint32_t *) sigregion_alloc(&tab->region, idx.npostings ? idx.npostings : 1,
+		sizeof(idx.postings[0]), 64);
+	if( idx.postings == NULL ) goto fail;
+
+	for( rec = tab->size, i = idx.npostings; rec-- > 0; )
+	{
+		size_t n;
+
+		for( n = per_rec[rec]; n > 0; n-- )
+		{
+			t = seq[--i];
+			idx.postings[--idx.terms[t].end] = (uint32_t)rec;
+		}
+	}
+
+	/* terms[t].end is now where the list of t begins, which is where the list before ends */
+	for( t = 0; t + 1 < idx.nterms; t++ ) idx.terms[t].end = idx.terms[t + 1].end;
+	if( idx.nterms > 0 ) idx.terms[idx.nterms - 1].end = idx.npostings;
+
+	/* the tables grew while building, keep them in the region at their final size */
+	slots = (uint32_t *) sigregion_alloc(&tab->region, idx.nslots, sizeof(slots[0]), 64);
+	terms = (struct sigtext_term *) sigregion_alloc(&tab->region, idx.nterms ? idx.nterms : 1, sizeof(terms[0]), 64);
+	if( slots == NULL || terms == NULL ) goto fail;
+	memcpy(slots, idx.slots, idx.nslots * sizeof(slots[0]));
+	if( idx.nterms > 0 ) memcpy(terms, idx.terms, idx.nterms * sizeof(terms[0]));
+
+	free(last);
+	free(seq);
+	free(per_rec);
+	free(idx.slots);
+	free(idx.terms);
+	idx.slots = slots;
+	idx.terms = terms;
+	tab->text = idx;
+	return 0;
+
+fail:
+	free(last);
+	free(seq);
+	free(per_rec);
+	free(idx.slots);
+	free(idx.terms);
+	return -1;
+}
+
+/** \brief Builds the inverted index over the descriptions of \p tab.
+
+    One pass over the descriptions numbers the terms and notes the terms of each
+    record. A counting sort over those notes then fills the posting lists back to
+    front, so every list comes out ascending without sorting or hashing again.
+
+    \returns 0 on success or if the index exists, -1 with errno set otherwise.
+*/
+int sigtable_index_text( struct sigtable *tab )
+{
+	if( tab->text.slots != NULL ) return 0;
+	return sigstats_index(tab, build_text);
+}
+
+/** \brief Finds the first position at or after \p from where \p list holds \p key or more.
+
+    Gallops ahead from \p from, so walking a list in ascending key order is fast even
+    when most of it is skipped.
+*/
+static size_t gallop_u32( const uint32_t *list, size_t n, size_t from, uint32_t key )
+{
+	size_t step = 1, lo = from, hi;
+
+	if( lo >= n || list[lo] >= key ) return lo;
+
+	/* list[lo] < key, double the step until list[hi] >= key */
+	for( hi = lo + 1; hi < n && list[hi] < key; step *= 2 )
+	{
+		lo = hi;
+		hi = lo + step;
+	}
+	if( hi > n ) hi = n;
+
+	while( hi - lo > 1 )
+	{
+		size_t mid = lo + (hi - lo) / 2;
+
+		if( list[mid] < key )
+		{
+			lo = mid;
+		}
+		else
+		{
+			hi = mid;
+		}
+	}
+	return hi;
+}
+
+/* Most words a search may have */
+#define SEARCH_WORDS 16
+
+/** \brief A word of a search and its posting list. */
+struct search_term {
+	const char *word;
+	size_t len;
+	const uint32_t *list;
+	size_t n;
+	size_t cur;
+};
+
+/** \brief Checks that the words of \p terms follow each other in the description of \p rec. */
+static bool phrase_at( const struct sigtable *tab, size_t rec, const struct search_term *terms, size_t k )
+{
+	struct sigview view;
+	const char *desc;
+	size_t len = desc_text(tab, rec, &view, &desc);
+	size_t starts[SIGLINE_MAX / 2 + 1], lens[SIGLINE_MAX / 2 + 1];
+	size_t n = 0, pos, wlen, i, j;
+
+	for( pos = 0; (wlen = next_word(desc, len, &pos)) != 0; pos += wlen )
+	{
+		starts[n] = pos;
+		lens[n++] = wlen;
+	}
+
+	for( i = 0; i + k <= n; i++ )
+	{
+		for( j = 0; j < k && lens[i + j] == terms[j].len && word_eq(desc + starts[i + j], terms[j].word, terms[j].len); j++ );
+		if( j == k ) return true;
+	}
+	return false;
+}
+
+/** \brief Finds the records whose description contains every word of \p query.
+
+    A query in double quotes is a phrase, its words must appear in order next to each
+    other. Words ignore case like the index does. The posting lists are intersected
+    starting from the shortest, galloping through the longer ones, and phrases are
+    then checked against the candidates' descriptions.
+
+    \p match is called with every matching record in database order, a non-zero
+    return stops the search. The text index must have been built.
+
+    \returns The number of matching records, or -1 if the query has no words (errno
+             is EINVAL) or \p match stopped the search.
+*/
+ssize_t sigtable_search( const struct sigtable *tab, const char *query, size_t len,
+	int (*match)( void *arg, size_t rec ), void *arg )
+{
+	const struct sigtext_index *idx = &tab->text;
+	struct search_term terms[SEARCH_WORDS], *by_size[SEARCH_WORDS];
+	size_t k = 0, pos, wlen, i, j;
+	ssize_t found = 0;
+	bool phrase = len > 0 && query[0] == '"';
+
+	if( phrase )
+	{
+		const char *quote = (const char *)memchr(query + 1, '"', len - 1);
+
+		len = (quote ? (size_t)(quote - query) : len) - 1;
+		query++;
+	}
+
+	for( pos = 0; (wlen = next_word(query, len, &pos)) != 0; pos += wlen )
+	{
+		const uint32_t *slot;
+
+		if( k == SEARCH_WORDS || idx->nslots == 0 )
+		{
+			errno = EINVAL;
+			return -1;
+		}
+
+		terms[k].word = query + pos;
+		terms[k].len = wlen;
+		terms[k].cur = 0;
+		slot = text_slot(tab, idx, query + pos, wlen, word_hash(query + pos, wlen));
+		if( *slot == 0 )
+		{
+			terms[k].list = NULL;
+			terms[k].n = 0;
+		}
+		else
+		{
+			uint64_t first = *slot > 1 ? idx->terms[*slot - 2].end : 0;
+
+			terms[k].list = idx->postings + first;
+			terms[k].n = (size_t)(idx->terms[*slot - 1].end - first);
+		}
+
+		/* insert by list length, the shortest list drives the intersection */
+		for( i = k; i > 0 && by_size[i - 1]->n > terms[k].n; i-- ) by_size[i] = by_size[i - 1];
+		by_size[i] = &terms[k];
+		k++;
+	}
+
+	if( k == 0 )
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	for( i = 0; i < by_size[0]->n; i++ )
+	{
+		uint32_t rec = by_size[0]->list[i];
+
+		for( j = 1; j < k; j++ )
+		{
+			struct search_term *term = by_size[j];
+
+			term->cur = gallop_u32(term->list, term->n, term->cur, rec);
+			if( term->cur == term->n ) return found;
+			if( term->list[term->cur] != rec ) break;
+		}
+		if( j < k ) continue;
+
+		if( phrase && k > 1 && !phrase_at(tab, rec, terms, k) ) continue;
+
+		found++;
+		if( match(arg, rec) != 0 ) return -1;
+	}
+	return found;
+}
+
+/* Lays out the subtree of \p k of the Eytzinger array from \p sorted, starting at rank \p i */
+static size_t eytz_fill( uint16_t *eytz, uint32_t *rank, const uint16_t *sorted, size_t n, size_t k, size_t i )
+{
+	if( k <= n )
+	{
+		i = eytz_fill(eytz, rank, sorted, n, 2 * k, i);
+		eytz[k] = sorted[i];
+		rank[k] = (uint32_t)i;
+		i = eytz_fill(eytz, rank, sorted, n, 2 * k + 1, i + 1);
+	}
+	return i;
+}
+
+/* Builds the signal number index of sigtable_index_signums() */
+static int build_signums( struct sigtable *tab )
+{
+	struct signum_index *idx = &tab->nums;
+	size_t n = tab->size, eytz_len, i;
+	uint32_t *count, *order, *rank;
+	uint16_t *sorted, *eytz;
+	char *mem;
+
+	if( idx->mem != NULL ) return 0;
+
+	if( tab->pager )
+	{
+		errno = ENOTSUP;
+		return -1;
+	}
+
+	if( n >= UINT32_MAX )
+	{
+		errno = EOVERFLOW;
+		return -1;
+	}
+
+	/* eytz padded to a multiple of 4 bytes, rank, then order; eytz starts a cache line */
+	eytz_len = ((n + 1) * sizeof(eytz[0]) + 3) & ~(size_t)3;
+	idx->mem_len = eytz_len + (n + 1) * sizeof(rank[0]) + n * sizeof(order[0]);
+	count = (uint32_t *) checked_malloc(USHRT_MAX + 2, sizeof(count[0]));
+	sorted = (uint16_t *) checked_malloc(n + 1, sizeof(sorted[0]));
+	mem = (char *) sigregion_alloc(&tab->region, idx->mem_len, 1, 64);
+	if( count == NULL || sorted == NULL || mem == NULL )
+	{
+		free(count);
+		free(sorted);
+		return -1;
+	}
+
+	eytz = (uint16_t *)mem;
+	rank = (uint32_t *)(mem + eytz_len);
+	order = rank + n + 1;
+
+	memset(count, 0, (USHRT_MAX + 2) * sizeof(count[0]));
+	for( i = 0; i < n; i++ ) count[tab->hot[i].signum + 1]++;
+	for( i = 1; i <= USHRT_MAX + 1; i++ ) count[i] += count[i - 1];
+	for( i = 0; i < n; i++ )
+	{
+		uint32_t pos = count[tab->hot[i].signum]++;
+		order[pos] = (uint32_t)i;
+		sorted[pos] = tab->hot[i].signum;
+	}
+
+	eytz[0] = 0;
+	rank[0] = (uint32_t)n;
+	eytz_fill(eytz, rank, sorted, n, 1, 0);
+
+	free(count);
+	free(sorted);
+	idx->eytz = eytz;
+	idx->rank = rank;
+	idx->order = order;
+	idx->n = n;
+	idx->mem = mem;
+	return 0;
+}
+
+/** \brief Builds the signal number index of \p tab.
+
+    A counting sort over the 16-bit signal numbers orders the records in linear time
+    and keeps equal numbers in database order.
+
+    \returns 0 on success or if the index exists, -1 with errno set otherwise.
+*/
+int sigtable_index_signums( struct sigtable *tab )
+{
+	if( tab->nums.mem != NULL ) return 0;
+	return sigstats_index(tab, build_signums);
+}
+
+/** \brief The rank of the first record numbered \p signum or higher, n if there is none.
+
+    Each step prefetches five levels ahead, where the 32 descendants of the current
+    node are adjacent and fill one cache line.
+*/
+static size_t signum_lower_bound( const struct signum_index *idx, unsigned signum )
+{
+	size_t k = 1;
+
+	while( k <= idx->n )
+	{
+		__builtin_prefetch(idx->eytz + 32 * k);
+		k = 2 * k + (idx->eytz[k] < signum);
+	}
+	/* undo the right turns taken after the last left turn, k == 0 if there was none */
+	k >>= __builtin_ctzll(~(unsigned long long)k) + 1;
+	return idx->rank[k];
+}
+
+/** \brief Looks up the records numbered \p signum, the index must have been built by sigtable_index_signums().
+
+    \returns The number of matches, whose record numbers are stored at \p *recs in
+             database order.
+*/
+size_t sigtable_find_signum( const struct sigtable *tab, unsigned signum, const uint32_t **recs )
+{
+	const struct signum_index *idx = &tab->nums;
+	size_t begin, end;
+
+	if( idx->mem == NULL || signum > USHRT_MAX ) return 0;
+
+	begin = signum_lower_bound(idx, signum);
+	end = signum == USHRT_MAX ? idx->n : signum_lower_bound(idx, signum + 1);
+	*recs = idx->order + begin;
+	return end - begin;
+}
+
+/** \brief Calls \p match for every record numbered \p lo to \p hi, in signal number order.
+
+    The index must have been built by sigtable_index_signums().
+
+    \returns The number of matches, or -1 with errno set if there is no index or
+             \p match returned non-zero.
+*/
+ssize_t sigtable_find_signums( const struct sigtable *tab, unsigned lo, unsigned hi,
+	int (*match)( void *arg, size_t rec ), void *arg )
+{
+	const struct signum_index *idx = &tab->nums;
+	size_t begin, end, i;
+
+	if( idx->mem == NULL )
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	if( lo > hi || lo > USHRT_MAX ) return 0;
+
+	begin = signum_lower_bound(idx, lo);
+	end = hi >= USHRT_MAX ? idx->n : signum_lower_bound(idx, hi + 1);
+	for( i = begin; i < end; i++ )
+	{
+		if( match(arg, idx->order[i]) != 0 ) return -1;
+	}
+	return (ssize_t)(end - begin);
+}
+
+/** \brief Builds the name, text and signal number indexes, as needed before a table is shared between threads.
+
+    \returns 0 on success, -1 with errno set otherwise.
+*/
+int sigtable_index( struct sigtable *tab )
+{
+	return sigtable_index_names(tab) == 0 && sigtable_index_text(tab) == 0
+		&& sigtable_index_signums(tab) == 0 ? 0 : -1;
+}
+
+/** \brief Validates the image header in \p tab->map and sets up the table and heap.
+
+    Only the header is checked, so this takes constant time. Entries are bounds
+    checked on access by sigtable_get() and sigimage_verify() checks the contents.
+
+    \returns 0 on success, -1 with errno set to EINVAL otherwise.
+*/
+static int sigimage_attach( struct sigtable *tab )
+{
+	struct sigimage_header hdr;
+	const char *base = (const char *)tab->map;
+
+	if( tab->map_len < sizeof(hdr) ) goto invalid;
+	memcpy(&hdr, base, sizeof(hdr));
+
+	if( hdr.version != SIGIMAGE_VERSION
+		|| hdr.byte_order != SIGIMAGE_BYTE_ORDER
+		|| hdr.header_sum != sigimage_header_sum(&hdr)
+		|| hdr.count == 0
+		|| hdr.table_off % sizeof(uint64_t) != 0
+		|| hdr.table_off > tab->map_len
+		|| hdr.count > (tab->map_len - hdr.table_off) / sizeof(struct sighot)
+		|| hdr.heap_off > tab->map_len
+		|| hdr.heap_len > tab->map_len - hdr.heap_off
+		|| hdr.index_off % sizeof(uint64_t) != 0
+		|| hdr.index_off > tab->map_len
+		|| hdr.index_len > tab->map_len - hdr.index_off )
+	{
+		goto invalid;
+	}
+
+	if( hdr.name_slots == 0 || hdr.name_slots > hdr.count
+		|| hdr.name_disp == 0 || hdr.name_disp > hdr.count )
+	{
+		goto invalid;
+	}
+
+	tab->names.nslots = (size_t)hdr.name_slots;
+	tab->names.ndisp = (size_t)hdr.name_disp;
+	if( name_index_place(&tab->names, base + hdr.index_off, (size_t)hdr.index_len, (size_t)hdr.count) != 0 )
+	{
+		goto invalid;
+	}
+
+	tab->hot = (struct sighot *)(base + hdr.table_off);
+	tab->arena = base + hdr.heap_off;
+	tab->arena_len = (size_t)hdr.heap_len;
+	tab->size = (size_t)hdr.count;
+	tab->image = true;
+	return 0;
+
+invalid:
+	errno = EINVAL;
+	return -1;
+}
+
+/** \brief Unlinks \p page from the LRU list of \p pager. */
+static void sigpager_unlink( struct sigpager *pager, struct sigpage *page )
+{
+	if( page->newer ) page->newer->older = page->older;
+	else pager->newest = page->older;
+	if( page->older ) page->older->newer = page->newer;
+	else pager->oldest = page->newer;
+}
+
+static void sigpager_push( struct sigpager *pager, struct sigpage *page )
+{
+	page->newer = NULL;
+	page->older = pager->newest;
+	if( pager->newest ) pager->newest->newer = page;
+	else pager->oldest = page;
+	pager->newest = page;
+}
+
+static void sigpager_evict( struct sigpager *pager, struct sigpage *page )
+{
+	struct sigpage **link = &pager->buckets[mix64(page->page) & (pager->nbuckets - 1)];
+
+	while( *link != page ) link = &(*link)->chain;
+	*link = page->chain;
+	sigpager_unlink(pager, page);
+	pager->resident -= sizeof(*page) + page->len;
+	free(page);
+}
+
+/** \brief Finds page \p n in the cache or reads it with one pread().
+
+    \returns The page, or NULL with errno set if it cannot be read. errno is EIO if the
+             file no longer holds the records it was indexed with.
+*/
+static struct sigpage *sigpager_page( struct sigpager *pager, uint64_t n )
+{
+	struct sigpage **bucket = &pager->buckets[mix64(n) & (pager->nbuckets - 1)], *page;
+	uint64_t off = pager->page_off[n];
+	size_t len = (size_t)(pager->page_off[n + 1] - off), count, i, done = 0;
+	const char *pos;
+
+	for( page = *bucket; page != NULL; page = page->chain )
+	{
+		if( page->page == n )
+		{
+			pager->hits++;
+			sigpager_unlink(pager, page);
+			sigpager_push(pager, page);
+			return page;
+		}
+	}
+
+	pager->misses++;
+	if( len > SIZE_MAX - sizeof(*page) )
+	{
+		errno = EOVERFLOW;
+		return NULL;
+	}
+	page = (struct sigpage *) malloc(sizeof(*page) + len);
+	if( page == NULL ) return NULL;
+	page->page = n;
+	page->len = len;
+	page->data = (char *)(page + 1);
+
+	/* a single call unless the read is interrupted or short */
+	while( done < len )
+	{
+		ssize_t got = pread(pager->fd, page->data + done, len - done, (off_t)(off + done));
+		if( got < 0 && errno == EINTR ) continue;
+		if( got <= 0 )
+		{
+			if( got == 0 ) errno = EIO;
+			free(page);
+			return NULL;
+		}
+		done += (size_t)got;
+	}
+
+	count = n + 1 < pager->npages ? SIGPAGE_RECORDS : pager->size - n * SIGPAGE_RECORDS;
+	for( i = 0, pos = page->data; i < count; i++ )
+	{
+		pos = parse_record(page->data, pos, page->data + len, &page->hot[i]);
+		if( pos == NULL )
+		{
+			free(page);
+			errno = EIO;
+			return NULL;
+		}
+	}
+
+	page->chain = *bucket;
+	*bucket = page;
+	sigpager_push(pager, page);
+	pager->resident += sizeof(*page) + len;
+
+	while( pager->resident > pager->budget && pager->oldest != page )
+	{
+		sigpager_evict(pager, pager->oldest);
+		pager->evictions++;
+	}
+	return page;
+}
+
+/** \brief Indexes the pages of the \p len byte database \p buf, read from \p fd.
+
+    \returns A pager for \p size records, or NULL with errno set on error.
+*/
+static struct sigpager *sigpager_create( int fd, const char *buf, size_t len, size_t budget, size_t *size )
+{
+	const char *pos, *end = buf + len;
+	struct sigpager *pager;
+	size_t i, nbuckets;
+
+	pos = parse_size(buf, end, size);
+	if( NULL == pos || *size > len / 4 + 1 )
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	pager = (struct sigpager *) checked_malloc(1, sizeof(*pager));
+	if( pager == NULL ) return NULL;
+	memset(pager, 0, sizeof(*pager));
+	pager->size = *size;
+	pager->budget = budget;
+	pager->npages = (*size + SIGPAGE_RECORDS - 1) / SIGPAGE_RECORDS;
+
+	/* about one bucket per page the budget can hold */
+	for( nbuckets = 16; nbuckets < pager->npages && nbuckets < budget / sizeof(struct sigpage); nbuckets *= 2 );
+	pager->nbuckets = nbuckets;
+
+	pager->page_off = (uint64_t *) checked_malloc(pager->npages + 1, sizeof(pager->page_off[0]));
+	pager->buckets = (struct sigpage **) calloc(nbuckets, sizeof(pager->buckets[0]));
+	if( pager->page_off == NULL || pager->buckets == NULL ) goto fail;
+
+	for( i = 0; i < *size; i++ )
+	{
+		struct sighot hot;
+
+		if( i % SIGPAGE_RECORDS == 0 ) pager->page_off[i / SIGPAGE_RECORDS] = (uint64_t)(pos - buf);
+		pos = parse_record(buf, pos, end, &hot);
+		if( pos == NULL )
+		{
+			errno = EINVAL;
+			goto fail;
+		}
+	}
+	pager->page_off[pager->npages] = (uint64_t)(pos - buf);
+
+	pager->fd = fcntl(fd, F_DUPFD_CLOEXEC, 0);
+	if( pager->fd < 0 ) goto fail;
+	return pager;
+
+fail:
+	free(pager->page_off);
+	free(pager->buckets);
+	free(pager);
+	return NULL;
+}
+
+static void sigpager_destroy( struct sigpager *pager )
+{
+	if( pager )
+	{
+		while( pager->oldest ) sigpager_evict(pager, pager->oldest);
+		close(pager->fd);
+		free(pager->page_off);
+		free(pager->buckets);
+		free(pager);
+	}
+}
+
+/** \brief Prints the size of the page index and the cache statistics of \p pager. */
+void sigpager_report( const struct sigpager *pager, FILE *out )
+{
+	uint64_t lookups = pager->hits + pager->misses;
+
+	fprintf(out, "page index:     %zu bytes (%zu pages of %d records)\n",
+		(pager->npages + 1) * sizeof(pager->page_off[0]), pager->npages, SIGPAGE_RECORDS);
+	fprintf(out, "page cache:     %zu of %zu bytes resident\n", pager->resident, pager->budget);
+	fprintf(out, "cache hits:     %llu of %llu (%.1f%%), %llu evictions\n",
+		(unsigned long long)pager->hits, (unsigned long long)lookups,
+		lookups ? 100.0 * (double)pager->hits / (double)lookups : 0.0,
+		(unsigned long long)pager->evictions);
+}
+
+/* Records the symbols of sigtable_pack() are trained on, and the rounds of training */
+#define SIGPACK_SAMPLE 16384
+#define SIGPACK_ROUNDS 5
+/* Training counts symbols by code and escaped bytes by 256 + byte */
+#define SIGPACK_UNITS 512
+
+/* Whether tables opened or loaded from now on are packed right after parsing */
+bool sigpack_on_load = false;
+
+/** \brief The bits of a word loaded with memcpy() that hold its first \p len bytes. */
+static uint64_t sigpack_mask( size_t len )
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	return len >= 8 ? ~(uint64_t)0 : ~(~(uint64_t)0 >> (8 * len));
+#else
+	return len >= 8 ? ~(uint64_t)0 : ((uint64_t)1 << (8 * len)) - 1;
+#endif
+}
+
+/** \brief The codes of a struct sigpack arranged for encoding.
+
+    Symbols of two bytes or more are listed by their first two, longest first, so the
+    first that matches is the longest. Single bytes are looked up directly.
+*/
+struct sigpack_enc {
+	const struct sigpack *pack;
+	uint8_t single[256];
+	uint8_t order[SIGPACK_SYMBOLS];
+	uint16_t first[65537];
+};
+
+/* The first two bytes of \p symbol as an index of struct sigpack_enc */
+static size_t sigpack_prefix( uint64_t symbol )
+{
+	unsigned char bytes[sizeof(symbol)];
+
+	memcpy(bytes, &symbol, sizeof(symbol));
+	return (size_t)bytes[0] | (size_t)bytes[1] << 8;
+}
+
+static void sigpack_enc_init( struct sigpack_enc *enc, const struct sigpack *pack )
+{
+	size_t i, code, len;
+	uint16_t total;
+
+	enc->pack = pack;
+	memset(enc->single, SIGPACK_ESCAPE, sizeof(enc->single));
+	memset(enc->first, 0, sizeof(enc->first));
+	for( code = 0; code < pack->nsymbols; code++ )
+	{
+		if( pack->len[code] == 1 ) enc->single[sigpack_prefix(pack->symbol[code])] = (uint8_t)code;
+		else enc->first[sigpack_prefix(pack->symbol[code]) + 1]++;
+	}
+	for( i = 1; i <= 65536; i++ ) enc->first[i] += enc->first[i - 1];
+	total = enc->first[65536];
+
+	/* fill each list from its end, shortest first, which leaves first[k + 1] where list k starts */
+	for( len = 2; len <= sizeof(uint64_t); len++ )
+	{
+		for( code = 0; code < pack->nsymbols; code++ )
+		{
+			if( pack->len[code] == len ) enc->order[--enc->first[sigpack_prefix(pack->symbol[code]) + 1]] = (uint8_t)code;
+		}
+	}
+	memmove(enc->first, enc->first + 1, 65536 * sizeof(enc->first[0]));
+	enc->first[65536] = total;
+}
+
+/** \brief Finds the longest symbol at \p pos, where \p left bytes of text and at least 8 can be read.
+
+    \returns Its code with its length in \p *len, or SIGPACK_ESCAPE and 1 if none matches.
+*/
+static unsigned sigpack_match( const struct sigpack_enc *enc, const unsigned char *pos, size_t left, size_t *len )
+{
+	const struct sigpack *pack = enc->pack;
+	size_t prefix = (size_t)pos[0] | (size_t)pos[1] << 8, i;
+	uint64_t word;
+
+	memcpy(&word, pos, sizeof(word));
+	for( i = enc->first[prefix]; i < enc->first[prefix + 1]; i++ )
+	{
+		unsigned code = enc->order[i];
+
+		if( pack->len[code] <= left && (word & sigpack_mask(pack->len[code])) == pack->symbol[code] )
+		{
+			*len = pack->len[code];
+			return code;
+		}
+	}
+
+	*len = 1;
+	return enc->single[pos[0]];
+}
+/** \brief Encodes \p len bytes of \p text, which can be read 8 bytes further, into \p out.
+
+    \returns The number of bytes written, at most 2 * \p len.
+*/
+static size_t sigpack_encode( const struct sigpack_enc *enc, const unsigned char *text, size_t len, unsigned char *out )
+{
+	size_t pos, step, n = 0;
+
+	for( pos = 0; pos < len; pos += step )
+	{
+		unsigned code = sigpack_match(enc, text + pos, len - pos, &step);
+
+		out[n++] = (unsigned char)code;
+		if( code == SIGPACK_ESCAPE ) out[n++] = text[pos];
+	}
+	return n;
+}
+
+/** \brief Decodes exactly \p out_len bytes from the \p in_len bytes at \p in.
+
+    Every symbol is copied as a whole word, so \p out must have room for 8 bytes more.
+
+    \returns 0 on success, -1 if the codes are corrupt.
+*/
+static int sigpack_decode( const struct sigpack *pack, const unsigned char *in, size_t in_len, char *out, size_t out_len )
+{
+	size_t i = 0, n = 0;
+
+	while( n < out_len )
+	{
+		unsigned code;
+
+		if( i >= in_len ) return -1;
+		code = in[i++];
+		if( code == SIGPACK_ESCAPE )
+		{
+			if( i >= in_len ) return -1;
+			out[n++] = (char)in[i++];
+		}
+		else
+		{
+			if( code >= pack->nsymbols ) return -1;
+			memcpy(out + n, &pack->symbol[code], sizeof(pack->symbol[code]));
+			n += pack->len[code];
+		}
+	}
+	return n == out_len ? 0 : -1;
+}
+
+/** \brief Copies the name, a space and the description of \p view to \p buf, followed by 8 zero bytes.
+
+    \returns The length of the text.
+*/
+static size_t sigpack_text( const struct sigview *view, unsigned char *buf )
+{
+	size_t len = (size_t)view->name_len + 1 + view->desc_len;
+
+	memcpy(buf, view->name, view->name_len);
+	buf[view->name_len] = ' ';
+	memcpy(buf + view->name_len + 1, view->desc, view->desc_len);
+	memset(buf + len, 0, 8);
+	return len;
+}
+
+/** \brief A symbol sigpack_train() may pick and the bytes of the sample it would cover. */
+struct sigpack_candidate {
+	uint64_t symbol;
+	uint64_t gain;
+	size_t len;
+};
+
+static int sigpack_by_symbol( const void *lhs, const void *rhs )
+{
+	const struct sigpack_candidate *a = (const struct sigpack_candidate *)lhs;
+	const struct sigpack_candidate *b = (const struct sigpack_candidate *)rhs;
+
+	if( a->len != b->len ) return a->len < b->len ? -1 : 1;
+	return a->symbol < b->symbol ? -1 : a->symbol > b->symbol;
+}
+
+/* Most bytes covered first, then longer, so training does not depend on qsort() */
+static int sigpack_by_gain( const void *lhs, const void *rhs )
+{
+	const struct sigpack_candidate *a = (const struct sigpack_candidate *)lhs;
+	const struct sigpack_candidate *b = (const struct sigpack_candidate *)rhs;
+
+	if( a->gain != b->gain ) return a->gain > b->gain ? -1 : 1;
+	return sigpack_by_symbol(rhs, lhs);
+}
+
+/** \brief The symbol counted as \p unit in training, and its length in \p *len. */
+static uint64_t sigpack_unit( const struct sigpack *pack, size_t unit, size_t *len )
+{
+	uint64_t symbol = 0;
+	unsigned char byte;
+
+	if( unit < SIGPACK_SYMBOLS )
+	{
+		*len = pack->len[unit];
+		return pack->symbol[unit];
+	}
+
+	byte = (unsigned char)(unit - 256);
+	memcpy(&symbol, &byte, 1);
+	*len = 1;
+	return symbol;
+}
+
+static uint64_t sigpack_concat( uint64_t a, size_t a_len, uint64_t b, size_t b_len )
+{
+	unsigned char bytes[16];
+	uint64_t symbol;
+
+	memcpy(bytes, &a, sizeof(a));
+	memcpy(bytes + a_len, &b, sizeof(b));
+	memcpy(&symbol, bytes, sizeof(symbol));
+	return symbol & sigpack_mask(a_len + b_len);
+}
+
+/** \brief Trains the symbols of \p pack on a sample of the records of \p tab.
+
+    Each round encodes the sample with the symbols so far, counting how often every
+    symbol and escaped byte is used, and every pair of them one after the other.
+    The symbols and escaped bytes, and the pairs that fit in 8 bytes joined, are then
+    ranked by how many bytes of the sample they covered, and the best become the
+    symbols of the next round.
+
+    \returns 0 on success, -1 with errno set otherwise.
+*/
+static int sigpack_train( const struct sigtable *tab, struct sigpack *pack )
+{
+	const size_t ncounts = SIGPACK_UNITS * (SIGPACK_UNITS + 1);
+	struct sigpack_candidate *cand = NULL;
+	struct sigpack_enc *enc;
+	uint32_t *counts, *pairs;
+	size_t stride = tab->size / SIGPACK_SAMPLE + 1, round, rec, a, b, n, m, i;
+
+	counts = (uint32_t *) checked_malloc(ncounts, sizeof(counts[0]));
+	enc = (struct sigpack_enc *) checked_malloc(1, sizeof(*enc));
+	if( counts == NULL || enc == NULL )
+	{
+		free(counts);
+		free(enc);
+		return -1;
+	}
+	pairs = counts + SIGPACK_UNITS;
+	memset(pack, 0, sizeof(*pack));
+
+	for( round = 0; round < SIGPACK_ROUNDS; round++ )
+	{
+		struct sigpack_candidate *grown;
+
+		memset(counts, 0, ncounts * sizeof(counts[0]));
+		sigpack_enc_init(enc, pack);
+
+		for( rec = 0; rec < tab->size; rec += stride )
+		{
+			unsigned char text[SIGVIEW_TEXT];
+			struct sigview view;
+			size_t len, pos, step, prev = SIGPACK_UNITS;
+
+			if( sigtable_get(tab, rec, &view) == NULL ) continue;
+			len = sigpack_text(&view, text);
+			for( pos = 0; pos < len; pos += step )
+			{
+				size_t unit = sigpack_match(enc, text + pos, len - pos, &step);
+
+				if( unit == SIGPACK_ESCAPE ) unit = 256 + text[pos];
+				counts[unit]++;
+				if( prev < SIGPACK_UNITS ) pairs[prev * SIGPACK_UNITS + unit]++;
+				prev = unit;
+			}
+		}
+
+		for( n = 0, i = 0; i < ncounts; i++ ) n += counts[i] != 0;
+		grown = (struct sigpack_candidate *) realloc(cand, (n ? n : 1) * sizeof(cand[0]));
+		if( grown == NULL )
+		{
+			free(cand);
+			free(counts);
+			free(enc);
+			return -1;
+		}
+		cand = grown;
+
+		/* a pair is only counted where both its parts were */
+		for( n = 0, a = 0; a < SIGPACK_UNITS; a++ )
+		{
+			uint64_t a_sym;
+			size_t a_len;
+
+			if( counts[a] == 0 ) continue;
+			a_sym = sigpack_unit(pack, a, &a_len);
+			cand[n].symbol = a_sym;
+			cand[n].len = a_len;
+			cand[n++].gain = (uint64_t)counts[a] * a_len;
+
+			for( b = 0; b < SIGPACK_UNITS; b++ )
+			{
+				uint32_t count = pairs[a * SIGPACK_UNITS + b];
+				uint64_t b_sym;
+				size_t b_len;
+
+				if( count == 0 ) continue;
+				b_sym = sigpack_unit(pack, b, &b_len);
+				if( a_len + b_len > sizeof(uint64_t) ) continue;
+				cand[n].symbol = sigpack_concat(a_sym, a_len, b_sym, b_len);
+				cand[n].len = a_len + b_len;
+				cand[n++].gain = (uint64_t)count * (a_len + b_len);
+			}
+		}
+
+		/* the same symbol may be made in several ways */
+		qsort(cand, n, sizeof(cand[0]), sigpack_by_symbol);
+		for( m = 0, i = 0; i < n; i++ )
+		{
+			if( m > 0 && cand[m - 1].len == cand[i].len && cand[m - 1].symbol == cand[i].symbol ) cand[m - 1].gain += cand[i].gain;
+			else cand[m++] = cand[i];
+		}
+		qsort(cand, m, sizeof(cand[0]), sigpack_by_gain);
+
+		pack->nsymbols = m < SIGPACK_SYMBOLS ? m : SIGPACK_SYMBOLS;
+		for( i = 0; i < pack->nsymbols; i++ )
+		{
+			pack->symbol[i] = cand[i].symbol;
+			pack->len[i] = (uint8_t)cand[i].len;
+		}
+	}
+
+	free(cand);
+	free(counts);
+	free(enc);
+	return 0;
+}
+
+/** \brief Compresses the strings of \p tab with a symbol table trained on its records.
+
+    Every record is encoded on its own, so sigtable_get() decodes only the one asked
+    for, a word copy per symbol. The codes and the symbols live in the region of the
+    table and the mapping of the text goes away. Indexes work as before, whether they
+    were built before or after. Images and tables opened with a budget are not packed.
+
+    \returns 0 on success, -1 with errno set otherwise. errno is ENOTSUP for a table
+             that cannot be packed.
+*/
+int sigtable_pack( struct sigtable *tab )
+{
+	struct sigpack *pack;
+	struct sigpack_enc *enc;
+	unsigned char *codes, *kept;
+	uint64_t *offs;
+	size_t used = 0, cap = tab->arena_len / 2 + 4 * SIGVIEW_TEXT, i;
+
+	if( tab->pack ) return 0;
+
+	if( tab->pager || tab->image )
+	{
+		errno = ENOTSUP;
+		return -1;
+	}
+
+	pack = (struct sigpack *) sigregion_alloc(&tab->region, 1, sizeof(*pack), 64);
+	offs = (uint64_t *) checked_malloc(tab->size ? tab->size : 1, sizeof(offs[0]));
+	codes = (unsigned char *) checked_malloc(cap, 1);
+	enc = (struct sigpack_enc *) checked_malloc(1, sizeof(*enc));
+	if( pack == NULL || offs == NULL || codes == NULL || enc == NULL || sigpack_train(tab, pack) != 0 ) goto fail;
+	sigpack_enc_init(enc, pack);
+
+	for( i = 0; i < tab->size; i++ )
+	{
+		unsigned char text[SIGVIEW_TEXT];
+		struct sigview view;
+		size_t len;
+
+		if( sigtable_get(tab, i, &view) == NULL ) goto fail;
+		if( cap - used < 2 * SIGVIEW_TEXT )
+		{
+			unsigned char *grown = (unsigned char *) realloc(codes, cap * 2);
+
+			if( grown == NULL ) goto fail;
+			codes = grown;
+			cap *= 2;
+		}
+
+		len = sigpack_text(&view, text);
+		offs[i] = used;
+		pack->text_len += len;
+		used += sigpack_encode(enc, text, len, codes + used);
+	}
+
+	kept = (unsigned char *) sigregion_alloc(&tab->region, used ? used : 1, 1, 1);
+	if( kept == NULL ) goto fail;
+	memcpy(kept, codes, used);
+	for( i = 0; i < tab->size; i++ ) tab->hot[i].off = offs[i];
+	free(offs);
+	free(codes);
+	free(enc);
+
+	if( tab->map ) munmap(tab->map, tab->map_len);
+	tab->map = NULL;
+	tab->map_len = 0;
+	tab->arena = (const char *)kept;
+	tab->arena_len = used;
+	tab->pack = pack;
+	return 0;
+
+fail:
+	free(offs);
+	free(codes);
+	free(enc);
+	return -1;
+}
+
+/** \brief Looks up the record at \p idx and resolves its strings in the arena.
+
+    For a table opened with sigtable_open_bounded() the strings live in the page cache
+    and stay valid until the next lookup. Those of a packed table are decoded into
+    \p out.
+
+    \returns \p out or NULL if \p idx is out of range, the record is corrupt or
+             cannot be read.
+*/
+const struct sigview *sigtable_get( const struct sigtable *tab, size_t idx, struct sigview *out )
+{
+	const struct sighot *hot;
+	const char *arena = tab->arena;
+	size_t arena_len = tab->arena_len;
+
+	if( idx >= tab->size )
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if( tab->pager )
+	{
+		struct sigpage *page = sigpager_page(tab->pager, idx / SIGPAGE_RECORDS);
+
+		if( page == NULL ) return NULL;
+		hot = &page->hot[idx % SIGPAGE_RECORDS];
+		arena = page->data;
+		arena_len = page->len;
+	}
+	else
+	{
+		hot = &tab->hot[idx];
+	}
+
+	if( hot->off > arena_len
+		|| hot->name_len >= sizeof(((struct sigrecord *)0)->signame)
+		|| hot->desc_len >= sizeof(((struct sigrecord *)0)->sigdesc) )
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	if( tab->pack )
+	{
+		if( sigpack_decode(tab->pack, (const unsigned char *)arena + hot->off, arena_len - hot->off,
+			out->text, (size_t)hot->name_len + hot->desc_len + 1) != 0 )
+		{
+			errno = EINVAL;
+			return NULL;
+		}
+		arena = out->text;
+	}
+	else if( arena_len - hot->off < (size_t)hot->name_len + hot->desc_len + 1 )
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+	else
+	{
+		arena += hot->off;
+	}
+
+	out->signum = hot->signum;
+	out->name = arena;
+	out->name_len = hot->name_len;
+	out->desc = out->name + hot->name_len + 1;
+	out->desc_len = hot->desc_len;
+	return out;
+}
+
+/* Lookups sigtable_get_batch() prefetches ahead by default, and the most run_batch() groups */
+#define SIGPREFETCH_DISTANCE 8
+#define SIGPREFETCH_MAX 32
+
+/* How many lookups ahead batched lookups prefetch, 0 for none */
+unsigned sigprefetch_distance = SIGPREFETCH_DISTANCE;
+
+/** \brief Where looking up record \p idx reads, in two stages, for __builtin_prefetch().
+
+    Stage 0 is the entry of the record, or its rendered line offset. Stage 1 reads
+    that entry for the strings or the line, so it must come late enough for stage 0
+    to have arrived. A bounded table is read through its pager and is not prefetched.
+
+    The address is returned rather than prefetched here: GCC takes a function that
+    only prefetches to have no effect and drops the calls to it.
+
+    \returns The address, or NULL, which prefetches nothing.
+*/
+static const void *sigtable_prefetch_addr( const struct sigtable *tab, size_t idx, int stage )
+{
+	if( idx >= tab->size || tab->pager ) return NULL;
+
+	if( stage == 0 )
+	{
+		return tab->render.off ? (const void *)(tab->render.off + idx) : (const void *)(tab->hot + idx);
+	}
+	if( tab->render.off ) return tab->render.lines + tab->render.off[idx];
+	return tab->hot[idx].off < tab->arena_len ? tab->arena + tab->hot[idx].off : NULL;
+}
+
+/** \brief Looks up the records at \p idx[0] to \p idx[n - 1] and calls \p found for each in order.
+
+    \p found gets the position \p k in \p idx and the record as sigtable_get() returns
+    it, NULL if that failed. While one record is handed out, the entries of the
+    records sigprefetch_distance * 2 lookups ahead and the strings of those
+    sigprefetch_distance ahead are prefetched, so that a table far larger than the
+    caches costs about one memory latency per sigprefetch_distance lookups rather
+    than two per lookup.
+
+    \returns \p n, or -1 if \p found returned non-zero.
+*/
+ssize_t sigtable_get_batch( const struct sigtable *tab, const size_t *idx, size_t n,
+	int (*found)( void *arg, size_t k, const struct sigview *rec ), void *arg )
+{
+	size_t ahead = sigprefetch_distance, k;
+	struct sigview view;
+
+	for( k = 0; ahead && k < n && k < 2 * ahead; k++ ) __builtin_prefetch(sigtable_prefetch_addr(tab, idx[k], 0));
+	for( k = 0; ahead && k < n && k < ahead; k++ ) __builtin_prefetch(sigtable_prefetch_addr(tab, idx[k], 1));
+
+	for( k = 0; k < n; k++ )
+	{
+		if( ahead && k + 2 * ahead < n ) __builtin_prefetch(sigtable_prefetch_addr(tab, idx[k + 2 * ahead], 0));
+		if( ahead && k + ahead < n ) __builtin_prefetch(sigtable_prefetch_addr(tab, idx[k + ahead], 1));
+		if( found(arg, k, sigtable_get(tab, idx[k], &view)) != 0 ) return -1;
+	}
+	return (ssize_t)n;
+}
+
+/** \brief Prints how much of \p region is used and how it is backed. */
+static void sigregion_report( const struct sigregion *region, FILE *out )
+{
+	const struct sigregion_block *block;
+	size_t blocks = 0, hugetlb = 0;
+
+	for( block = region->blocks; block; block = block->next )
+	{
+		blocks++;
+		if( block->hugetlb ) hugetlb += block->len;
+	}
+
+	fprintf(out, "region:         %zu bytes used of %zu mapped in %zu blocks (", region->used, region->mapped, blocks);
+	if( hugetlb != 0 ) fprintf(out, "%zu bytes hugetlb)\n", hugetlb);
+	else fprintf(out, "%s)\n", region->flags & (SIGREGION_THP | SIGREGION_HUGETLB) ? "transparent huge pages" : "base pages");
+}
+
+/** \brief Prints the memory used by \p tab next to what struct sigrecord would need. */
+void sigtable_mem_report( const struct sigtable *tab, FILE *out )
+{
+	size_t fixed = tab->size * sizeof(struct sigrecord);
+	size_t hot = tab->size * sizeof(struct sighot);
+	size_t strings = 0, i;
+
+	if( tab->pager )
+	{
+		fprintf(out, "records:        %zu\n", tab->size);
+		fprintf(out, "fixed layout:   %zu bytes (%zu per record)\n", fixed, sizeof(struct sigrecord));
+		sigpager_report(tab->pager, out);
+		return;
+	}
+
+	for( i = 0; i < tab->size; i++ )
+	{
+		strings += (size_t)tab->hot[i].name_len + tab->hot[i].desc_len + 2;
+	}
+
+	fprintf(out, "records:        %zu\n", tab->size);
+	fprintf(out, "fixed layout:   %zu bytes (%zu per record)\n", fixed, sizeof(struct sigrecord));
+	fprintf(out, "compact layout: %zu bytes (%zu hot + %zu packed strings)\n", hot + strings, hot, strings);
+	if( tab->pack )
+	{
+		fprintf(out, "string arena:   %zu bytes (packed from %zu, %zu symbols)\n", tab->arena_len,
+			tab->pack->text_len, tab->pack->nsymbols);
+	}
+	else
+	{
+		fprintf(out, "string arena:   %zu bytes (%s)\n", tab->arena_len, tab->image ? "image heap" : "mapped text");
+	}
+	if( tab->names.nslots != 0 )
+	{
+		fprintf(out, "name index:     %zu bytes (%zu names)\n", tab->names.mem_len, tab->names.nslots);
+	}
+	if( tab->text.slots != NULL )
+	{
+		const struct sigtext_index *text = &tab->text;
+
+		fprintf(out, "text index:     %zu bytes (%zu terms, %zu postings)\n",
+			text->nslots * sizeof(text->slots[0]) + text->nterms * sizeof(text->terms[0])
+			+ text->npostings * sizeof(text->postings[0]), text->nterms, text->npostings);
+	}
+	if( tab->nums.mem != NULL )
+	{
+		fprintf(out, "signum index:   %zu bytes (Eytzinger)\n", tab->nums.mem_len);
+	}
+	if( tab->render.off != NULL )
+	{
+		fprintf(out, "rendered lines: %zu bytes (%zu of text)\n",
+			(tab->size + 1) * sizeof(tab->render.off[0]) + (size_t)tab->render.off[tab->size],
+			(size_t)tab->render.off[tab->size]);
+	}
+	sigregion_report(&tab->region, out);
+}
+
+/** \brief Output stream positioned with pwrite(), keeping a running checksum. */
+struct pwbuf {
+	int fd;
+	uint64_t pos;
+	uint64_t sum;
+	size_t used;
+	char data[1 << 16];
+};
+
+static int pwbuf_flush( struct pwbuf *buf )
+{
+	size_t done = 0;
+
+	while( done < buf->used )
+	{
+		ssize_t n = pwrite(buf->fd, buf->data + done, buf->used - done, (off_t)(buf->pos + done));
+		if( n < 0 )
+		{
+			if( errno == EINTR ) continue;
+			return -1;
+		}
+		done += (size_t)n;
+	}
+
+	buf->pos += buf->used;
+	buf->used = 0;
+	return 0;
+}
+
+static int pwbuf_put( struct pwbuf *buf, const void *data, size_t len )
+{
+	buf->sum = fnv1a(buf->sum, data, len);
+
+	if( len > sizeof(buf->data) - buf->used && pwbuf_flush(buf) != 0 ) return -1;
+	memcpy(buf->data + buf->used, data, len);
+	buf->used += len;
+	return 0;
+}
+
+/** \brief Compiles the text database read from \p in into an image written to \p fd.
+
+    Records are validated by read_size() and checked_fgets() exactly as read_records()
+    does, and streamed out one at a time: the entry table right after the header and
+    the string heap after the table. The name index, built as a minimal perfect hash,
+    follows the heap. The header goes last, so an interrupted compile never leaves a
+    valid image behind.
+
+    \returns 0 on success, -1 with errno set otherwise.
+*/
+int sigimage_compile( FILE *in, int fd )
+{
+	struct sigimage_header hdr;
+	struct sigrecord rec;
+	struct pwbuf *table, *heap;
+	struct name_pair *pairs = NULL;
+	struct signame_index names;
+	struct sigregion region;
+	size_t size, i, pairs_cap = 0;
+	int ret = -1, err;
+
+	if( !read_size(in, &size) || size == 0 || size > INT32_MAX )
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	table = (struct pwbuf *) checked_malloc(2, sizeof(*table));
+	if( table == NULL ) return -1;
+	heap = table + 1;
+	memset(&names, 0, sizeof(names));
+	sigregion_init(&region, 0);
+
+	memset(&hdr, 0, sizeof(hdr));
+	memcpy(hdr.magic, SIGIMAGE_MAGIC, sizeof(hdr.magic));
+	hdr.version = SIGIMAGE_VERSION;
+	hdr.byte_order = SIGIMAGE_BYTE_ORDER;
+	hdr.count = size;
+	hdr.table_off = sizeof(hdr);
+	hdr.heap_off = hdr.table_off + size * sizeof(struct sighot);
+
+	table->fd = heap->fd = fd;
+	table->pos = hdr.table_off;
+	heap->pos = hdr.heap_off;
+	table->sum = heap->sum = FNV1A_INIT;
+	table->used = heap->used = 0;
+
+	for( i = 0; i < size; i++ )
+	{
+		struct sighot ent;
+
+		if( NULL == checked_fgets(&rec, in) ) goto done;
+
+		if( i == pairs_cap )
+		{
+			struct name_pair *grown;
+
+			pairs_cap = pairs_cap ? pairs_cap * 2 : 1024;
+			if( pairs_cap > size ) pairs_cap = size;
+			grown = (struct name_pair *) realloc(pairs, pairs_cap * sizeof(pairs[0]));
+			if( grown == NULL ) goto done;
+			pairs = grown;
+		}
+		pairs[i].key = name_key(rec.signame, strlen(rec.signame));
+		pairs[i].rec = (uint32_t)i;
+
+		memset(&ent, 0, sizeof(ent));
+		ent.off = hdr.heap_len;
+		ent.signum = rec.signum;
+		ent.name_len = (uint8_t)strlen(rec.signame);
+		ent.desc_len = (uint8_t)strlen(rec.sigdesc);
+
+		if( pwbuf_put(table, &ent, sizeof(ent)) != 0
+			|| pwbuf_put(heap, rec.signame, (size_t)ent.name_len + 1) != 0
+			|| pwbuf_put(heap, rec.sigdesc, (size_t)ent.desc_len + 1) != 0 )
+		{
+			goto done;
+		}
+		hdr.heap_len += (uint64_t)ent.name_len + ent.desc_len + 2;
+	}
+
+	if( pwbuf_flush(table) != 0 || pwbuf_flush(heap) != 0 ) goto done;
+	hdr.table_sum = table->sum;
+	hdr.heap_sum = heap->sum;
+
+	/* the name index follows the heap as a minimal perfect hash */
+	if( build_name_index(pairs, size, true, &region, &names) != 0 ) goto done;
+
+	hdr.index_off = align8(hdr.heap_off + hdr.heap_len);
+	hdr.index_len = names.mem_len;
+	hdr.name_slots = names.nslots;
+	hdr.name_disp = names.ndisp;
+
+	table->pos = hdr.index_off;
+	table->sum = FNV1A_INIT;
+	for( i = 0; i < names.mem_len; i += sizeof(table->data) )
+	{
+		size_t chunk = names.mem_len - i < sizeof(table->data) ? names.mem_len - i : sizeof(table->data);
+		if( pwbuf_put(table, (const char *)names.mem + i, chunk) != 0 ) goto done;
+	}
+	if( pwbuf_flush(table) != 0 ) goto done;
+
+	hdr.index_sum = table->sum;
+	hdr.header_sum = sigimage_header_sum(&hdr);
+
+	table->pos = 0;
+	memcpy(table->data, &hdr, sizeof(hdr));
+	table->used = sizeof(hdr);
+	ret = pwbuf_flush(table);
+
+done:
+	err = errno;
+	sigregion_free(&region);
+	free(pairs);
+	free(table);
+	errno = err;
+	return ret;
+}
+
+/** \brief Checks the table, heap and name index checksums of a compiled image.
+
+    This reads the whole image, so it is kept out of sigtable_open().
+
+    \returns 0 if the image is intact, -1 with errno set to EINVAL otherwise.
+*/
+int sigimage_verify( const struct sigtable *tab )
+{
+	struct sigimage_header hdr;
+
+	if( !tab->image || tab->map == NULL )
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	memcpy(&hdr, tab->map, sizeof(hdr));
+	if( hdr.table_sum != fnv1a(FNV1A_INIT, tab->hot, tab->size * sizeof(tab->hot[0]))
+		|| hdr.heap_sum != fnv1a(FNV1A_INIT, tab->arena, tab->arena_len)
+		|| hdr.index_sum != fnv1a(FNV1A_INIT, tab->names.keys, tab->names.mem_len) )
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	return 0;
+}
+
+/* The parts of a header written by sigembed_write() that do not depend on the records */
+static const char sigembed_types[] =
+	"/** \\brief A record of sigembed_hot by its name_key(). */\n"
+	"struct sigembed_name {\n"
+	"\tuint64_t key;\n"
+	"\tuint32_t rec;\n"
+	"};\n"
+	"\n"
+	"/** \\brief A run of sigembed_names, empty if \\p begin == \\p end. */\n"
+	"struct sigembed_range {\n"
+	"\tsize_t begin;\n"
+	"\tsize_t end;\n"
+	"};\n";
+
+static const char sigembed_code[] =
+	"/** \\brief name_key() for use in constant expressions. */\n"
+	"constexpr uint64_t sigembed_key( std::string_view name )\n"
+	"{\n"
+	"\tuint64_t key = 0;\n"
+	"\n"
+	"\tfor( size_t i = 0; i < SIGNAME_MAX; i++ )\n"
+	"\t{\n"
+	"\t\tunsigned char c = i < name.size() ? (unsigned char)name[i] : 0;\n"
+	"\t\tkey = key << 8 | (c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c);\n"
+	"\t}\n"
+	"\treturn key << 8 | name.size();\n"
+	"}\n"
+	"\n"
+	"/** \\brief Looks up the records named \\p name ignoring case, like sigtable_find_name(). */\n"
+	"constexpr struct sigembed_range sigembed_find( std::string_view name )\n"
+	"{\n"
+	"\tsize_t lo = 0, hi = sizeof(sigembed_names) / sizeof(sigembed_names[0]), end = 0;\n"
+	"\tuint64_t key = sigembed_key(name);\n"
+	"\n"
+	"\tif( name.empty() || name.size() > SIGNAME_MAX ) return { 0, 0 };\n"
+	"\tfor( size_t i = 0; i < name.size(); i++ )\n"
+	"\t{\n"
+	"\t\tif( name[i] == ' ' || name[i] == '\\0' || (name[i] >= '\\t' && name[i] <= '\\r') ) return { 0, 0 };\n"
+	"\t}\n"
+	"\n"
+	"\twhile( lo < hi )\n"
+	"\t{\n"
+	"\t\tsize_t mid = lo + (hi - lo) / 2;\n"
+	"\t\tif( sigembed_names[mid].key < key ) lo = mid + 1;\n"
+	"\t\telse hi = mid;\n"
+	"\t}\n"
+	"\tfor( end = lo; end < sizeof(sigembed_names) / sizeof(sigembed_names[0]) && sigembed_names[end].key == key; end++ );\n"
+	"\treturn { lo, end };\n"
+	"}\n"
+	"\n"
+	"/** \\brief Record \\p idx as sigtable_get() returns it, \\p idx must be in range. */\n"
+	"constexpr struct sigview sigembed_get( size_t idx )\n"
+	"{\n"
+	"\tconst struct sighot &hot = sigembed_hot[idx];\n"
+	"\n"
+	"\treturn { sigembed_arena + hot.off, sigembed_arena + hot.off + hot.name_len + 1,\n"
+	"\t\thot.signum, hot.name_len, hot.desc_len, {} };\n"
+	"}\n";
+
+/* Writes \p len bytes of \p str as the contents of a C string literal */
+static void sigembed_quote( FILE *out, const char *str, size_t len )
+{
+	size_t i;
+
+	for( i = 0; i < len; i++ )
+	{
+		unsigned char c = (unsigned char)str[i];
+
+		if( c == '"' || c == '\\' ) fprintf(out, "\\%c", c);
+		else if( c < ' ' || c >= 0x7f || c == '?' ) fprintf(out, "\\%03o", c);
+		else fputc(c, out);
+	}
+}
+
+/** \brief Writes the records of \p tab as a C++ header that compiles them into a program.
+
+    The header holds constexpr arrays of the records and their strings in the layout
+    of a struct sigtable, a name table sorted by name_key(), and constexpr lookups over
+    them that the compiler can evaluate for constant arguments. It is meant to be
+    included after better-intexer.c and needs C++17. \p source, the database the
+    records came from, is recorded in the header as sigembed_source.
+
+    \returns 0 on success, -1 with errno set on error. errno is EINVAL if a record of
+             \p tab is corrupt.
+*/
+int sigembed_write( const struct sigtable *tab, const char *source, FILE *out )
+{
+	struct name_pair *pairs;
+	struct sigview view;
+	uint64_t off = 0;
+	size_t i;
+
+	if( tab->size == 0 || tab->size > INT32_MAX )
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	pairs = (struct name_pair *) checked_malloc(tab->size, sizeof(pairs[0]));
+	if( pairs == NULL ) return -1;
+
+	fprintf(out, "/* Generated by intexer-compile --header from ");
+	sigembed_quote(out, source, strlen(source));
+	fprintf(out, ", do not edit.\n\n"
+		"   Include after better-intexer.c, compile as C++17. */\n\n"
+		"#ifndef INTEXER_DATA_H\n#define INTEXER_DATA_H\n\n#include <string_view>\n\n");
+
+	fprintf(out, "static constexpr char sigembed_source[] = \"");
+	sigembed_quote(out, source, strlen(source));
+	fprintf(out, "\";\n\n/* Name, a space and the description of every record, one per line */\n"
+		"static constexpr char sigembed_arena[] =");
+	for( i = 0; i < tab->size; i++ )
+	{
+		if( sigtable_get(tab, i, &view) == NULL ) goto invalid;
+		fprintf(out, "\n\t\"");
+		sigembed_quote(out, view.name, view.name_len);
+		fputc(' ', out);
+		sigembed_quote(out, view.desc, view.desc_len);
+		fprintf(out, "\\n\"");
+	}
+
+	fprintf(out, ";\n\n/* off, signum, name_len, desc_len */\n"
+		"static constexpr struct sighot sigembed_hot[] = {\n");
+	for( i = 0; i < tab->size; i++ )
+	{
+		sigtable_get(tab, i, &view);
+		fprintf(out, "\t{ %llu, %u, %u, %u, 0 },\n", (unsigned long long)off,
+			view.signum, view.name_len, view.desc_len);
+		off += (uint64_t)view.name_len + view.desc_len + 2;
+		pairs[i].key = name_key(view.name, view.name_len);
+		pairs[i].rec = (uint32_t)i;
+	}
+
+	/* records sharing a name stay in database order */
+	qsort(pairs, tab->size, sizeof(pairs[0]), name_pair_cmp);
+	fprintf(out, "};\n\nstatic constexpr size_t sigembed_size = %zu;\n\n%s\n", tab->size, sigembed_types);
+	fprintf(out, "/* Every record by name_key(), records sharing a name in database order */\n"
+		"static constexpr struct sigembed_name sigembed_names[] = {\n");
+	for( i = 0; i < tab->size; i++ )
+	{
+		fprintf(out, "\t{ UINT64_C(0x%016llx), %u },\n", (unsigned long long)pairs[i].key, pairs[i].rec);
+	}
+	fprintf(out, "};\n\n%s\n#endif /* INTEXER_DATA_H */\n", sigembed_code);
+
+	free(pairs);
+	return ferror(out) ? -1 : 0;
+
+invalid:
+	free(pairs);
+	errno = EINVAL;
+	return -1;
+}
+
+/** \brief The files a table was loaded from, to tell later whether it is still current.
+
+    \p dev and \p ino are those of the database file, zero if the table was not loaded
+    from one file, and \p journal_len is the number of journal bytes that were replayed.
+*/
+struct sigsource {
+	dev_t dev;
+	ino_t ino;
+	size_t journal_len;
+};
+
+static struct sigtable *sigtable_map( const char *path_arg, bool copy, size_t budget, struct sigsource *source );
+static int sigtable_finish( struct sigtable *tab, const char *journal, size_t *journal_len );
+
+/** \brief Maps the database file specified by path_arg and indexes its records.
+
+    The path is resolved like datafile_open(). Record views point straight into the
+    read-only mapping, so nothing is copied during the load. Compiled images made by
+    sigimage_compile() are recognised by their magic and used without parsing.
+
+    A database may also be split into shards, named by a pattern with wildcards that
+    is looked up in every DATA_PATH directory or by a manifest, a file starting with
+    the line SIGSHARDS_MAGIC followed by one path or pattern per line. The shards,
+    which must be text databases, are loaded in parallel into one table. Where shards
+    have records of the same signal number, only those of the first shard are kept,
+    shards of earlier DATA_PATH directories or manifest lines coming first and the
+    files one pattern matches in name order.
+
+    \returns A table the user must release with sigtable_close() upon successful completion.
+             Otherwise, NULL is returned and errno is set to indicate the error.
+*/
+struct sigtable *sigtable_open( const char *path_arg )
+{
+	return sigtable_map(path_arg, false, 0, NULL);
+}
+
+/** \brief Like sigtable_open(), but reads the file into private memory.
+
+    A file mapping shows later writes to the file and faults once the file is
+    truncated, so tables that must survive the file being rewritten in place, such as
+    the ones a server reloads, are loaded with this instead.
+*/
+struct sigtable *sigtable_load( const char *path_arg )
+{
+	return sigtable_map(path_arg, true, 0, NULL);
+}
+
+/** \brief Makes a table of \p size records \p hot with their strings in \p arena.
+
+    Nothing is copied, the arrays belong to the caller and must outlive the table,
+    which is released with sigtable_close() like any other. This is how a database
+    compiled into the program is served.
+
+    \returns The table, or NULL with errno set on error.
+*/
+struct sigtable *sigtable_attach( const struct sighot *hot, size_t size, const char *arena, size_t arena_len )
+{
+	struct sigtable *tab = (struct sigtable *) checked_malloc(1, sizeof(*tab));
+
+	if( tab == NULL ) return NULL;
+	memset(tab, 0, sizeof(*tab));
+	sigregion_init(&tab->region, sigregion_flags);
+	tab->hot = (struct sighot *)hot;
+	tab->size = size;
+	tab->arena = arena;
+	tab->arena_len = arena_len;
+	/* like an image, the records are not ours to free */
+	tab->image = true;
+	return tab;
+}
+
+/** \brief Makes a table of the database held in \p buf, a text database or an image.
+
+    The \p len bytes are copied into private memory first, so \p buf can be released
+    once this returns. Tables are packed and rendered as configured for the others.
+
+    \returns A table the user must release with sigtable_close(), or NULL with errno set on error.
+*/
+struct sigtable *sigtable_parse( const char *buf, size_t len )
+{
+	struct sigtable *tab;
+	int err;
+
+	if( len == 0 )
+	{
+		errno = EINVAL;
+		return NULL;
+	}
+
+	tab = (struct sigtable *) checked_malloc(1, sizeof(*tab));
+	if( tab == NULL ) return NULL;
+	memset(tab, 0, sizeof(*tab));
+	sigregion_init(&tab->region, sigregion_flags);
+
+	/* page aligned, as an image expects */
+	tab->map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if( tab->map == MAP_FAILED )
+	{
+		free(tab);
+		return NULL;
+	}
+	memcpy(tab->map, buf, len);
+	tab->map_len = len;
+	tab->arena = (const char *)tab->map;
+	tab->arena_len = len;
+
+	if( len >= sizeof(SIGIMAGE_MAGIC) - 1 && 0 == memcmp(buf, SIGIMAGE_MAGIC, sizeof(SIGIMAGE_MAGIC) - 1) )
+	{
+		if( sigimage_attach(tab) != 0 ) goto fail;
+	}
+	else
+	{
+		tab->hot = map_records_parallel_in((const char *)tab->map, len, &tab->size, 0, &tab->region);
+		if( tab->hot == NULL ) goto fail;
+	}
+	if( sigtable_finish(tab, NULL, NULL) != 0 ) goto fail;
+
+	sigstats_add(&sigstats.records_parsed, tab->size);
+	return tab;
+
+fail:
+	err = errno;
+	sigtable_close(tab);
+	errno = err;
+	return NULL;
+}
+
+/** \brief Like sigtable_open(), but keeps only a page index of a text database in memory.
+
+    The file is parsed in one pass that notes where each page of SIGPAGE_RECORDS
+    records starts. Records are then read on demand into a cache of at most \p budget
+    bytes, which always holds at least the page last used. Name and text indexes
+    cannot be built for such a table. Images are already paged in on demand by the
+    kernel, they are opened as by sigtable_open(). A database of several shards cannot
+    be opened this way, errno is ENOTSUP.
+*/
+struct sigtable *sigtable_open_bounded( const char *path_arg, size_t budget )
+{
+	return sigtable_map(path_arg, false, budget ? budget : 1, NULL);
+}
+
+/* Bytes per read of sigio_read(), the reads it keeps in flight and the threads of its pread() fallback */
+#define SIGIO_CHUNK (1 << 20)
+#define SIGIO_DEPTH 32
+#define SIGIO_THREADS 8
+
+enum sigio_backend sigio_backend = SIGIO_AUTO;
+
+/** \brief A file sigio_read() reads whole into \p buf, \p err is set if it could not. */
+struct sigio_file {
+	int fd;
+	char *buf;
+	size_t len;
+	size_t left;
+	int err;
+};
+
+/** \brief Called by sigio_read() for every file as soon as it is read or has failed. */
+typedef void (*sigio_done_fn)( void *arg, struct sigio_file *file );
+
+/** \brief The reads of one sigio_read(), handed out a chunk at a time in file order. */
+struct sigio_batch {
+	struct sigio_file *files;
+	size_t n;
+	size_t file;
+	size_t off;
+	sigio_done_fn done;
+	void *arg;
+	pthread_mutex_t lock;
+};
+
+/** \brief Takes the next chunk to read, false once all are taken. */
+static bool sigio_next( struct sigio_batch *batch, size_t *file, size_t *off, size_t *len )
+{
+	while( batch->file < batch->n && batch->off >= batch->files[batch->file].len )
+	{
+		batch->file++;
+		batch->off = 0;
+	}
+	if( batch->file == batch->n ) return false;
+
+	*file = batch->file;
+	*off = batch->off;
+	*len = batch->files[*file].len - *off < SIGIO_CHUNK ? batch->files[*file].len - *off : SIGIO_CHUNK;
+	batch->off += *len;
+	return true;
+}
+
+/** \brief Counts \p len bytes of \p file as read, or failed with \p err, and reports the file when all are. */
+static void sigio_finish( struct sigio_batch *batch, struct sigio_file *file, size_t len, int err )
+{
+	if( err != 0 ) __atomic_store_n(&file->err, err, __ATOMIC_RELAXED);
+	if( __atomic_sub_fetch(&file->left, len, __ATOMIC_ACQ_REL) == 0 && batch->done ) batch->done(batch->arg, file);
+}
+
+/** \brief Reads exactly \p len bytes at \p off of \p fd. */
+static int pread_full( int fd, char *buf, size_t len, size_t off )
+{
+	size_t done = 0;
+
+	while( done < len )
+	{
+		ssize_t n = pread(fd, buf + done, len - done, (off_t)(off + done));
+		if( n < 0 && errno == EINTR ) continue;
+		if( n <= 0 )
+		{
+			/* the file shrank under us */
+			if( n == 0 ) errno = EINVAL;
+			return -1;
+		}
+		done += (size_t)n;
+	}
+	return 0;
+}
+
+static void sigio_pread_chunk( struct sigio_batch *batch, size_t file, size_t off, size_t len )
+{
+	struct sigio_file *f = &batch->files[file];
+
+	sigio_finish(batch, f, len, pread_full(f->fd, f->buf + off, len, off) != 0 ? errno : 0);
+}
+
+static void *sigio_pread_run( void *arg )
+{
+	struct sigio_batch *batch = (struct sigio_batch *)arg;
+	size_t file, off, len;
+	bool more;
+
+	do
+	{
+		pthread_mutex_lock(&batch->lock);
+		more = sigio_next(batch, &file, &off, &len);
+		pthread_mutex_unlock(&batch->lock);
+		if( more ) sigio_pread_chunk(batch, file, off, len);
+	} while( more );
+	return NULL;
+}
+
+/** \brief Reads the chunks left in \p batch with the calling thread and up to SIGIO_THREADS - 1 more. */
+static void sigio_pread( struct sigio_batch *batch )
+{
+	pthread_t threads[SIGIO_THREADS - 1];
+	unsigned started = 0, i;
+
+	while( started < SIGIO_THREADS - 1 && pthread_create(&threads[started], NULL, sigio_pread_run, batch) == 0 ) started++;
+	sigio_pread_run(batch);
+	for( i = 0; i < started; i++ ) pthread_join(threads[i], NULL);
+}
+
+/** \brief An io_uring set up with raw system calls, with its rings mapped. */
+struct sigio_ring {
+	int fd;
+	void *sq_map;
+	size_t sq_map_len;
+	void *cq_map;
+	size_t cq_map_len;
+	struct io_uring_sqe *sqes;
+	size_t sqes_len;
+	unsigned *sq_tail;
+	unsigned *sq_mask;
+	unsigned *sq_array;
+	unsigned *cq_head;
+	unsigned *cq_tail;
+	unsigned *cq_mask;
+	struct io_uring_cqe *cqes;
+};
+
+static void sigio_ring_free( struct sigio_ring *ring )
+{
+	if( ring->sqes ) munmap(ring->sqes, ring->sqes_len);
+	if( ring->cq_map && ring->cq_map != ring->sq_map ) munmap(ring->cq_map, ring->cq_map_len);
+	if( ring->sq_map ) munmap(ring->sq_map, ring->sq_map_len);
+	close(ring->fd);
+}
+
+static void *sigio_ring_map( int fd, size_t len, off_t off )
+{
+	void *map = mmap(NULL, len, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, fd, off);
+
+	return map == MAP_FAILED ? NULL : map;
+}
+
+/** \brief Sets up a ring of \p entries, -1 with errno set if io_uring is not available. */
+static int sigio_ring_init( struct sigio_ring *ring, unsigned entries )
+{
+	struct io_uring_params p;
+	char *sq, *cq;
+
+	memset(ring, 0, sizeof(*ring));
+	memset(&p, 0, sizeof(p));
+	ring->fd = (int)syscall(__NR_io_uring_setup, entries, &p);
+	if( ring->fd < 0 ) return -1;
+
+	ring->sq_map_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+	ring->cq_map_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+	if( p.features & IORING_FEAT_SINGLE_MMAP )
+	{
+		if( ring->cq_map_len > ring->sq_map_len ) ring->sq_map_len = ring->cq_map_len;
+		ring->cq_map_len = ring->sq_map_len;
+	}
+	ring->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+
+	ring->sq_map = sigio_ring_map(ring->fd, ring->sq_map_len, IORING_OFF_SQ_RING);
+	if( ring->sq_map == NULL ) goto fail;
+	ring->cq_map = (p.features & IORING_FEAT_SINGLE_MMAP) ? ring->sq_map
+		: sigio_ring_map(ring->fd, ring->cq_map_len, IORING_OFF_CQ_RING);
+	if( ring->cq_map == NULL ) goto fail;
+	ring->sqes = (struct io_uring_sqe *) sigio_ring_map(ring->fd, ring->sqes_len, IORING_OFF_SQES);
+	if( ring->sqes == NULL ) goto fail;
+
+	sq = (char *)ring->sq_map;
+	cq = (char *)ring->cq_map;
+	ring->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+	ring->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+	ring->sq_array = (unsigned *)(sq + p.sq_off.array);
+	ring->cq_head = (unsigned *)(cq + p.cq_off.head);
+	ring->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+	ring->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+	ring->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+	return 0;
+
+fail:
+	sigio_ring_free(ring);
+	return -1;
+}
+
+/** \brief A read of a chunk in flight, the slot number is its user_data. */
+struct sigio_request {
+	size_t file;
+	size_t off;
+	size_t len;
+};
+
+/** \brief Reads \p batch with io_uring, SIGIO_DEPTH chunks in flight.
+
+    A short read is queued again for the rest. A chunk the ring cannot read, such as
+    on kernels without IORING_OP_READ, is read with pread() instead. Should the ring
+    itself fail, the reads in flight and all after them are done with pread().
+
+    \returns 0 once every file is done, -1 with errno set if no ring could be set up.
+*/
+static int sigio_uring( struct sigio_batch *batch )
+{
+	struct sigio_ring ring;
+	struct sigio_request req[SIGIO_DEPTH];
+	unsigned free_slots[SIGIO_DEPTH], retry[SIGIO_DEPTH], nfree = SIGIO_DEPTH, nretry = 0;
+	unsigned to_submit = 0, in_flight = 0, i;
+
+	if( sigio_ring_init(&ring, SIGIO_DEPTH) != 0 ) return -1;
+	for( i = 0; i < SIGIO_DEPTH; i++ ) free_slots[i] = SIGIO_DEPTH - 1 - i;
+
+	for( ;; )
+	{
+		unsigned tail = *ring.sq_tail, head;
+		int ret;
+
+		for( ;; )
+		{
+			struct io_uring_sqe *sqe;
+			struct sigio_request *r;
+			unsigned slot;
+
+			if( nretry > 0 ) slot = retry[--nretry];
+			else if( nfree > 0 && sigio_next(batch, &req[free_slots[nfree - 1]].file,
+				&req[free_slots[nfree - 1]].off, &req[free_slots[nfree - 1]].len) ) slot = free_slots[--nfree];
+			else break;
+
+			r = &req[slot];
+			sqe = &ring.sqes[tail & *ring.sq_mask];
+			memset(sqe, 0, sizeof(*sqe));
+			sqe->opcode = IORING_OP_READ;
+			sqe->fd = batch->files[r->file].fd;
+			sqe->addr = (uint64_t)(uintptr_t)(batch->files[r->file].buf + r->off);
+			sqe->len = (unsigned)r->len;
+			sqe->off = r->off;
+			sqe->user_data = slot;
+			ring.sq_array[tail & *ring.sq_mask] = tail & *ring.sq_mask;
+			tail++;
+			to_submit++;
+			in_flight++;
+		}
+		__atomic_store_n(ring.sq_tail, tail, __ATOMIC_RELEASE);
+		if( in_flight == 0 ) break;
+
+		ret = (int)syscall(__NR_io_uring_enter, ring.fd, to_submit, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+		if( ret < 0 )
+		{
+			if( errno == EINTR || errno == EAGAIN || errno == EBUSY ) continue;
+
+			/* what is in flight may still land, with the same bytes pread() reads */
+			for( i = 0; i < SIGIO_DEPTH; i++ )
+			{
+				bool busy = true;
+				unsigned k;
+
+				for( k = 0; k < nfree; k++ ) busy &= free_slots[k] != i;
+				if( busy ) sigio_pread_chunk(batch, req[i].file, req[i].off, req[i].len);
+			}
+			sigio_ring_free(&ring);
+			sigio_pread(batch);
+			return 0;
+		}
+		to_submit -= (unsigned)ret;
+
+		head = *ring.cq_head;
+		for( ; head != __atomic_load_n(ring.cq_tail, __ATOMIC_ACQUIRE); head++ )
+		{
+			struct io_uring_cqe *cqe = &ring.cqes[head & *ring.cq_mask];
+			unsigned slot = (unsigned)cqe->user_data;
+			struct sigio_request *r = &req[slot];
+			int res = cqe->res;
+
+			in_flight--;
+			if( res == -EINTR || res == -EAGAIN )
+			{
+				retry[nretry++] = slot;
+				continue;
+			}
+
+			if( res < 0 ) sigio_pread_chunk(batch, r->file, r->off, r->len);
+			else if( res == 0 ) sigio_finish(batch, &batch->files[r->file], r->len, EINVAL);
+			else if( (size_t)res < r->len )
+			{
+				sigio_finish(batch, &batch->files[r->file], (size_t)res, 0);
+				r->off += (size_t)res;
+				r->len -= (size_t)res;
+				retry[nretry++] = slot;
+				continue;
+			}
+			else sigio_finish(batch, &batch->files[r->file], r->len, 0);
+			free_slots[nfree++] = slot;
+		}
+		__atomic_store_n(ring.cq_head, head, __ATOMIC_RELEASE);
+	}
+
+	sigio_ring_free(&ring);
+	return 0;
+}
+
+/** \brief Reads the \p n \p files whole into their buffers, many reads in flight across files.
+
+    With io_uring, unless sigio_backend says otherwise, or else a pool of pread()
+    threads. \p done, if not NULL, is called for each file as soon as it is read,
+    from whichever thread read its last chunk, so callers can go on with finished
+    files while others are still read. The error of a file is left in its \p err.
+
+    \returns 0 when all files are done, -1 with errno set if sigio_backend asks for
+             io_uring and it is not available.
+*/
+static int sigio_read( struct sigio_file *files, size_t n, sigio_done_fn done, void *arg )
+{
+	struct sigio_batch batch;
+	size_t i;
+	int ret = 0;
+
+	memset(&batch, 0, sizeof(batch));
+	batch.files = files;
+	batch.n = n;
+	batch.done = done;
+	batch.arg = arg;
+	pthread_mutex_init(&batch.lock, NULL);
+
+	for( i = 0; i < n; i++ )
+	{
+		files[i].left = files[i].len;
+		files[i].err = 0;
+		if( files[i].len == 0 && done ) done(arg, &files[i]);
+	}
+
+	/* one read is not worth a ring or threads */
+	if( n == 1 && files[0].len <= SIGIO_CHUNK && sigio_backend != SIGIO_URING )
+	{
+		sigio_pread_run(&batch);
+	}
+	else if( sigio_backend == SIGIO_PREAD || (ret = sigio_uring(&batch)) != 0 )
+	{
+		if( sigio_backend == SIGIO_URING ) ret = -1;
+		else
+		{
+			sigio_pread(&batch);
+			ret = 0;
+		}
+	}
+
+	pthread_mutex_destroy(&batch.lock);
+	return ret;
+}
+
+/** \brief The files a database argument names, in order of precedence. */
+struct sigshards {
+	char **paths;
+	size_t n;
+	size_t cap;
+	int fd;
+};
+
+static int sigshards_add( struct sigshards *shards, const char *path )
+{
+	if( shards->n == shards->cap )
+	{
+		size_t cap = shards->cap ? shards->cap * 2 : 8;
+		char **grown = (char **) realloc(shards->paths, cap * sizeof(grown[0]));
+
+		if( grown == NULL ) return -1;
+		shards->paths = grown;
+		shards->cap = cap;
+	}
+
+	shards->paths[shards->n] = strdup(path);
+	if( shards->paths[shards->n] == NULL ) return -1;
+	shards->n++;
+	return 0;
+}
+
+static void sigshards_free( struct sigshards *shards )
+{
+	size_t i;
+
+	for( i = 0; i < shards->n; i++ ) free(shards->paths[i]);
+	free(shards->paths);
+	if( shards->fd >= 0 ) close(shards->fd);
+	memset(shards, 0, sizeof(*shards));
+	shards->fd = -1;
+}
+
+static bool is_pattern( const char *path )
+{
+	return strpbrk(path, "*?[") != NULL;
+}
+
+/* A directory that does not exist matches nothing, any other error fails the pattern */
+static int sigshards_glob_error( const char *path, int err )
+{
+	(void)path;
+	return err != ENOENT && err != ENOTDIR;
+}
+
+/** \brief Adds the files matching \p pattern in name order, or \p pattern itself if it has no wildcards. */
+static int sigshards_glob( struct sigshards *shards, const char *pattern )
+{
+	glob_t found;
+	size_t i;
+	int ret;
+
+	if( !is_pattern(pattern) ) return sigshards_add(shards, pattern);
+
+	ret = glob(pattern, 0, sigshards_glob_error, &found);
+	if( ret == GLOB_NOMATCH ) return 0;
+	if( ret != 0 )
+	{
+		errno = ret == GLOB_NOSPACE ? ENOMEM : EIO;
+		return -1;
+	}
+
+	for( i = 0; i < found.gl_pathc && ret == 0; i++ ) ret = sigshards_add(shards, found.gl_pathv[i]);
+	globfree(&found);
+	return ret;
+}
+
+/** \brief Adds the shards the manifest \p fh lists, one path or pattern per line.
+
+    Relative paths are relative to the directory of the manifest at \p path. Blank
+    lines and lines starting with '#', the SIGSHARDS_MAGIC line among them, are skipped.
+*/
+static int sigshards_manifest( struct sigshards *shards, FILE *fh, const char *path )
+{
+	const char *slash = strrchr(path, *OS_PATH_SEP);
+	size_t dir_len = slash ? (size_t)(slash - path) + 1 : 0;
+	char line[MAX_PATH], full_path[MAX_PATH];
+
+	while( fgets(line, sizeof(line), fh) )
+	{
+		size_t len = strcspn(line, "\r\n");
+		int sret;
+
+		if( line[len] == '\0' && !feof(fh) )
+		{
+			errno = EINVAL;
+			return -1;
+		}
+		line[len] = '\0';
+		if( len == 0 || line[0] == '#' ) continue;
+
+		sret = line[0] == *OS_PATH_SEP ? snprintf(full_path, sizeof(full_path), "%s", line)
+			: join_path(sizeof(full_path), full_path, path, dir_len, line);
+		if( sret <= 0 || sret >= MAX_PATH )
+		{
+			errno = EINVAL;
+			return -1;
+		}
+		if( sigshards_glob(shards, full_path) != 0 ) return -1;
+	}
+	return ferror(fh) ? -1 : 0;
+}
+
+/** \brief Finds the files of the database \p path_arg names.
+
+    A pattern with wildcards matches files in every DATA_PATH directory, those of
+    earlier directories first. A file starting with the line SIGSHARDS_MAGIC is a
+    manifest of shards. Anything else is one file, resolved like datafile_open(),
+    which is left open in \p fd, so that it is the file loaded even if it is replaced
+    meanwhile.
+
+    \returns 0 on success, -1 with errno set otherwise. errno is ENOENT if a pattern
+             or manifest names no files.
+*/
+static int sigshards_resolve( const char *path_arg, struct sigshards *shards )
+{
+	char full_path[MAX_PATH], head[sizeof(SIGSHARDS_MAGIC)];
+	ssize_t n;
+	FILE *fh;
+	int sret, ret, fd;
+
+	memset(shards, 0, sizeof(*shards));
+	shards->fd = -1;
+	if( path_arg && is_pattern(path_arg) )
+	{
+		const char *data_path = getenv("DATA_PATH"), *dir, *next;
+
+		for( dir = data_path ? data_path : ""; ; dir = next + 1 )
+		{
+			next = dir + strcspn(dir, OS_PATH_LIST_SEP);
+			sret = join_path(sizeof(full_path), full_path, dir, (size_t)(next - dir), path_arg);
+			if( sret <= 0 || sret >= MAX_PATH ) goto invalid;
+			if( sigshards_glob(shards, full_path) != 0 ) goto fail;
+			if( *next == '\0' ) break;
+		}
+		goto found;
+	}
+
+	sret = handle_path_arg(sizeof(full_path), full_path, path_arg);
+	if( sret <= 0 || sret >= MAX_PATH ) goto invalid;
+
+	if( (fd = open(full_path, O_RDONLY)) < 0 ) goto fail;
+	n = pread(fd, head, sizeof(head), 0);
+	if( n >= (ssize_t)sizeof(head) - 1 && 0 == memcmp(head, SIGSHARDS_MAGIC, sizeof(head) - 1)
+		&& (n == (ssize_t)sizeof(head) - 1 || head[sizeof(head) - 1] == '\r' || head[sizeof(head) - 1] == '\n') )
+	{
+		fh = fdopen(fd, "r");
+		if( fh == NULL )
+		{
+			close(fd);
+			goto fail;
+		}
+		ret = sigshards_manifest(shards, fh, full_path);
+		fclose(fh);
+		if( ret != 0 ) goto fail;
+		goto found;
+	}
+	shards->fd = fd;
+	if( sigshards_add(shards, full_path) != 0 ) goto fail;
+
+found:
+	if( shards->n > 0 ) return 0;
+	errno = ENOENT;
+	goto fail;
+invalid:
+	errno = EINVAL;
+fail:
+	ret = errno;
+	sigshards_free(shards);
+	errno = ret;
+	return -1;
+}
+
+/* Length of the checksum that starts every journal line, with the space after it */
+#define SIGJOURNAL_SUM 17
+
+/** \brief An entry of a journal. The strings of an upserted record are located by \p hot. */
+struct sigjournal_entry {
+	struct sighot hot;
+	bool remove;
+};
+
+/** \brief Stores the name of the journal of the database file \p path in \p out, -1 if it is too long. */
+static int sigjournal_path( char *out, size_t size, const char *path )
+{
+	int sret = snprintf(out, size, "%s%s", path, SIGJOURNAL_SUFFIX);
+
+	if( sret <= 0 || (size_t)sret >= size )
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	return 0;
+}
+
+/** \brief Parses the decimal number making up [\p pos, \p end), which must not exceed \p max. */
+static bool parse_decimal( const char *pos, const char *end, unsigned long max, unsigned long *value )
+{
+	*value = 0;
+	if( pos == end ) return false;
+	for( ; pos < end; pos++ )
+	{
+		if( *pos < '0' || *pos > '9' || *value > (max - (unsigned long)(*pos - '0')) / 10 ) return false;
+		*value = *value * 10 + (unsigned long)(*pos - '0');
+	}
+	return true;
+}
+
+/** \brief Checks the checksum of the journal line [\p line, \p nl).
+
+    \returns The operation after the checksum, or NULL if the line is damaged.
+*/
+static const char *sigjournal_line( const char *line, const char *nl )
+{
+	uint64_t sum = 0;
+	const char *pos;
+
+	if( nl - line < SIGJOURNAL_SUM + 2 || line[SIGJOURNAL_SUM - 1] != ' ' || line[SIGJOURNAL_SUM + 1] != ' ' ) return NULL;
+	for( pos = line; pos < line + SIGJOURNAL_SUM - 1; pos++ )
+	{
+		int digit = *pos >= '0' && *pos <= '9' ? *pos - '0' : *pos >= 'a' && *pos <= 'f' ? *pos - 'a' + 10 : -1;
+
+		if( digit < 0 ) return NULL;
+		sum = sum << 4 | (uint64_t)digit;
+	}
+	if( sum != fnv1a(FNV1A_INIT, line + SIGJOURNAL_SUM, (size_t)(nl - line) - SIGJOURNAL_SUM) ) return NULL;
+	return line + SIGJOURNAL_SUM;
+}
+
+/** \brief Parses the entries of the journal \p buf that belong to complete batches.
+
+    Every line is a checksum and an operation: "+ signum name description" upserts a
+    record, "- signum" removes one and "= count" commits the batch of the count lines
+    before it. A damaged line, a batch without its commit and a last line without a
+    newline, which is what a crash while appending leaves, are skipped. So are the
+    entries of a batch with a damaged line.
+
+    \returns The number of entries stored in \p out, which has room for one per line.
+*/
+static size_t sigjournal_parse( const char *buf, size_t len, struct sigjournal_entry *out )
+{
+	const char *pos, *nl, *end = buf + len;
+	size_t n = 0, pending = 0;
+
+	for( pos = buf; pos < end && (nl = (const char *)memchr(pos, '\n', (size_t)(end - pos))) != NULL; pos = nl + 1 )
+	{
+		const char *op = sigjournal_line(pos, nl);
+		struct sigjournal_entry *entry = &out[n + pending];
+		unsigned long value;
+
+		if( op != NULL && op[0] == '+' && parse_record(buf, op + 2, nl + 1, &entry->hot) == nl + 1 )
+		{
+			entry->remove = false;
+			pending++;
+		}
+		else if( op != NULL && op[0] == '-' && parse_decimal(op + 2, nl, USHRT_MAX, &value) )
+		{
+			memset(&entry->hot, 0, sizeof(entry->hot));
+			entry->hot.signum = (uint16_t)value;
+			entry->remove = true;
+			pending++;
+		}
+		else
+		{
+			/* entries before the batch are left from one cut short */
+			if( op != NULL && op[0] == '=' && parse_decimal(op + 2, nl, ULONG_MAX, &value) && value <= pending )
+			{
+				memmove(&out[n], &out[n + pending - value], value * sizeof(out[0]));
+				n += value;
+			}
+			pending = 0;
+		}
+	}
+	return n;
+}
+
+/** \brief Counts the records of \p hot with the journal \p entries applied, or stores them in \p out if not NULL.
+
+    The last entry of a signal number decides, \p last holds its index plus one for
+    every signal number, 0 for none. The records of a removed signal number are
+    dropped. Those of an upserted one are replaced by the new record at the place of
+    the first of them, or if there are none it is appended, in the order of the last
+    entries. Applying a journal twice thus gives the same records as applying it once.
+    \p out may be \p hot if it has room for them.
+*/
+static size_t sigjournal_merge( const struct sighot *hot, size_t size, const struct sigjournal_entry *entries,
+	size_t n, const uint32_t *last, struct sighot *out )
+{
+	uint64_t done[65536 / 64];
+	size_t kept = 0, i;
+
+	memset(done, 0, sizeof(done));
+	for( i = 0; i < size + n; i++ )
+	{
+		struct sighot rec;
+		uint32_t k;
+
+		if( i < size )
+		{
+			rec = hot[i];
+			k = last[rec.signum];
+			if( k == 0 )
+			{
+				if( out ) out[kept] = rec;
+				kept++;
+				continue;
+			}
+		}
+		else
+		{
+			k = (uint32_t)(i - size + 1);
+			if( last[entries[k - 1].hot.signum] != k ) continue;
+		}
+
+		rec = entries[k - 1].hot;
+		if( entries[k - 1].remove || (done[rec.signum / 64] & (UINT64_C(1) << (rec.signum % 64))) ) continue;
+		done[rec.signum / 64] |= UINT64_C(1) << (rec.signum % 64);
+		if( out ) out[kept] = rec;
+		kept++;
+	}
+	return kept;
+}
+
+/** \brief Grows the arena of the text table \p tab by \p extra writable bytes after its last page.
+
+    The old mapping is moved into the new one by mremap() if it is one mapping, and
+    copied if it is not, as for shards.
+
+    \returns The start of the new bytes, or NULL with errno set on error.
+*/
+static char *sigtable_grow( struct sigtable *tab, size_t extra )
+{
+	size_t page = (size_t)sysconf(_SC_PAGESIZE);
+	size_t base = (tab->map_len + page - 1) / page * page, total = checked_add(base, extra);
+	char *map;
+
+	if( total == 0 )
+	{
+		errno = ENOMEM;
+		return NULL;
+	}
+
+	map = (char *) mmap(NULL, total, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+	if( map == MAP_FAILED ) return NULL;
+	if( mremap(tab->map, tab->map_len, tab->map_len, MREMAP_MAYMOVE | MREMAP_FIXED, map) == MAP_FAILED )
+	{
+		memcpy(map, tab->map, tab->map_len);
+		munmap(tab->map, tab->map_len);
+	}
+
+	tab->map = map;
+	tab->map_len = total;
+	tab->arena = map;
+	tab->arena_len = total;
+	return map + base;
+}
+
+/** \brief Applies the journal at \p path, if there is one, to the text table \p tab.
+
+    The strings of the upserted records are copied after the database in the arena.
+    The records are rewritten in place if they do not grow, and into the region
+    otherwise. The number of journal bytes read is stored in \p journal_len.
+
+    \returns 0 on success, -1 with errno set otherwise. errno is ENOTSUP if the
+             journal has changes but \p tab is an image, bounded or packed.
+*/
+static int sigjournal_replay( struct sigtable *tab, const char *path, size_t *journal_len )
+{
+	struct sigjournal_entry *entries = NULL;
+	struct sighot *out;
+	uint32_t *last = NULL;
+	char *buf = NULL, *ext = NULL;
+	struct stat st;
+	size_t len, n, size, extra = 0, k;
+	int fd = open(path, O_RDONLY), ret = -1, err;
+
+	*journal_len = 0;
+	if( fd < 0 ) return errno == ENOENT ? 0 : -1;
+	if( fstat(fd, &st) != 0 ) goto done;
+	*journal_len = len = (size_t)st.st_size;
+	if( len == 0 )
+	{
+		ret = 0;
+		goto done;
+	}
+
+	buf = (char *) checked_malloc(len, 1);
+	/* every line takes at least a checksum, an operation and a newline */
+	entries = (struct sigjournal_entry *) checked_malloc(len / (SIGJOURNAL_SUM + 3) + 1, sizeof(entries[0]));
+	last = (uint32_t *) calloc(USHRT_MAX + 1, sizeof(last[0]));
+	if( buf == NULL || entries == NULL || last == NULL || pread_full(fd, buf, len, 0) != 0 ) goto done;
+
+	n = sigjournal_parse(buf, len, entries);
+	if( n == 0 )
+	{
+		ret = 0;
+		goto done;
+	}
+	if( tab->image || tab->pager || tab->pack || n >= UINT32_MAX )
+	{
+		errno = ENOTSUP;
+		goto done;
+	}
+
+	for( k = 0; k < n; k++ ) last[entries[k].hot.signum] = (uint32_t)(k + 1);
+	for( k = 0; k < n; k++ )
+	{
+		if( last[entries[k].hot.signum] == k + 1 && !entries[k].remove )
+		{
+			extra += (size_t)entries[k].hot.name_len + entries[k].hot.desc_len + 1;
+		}
+	}
+
+	if( extra > 0 )
+	{
+		ext = sigtable_grow(tab, extra);
+		if( ext == NULL ) goto done;
+		for( k = 0; k < n; k++ )
+		{
+			struct sighot *hot = &entries[k].hot;
+			size_t rec_len = (size_t)hot->name_len + hot->desc_len + 1;
+
+			if( last[hot->signum] != k + 1 || entries[k].remove ) continue;
+			memcpy(ext, buf + hot->off, rec_len);
+			hot->off = (uint64_t)(ext - tab->arena);
+			ext += rec_len;
+		}
+	}
+
+	size = sigjournal_merge(tab->hot, tab->size, entries, n, last, NULL);
+	out = size <= tab->size ? tab->hot
+		: (struct sighot *) sigregion_alloc(&tab->region, size, sizeof(out[0]), 64);
+	if( out == NULL ) goto done;
+	sigjournal_merge(tab->hot, tab->size, entries, n, last, out);
+	tab->hot = out;
+	tab->size = size;
+	ret = 0;
+
+done:
+	err = errno;
+	close(fd);
+	free(buf);
+	free(entries);
+	free(last);
+	errno = err;
+	return ret;
+}
+
+/** \brief Applies the journal at \p journal if not NULL, then packs and renders \p tab if configured to.
+
+    The number of journal bytes replayed is stored in \p journal_len if it is not NULL.
+*/
+static int sigtable_finish( struct sigtable *tab, const char *journal, size_t *journal_len )
+{
+	size_t len = 0;
+
+	if( journal && sigjournal_replay(tab, journal, &len) != 0 ) return -1;
+	if( journal_len ) *journal_len = len;
+	if( sigpack_on_load && !tab->image && !tab->pager && sigtable_pack(tab) != 0 ) return -1;
+	if( sigrender_on_load && !tab->pager && sigtable_render(tab) != 0 ) return -1;
+	return 0;
+}
+
+/** \brief Writes \p len bytes at \p off of \p fd. */
+static int pwrite_full( int fd, const char *buf, size_t len, size_t off )
+{
+	size_t done = 0;
+
+	while( done < len )
+	{
+		ssize_t n = pwrite(fd, buf + done, len - done, (off_t)(off + done));
+		if( n < 0 && errno == EINTR ) continue;
+		if( n < 0 ) return -1;
+		done += (size_t)n;
+	}
+	return 0;
+}
+
+/** \brief Syncs the directory of \p path, so that a file created or renamed there persists. */
+static int sync_dir( const char *path )
+{
+	char dir[MAX_PATH];
+	const char *slash = strrchr(path, *OS_PATH_SEP);
+	int fd, ret, err;
+
+	if( slash == NULL ) strcpy(dir, ".");
+	else if( snprintf(dir, sizeof(dir), "%.*s", slash == path ? 1 : (int)(slash - path), path) >= (int)sizeof(dir) )
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	if( (fd = open(dir, O_RDONLY | O_DIRECTORY)) < 0 ) return -1;
+	ret = fsync(fd);
+	err = errno;
+	close(fd);
+	errno = err;
+	return ret;
+}
+
+/** \brief Resolves \p path_arg like sigtable_open() and opens the journal of the database file, locked.
+
+    \returns The journal, or -1 with errno set on error. errno is EINVAL if \p path_arg
+             names shards, which have no journal, and ENOENT if \p create is not set
+             and there is no journal.
+*/
+static int sigjournal_open( const char *path_arg, bool create, char *db_path, size_t size )
+{
+	struct sigshards shards;
+	char journal[MAX_PATH];
+	int fd = -1, err;
+
+	if( sigshards_resolve(path_arg, &shards) != 0 ) return -1;
+	if( shards.fd < 0 || snprintf(db_path, size, "%s", shards.paths[0]) >= (int)size )
+	{
+		errno = EINVAL;
+		goto done;
+	}
+	if( sigjournal_path(journal, sizeof(journal), db_path) != 0 ) goto done;
+
+	fd = open(journal, O_RDWR | O_CLOEXEC | (create ? O_CREAT : 0), 0644);
+	if( fd >= 0 && flock(fd, LOCK_EX) != 0 )
+	{
+		close(fd);
+		fd = -1;
+	}
+
+done:
+	err = errno;
+	sigshards_free(&shards);
+	errno = err;
+	return fd;
+}
+
+/** \brief Checks that \p change can be written to a journal as it is, errno is EINVAL if not. */
+static int sigchange_check( const struct sigchange *change )
+{
+	size_t name_len = strnlen(change->rec.signame, sizeof(change->rec.signame));
+	size_t desc_len = strnlen(change->rec.sigdesc, sizeof(change->rec.sigdesc));
+	size_t i;
+
+	if( change->remove ) return 0;
+	if( name_len == 0 || name_len > SIGNAME_MAX || desc_len >= sizeof(change->rec.sigdesc) ) goto invalid;
+	for( i = 0; i < name_len; i++ )
+	{
+		if( is_space(change->rec.signame[i]) ) goto invalid;
+	}
+	if( strpbrk(change->rec.sigdesc, "\r\n") != NULL ) goto invalid;
+	return 0;
+
+invalid:
+	errno = EINVAL;
+	return -1;
+}
+
+/** \brief Parses a change written as in a journal, "+ signum name description" or "- signum".
+
+    \p line is \p len bytes without the newline.
+
+    \returns 0 on success, -1 with errno set to EINVAL otherwise.
+*/
+int sigchange_parse( const char *line, size_t len, struct sigchange *change )
+{
+	char buf[SIGLINE_MAX + 16];
+	struct sighot hot;
+	unsigned long value;
+
+	memset(change, 0, sizeof(*change));
+	if( len >= 2 && len < sizeof(buf) && line[0] == '-' && line[1] == ' '
+		&& parse_decimal(line + 2, line + len, USHRT_MAX, &value) )
+	{
+		change->remove = true;
+		change->rec.signum = (unsigned short)value;
+		return 0;
+	}
+	if( len < 2 || len >= sizeof(buf) || line[0] != '+' || line[1] != ' ' ) goto invalid;
+
+	memcpy(buf, line, len);
+	buf[len] = '\n';
+	if( parse_record(buf, buf + 2, buf + len + 1, &hot) != buf + len + 1 || hot.desc_len >= sizeof(change->rec.sigdesc) ) goto invalid;
+	change->rec.signum = hot.signum;
+	memcpy(change->rec.signame, buf + hot.off, hot.name_len);
+	memcpy(change->rec.sigdesc, buf + hot.off + hot.name_len + 1, hot.desc_len);
+	return sigchange_check(change);
+
+invalid:
+	errno = EINVAL;
+	return -1;
+}
+
+/** \brief Writes a journal line for \p op to \p pos, checksum first.
+
+    \returns The position after the line.
+*/
+static char *sigjournal_put( char *pos, const char *op, size_t len )
+{
+	snprintf(pos, SIGJOURNAL_SUM + 1, "%016llx ", (unsigned long long)fnv1a(FNV1A_INIT, op, len));
+	memcpy(pos + SIGJOURNAL_SUM, op, len);
+	pos[SIGJOURNAL_SUM + len] = '\n';
+	return pos + SIGJOURNAL_SUM + len + 1;
+}
+
+/** \brief Appends \p n changes to the journal of the database file \p path_arg as one batch.
+
+    The journal, the file named like the database plus SIGJOURNAL_SUFFIX, is created
+    if missing. The database file is never written. The batch is written with one
+    write and synced before this returns, so the cost is that of the changes rather
+    than of the database. The loaders apply a batch all or not at all: one cut short
+    by a crash is ignored and cut off by the next append. Appends and
+    sigjournal_compact() wait for each other.
+
+    \returns 0 on success, -1 with errno set otherwise. errno is EINVAL if a change
+             is not a valid record or \p path_arg names shards, which have no journal.
+*/
+int sigjournal_append( const char *path_arg, const struct sigchange *changes, size_t n )
+{
+	char db_path[MAX_PATH], tail[4096], op[SIGLINE_MAX + 16];
+	char *buf = NULL, *pos;
+	struct stat st;
+	size_t i, size, keep, line_max = SIGJOURNAL_SUM + sizeof(op) + 1;
+	int fd, ret = -1, err;
+
+	for( i = 0; i < n; i++ )
+	{
+		if( sigchange_check(&changes[i]) != 0 ) return -1;
+	}
+	if( n == 0 ) return 0;
+	buf = (char *) checked_malloc(n + 1, line_max);
+	if( buf == NULL ) return -1;
+
+	fd = sigjournal_open(path_arg, true, db_path, sizeof(db_path));
+	if( fd < 0 || fstat(fd, &st) != 0 ) goto done;
+
+	/* cut off the unfinished line a crash may have left */
+	size = keep = (size_t)st.st_size;
+	while( keep > 0 )
+	{
+		size_t chunk = keep < sizeof(tail) ? keep : sizeof(tail);
+		const char *nl;
+
+		if( pread_full(fd, tail, chunk, keep - chunk) != 0 ) goto done;
+		nl = (const char *)memrchr(tail, '\n', chunk);
+		if( nl )
+		{
+			keep = keep - chunk + (size_t)(nl - tail) + 1;
+			break;
+		}
+		keep -= chunk;
+	}
+	if( keep != size && ftruncate(fd, (off_t)keep) != 0 ) goto done;
+
+	for( pos = buf, i = 0; i < n; i++ )
+	{
+		const struct sigrecord *rec = &changes[i].rec;
+		int len = changes[i].remove ? snprintf(op, sizeof(op), "- %u", rec->signum)
+			: snprintf(op, sizeof(op), "+ %u %s %s", rec->signum, rec->signame, rec->sigdesc);
+
+		pos = sigjournal_put(pos, op, (size_t)len);
+	}
+	pos = sigjournal_put(pos, op, (size_t)snprintf(op, sizeof(op), "= %zu", n));
+
+	if( pwrite_full(fd, buf, (size_t)(pos - buf), keep) != 0 || fdatasync(fd) != 0 ) goto done;
+	ret = keep == 0 ? sync_dir(db_path) : 0;
+
+done:
+	err = errno;
+	if( fd >= 0 ) close(fd);
+	free(buf);
+	errno = err;
+	return ret;
+}
+
+/** \brief Writes \p loaded, or the database file \p path_arg with its journal applied, over the file.
+
+    \p loaded is only written if \p source shows it was loaded from the current file
+    and all of its journal, otherwise the file is loaded again. See sigjournal_compact().
+*/
+static int sigjournal_fold( const char *path_arg, const struct sigtable *loaded, const struct sigsource *source )
+{
+	char db_path[MAX_PATH], tmp_path[MAX_PATH];
+	struct sigtable *tab = NULL;
+	const struct sigtable *fold = loaded;
+	struct sigview view;
+	struct stat st, db_st;
+	FILE *out = NULL;
+	size_t i;
+	int fd, ret = -1, err;
+
+	fd = sigjournal_open(path_arg, false, db_path, sizeof(db_path));
+	if( fd < 0 ) return errno == ENOENT ? 0 : -1;
+	if( fstat(fd, &st) != 0 || stat(db_path, &db_st) != 0 ) goto done;
+	if( st.st_size == 0 )
+	{
+		ret = 0;
+		goto done;
+	}
+
+	/* an append or another compaction may have come before the lock was taken */
+	if( loaded == NULL || source->dev != db_st.st_dev || source->ino != db_st.st_ino
+		|| source->journal_len != (size_t)st.st_size )
+	{
+		tab = sigtable_map(path_arg, true, 0, NULL);
+		if( tab == NULL ) goto done;
+		fold = tab;
+	}
+	if( fold->size == 0 || snprintf(tmp_path, sizeof(tmp_path), "%s.compact", db_path) >= (int)sizeof(tmp_path) )
+	{
+		errno = EINVAL;
+		goto done;
+	}
+
+	/* the new file takes the owner, where permitted, and the mode of the one it replaces */
+	out = fopen(tmp_path, "w");
+	if( out == NULL ) goto done;
+	if( (fchown(fileno(out), db_st.st_uid, db_st.st_gid) != 0 && errno != EPERM)
+		|| fchmod(fileno(out), db_st.st_mode & 07777) != 0 )
+	{
+		goto done;
+	}
+	fprintf(out, "%zu\n", fold->size);
+	for( i = 0; i < fold->size; i++ )
+	{
+		if( sigtable_get(fold, i, &view) == NULL ) goto done;
+		fprintf(out, "%d %.*s %.*s\n", view.signum, (int)view.name_len, view.name, (int)view.desc_len, view.desc);
+	}
+	if( fflush(out) != 0 || ferror(out) || fsync(fileno(out)) != 0 ) goto done;
+	if( rename(tmp_path, db_path) != 0 || sync_dir(db_path) != 0 ) goto done;
+	if( ftruncate(fd, 0) != 0 || fsync(fd) != 0 ) goto done;
+	ret = 0;
+
+done:
+	err = errno;
+	if( out )
+	{
+		fclose(out);
+		if( ret != 0 ) unlink(tmp_path);
+	}
+	sigtable_close(tab);
+	close(fd);
+	errno = err;
+	return ret;
+}
+
+/** \brief Folds the journal of the database file \p path_arg into the database.
+
+    The records with the journal applied are written to a new file next to the
+    database, which is synced and renamed over it, then the journal is emptied.
+    Appends wait meanwhile. A crash before the rename leaves the old database and
+    journal. One after it leaves the new database with the old journal, whose
+    replay changes nothing since its changes are in already. The new database keeps
+    the mode of the old one. Loads take no lock: one that read the old database and
+    then the emptied journal sees the rename and loads again.
+
+    \returns 0 on success or if there is no journal, -1 with errno set otherwise.
+             errno is EINVAL if no records would be left.
+*/
+int sigjournal_compact( const char *path_arg )
+{
+	return sigjournal_fold(path_arg, NULL, NULL);
+}
+
+static struct sigtable *sigtable_map_file( int fd, bool copy, size_t budget );
+static struct sigtable *sigtable_map_shards( const struct sigshards *shards, bool copy, size_t budget );
+
+static struct sigtable *sigtable_map( const char *path_arg, bool copy, size_t budget, struct sigsource *source )
+{
+	struct sigtable *tab;
+	struct sigshards shards;
+	struct sigstats_timer timer;
+	struct stat base, now;
+	char journal[MAX_PATH];
+	size_t journal_len = 0;
+	bool named;
+	int err;
+
+retry:
+	tab = NULL;
+	sigstats_start(&timer);
+	err = sigshards_resolve(path_arg, &shards);
+	sigstats_stop(&timer, SIGSTATS_OPEN);
+	if( err != 0 ) return NULL;
+
+	/* only a database file named by the argument has a journal */
+	named = shards.fd >= 0 && sigjournal_path(journal, sizeof(journal), shards.paths[0]) == 0;
+	if( named && fstat(shards.fd, &base) != 0 ) goto done;
+
+	if( shards.n > 1 ) tab = sigtable_map_shards(&shards, copy, budget);
+	else if( shards.fd >= 0 || (shards.fd = open(shards.paths[0], O_RDONLY)) >= 0 )
+	{
+		tab = sigtable_map_file(shards.fd, copy, budget);
+		shards.fd = -1;
+	}
+
+	if( tab != NULL )
+	{
+		sigstats_start(&timer);
+		err = sigtable_finish(tab, named ? journal : NULL, &journal_len);
+		sigstats_stop(&timer, SIGSTATS_PARSE);
+		if( err != 0 )
+		{
+			err = errno;
+			sigtable_close(tab);
+			tab = NULL;
+			errno = err;
+		}
+	}
+
+	/* a compaction renamed a new file over the database, so the journal read may
+	   already have been emptied of changes the loaded file lacks */
+	if( tab != NULL && named && stat(shards.paths[0], &now) == 0
+		&& (now.st_dev != base.st_dev || now.st_ino != base.st_ino) )
+	{
+		sigtable_close(tab);
+		sigshards_free(&shards);
+		goto retry;
+	}
+	if( tab != NULL && source != NULL )
+	{
+		source->dev = named ? base.st_dev : 0;
+		source->ino = named ? base.st_ino : 0;
+		source->journal_len = journal_len;
+	}
+
+done:
+	err = errno;
+	sigshards_free(&shards);
+	errno = err;
+	return tab;
+}
+
+/* Loads the database open as \p fd, which it closes */
+static struct sigtable *sigtable_map_file( int fd, bool copy, size_t budget )
+{
+	struct sigtable *tab = NULL;
+	struct sigio_file file;
+	struct sigstats_timer timer;
+	enum sigstats_phase phase = SIGSTATS_OPEN;
+	struct stat st;
+	int err;
+
+	sigstats_start(&timer);
+	if( fstat(fd, &st) != 0 ) goto close_fd;
+	if( st.st_size <= 0 || (uintmax_t)st.st_size > SIZE_MAX )
+	{
+		errno = EINVAL;
+		goto close_fd;
+	}
+
+	tab = (struct sigtable *) checked_malloc(1, sizeof(*tab));
+	if( tab == NULL ) goto close_fd;
+
+	tab->map_len = (size_t)st.st_size;
+	if( copy )
+	{
+		tab->map = mmap(NULL, tab->map_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+		if( tab->map == MAP_FAILED ) goto free_tab;
+
+		file.fd = fd;
+		file.buf = (char *)tab->map;
+		file.len = tab->map_len;
+		if( sigio_read(&file, 1, NULL, NULL) != 0 ) goto unmap;
+		if( file.err != 0 )
+		{
+			errno = file.err;
+			goto unmap;
+		}
+	}
+	else
+	{
+		tab->map = mmap(NULL, tab->map_len, PROT_READ, MAP_PRIVATE, fd, 0);
+		if( tab->map == MAP_FAILED ) goto free_tab;
+	}
+
+	tab->hot = NULL;
+	tab->arena = (const char *)tab->map;
+	tab->arena_len = tab->map_len;
+	tab->image = false;
+	memset(&tab->names, 0, sizeof(tab->names));
+	memset(&tab->text, 0, sizeof(tab->text));
+	memset(&tab->nums, 0, sizeof(tab->nums));
+	tab->pager = NULL;
+	tab->pack = NULL;
+	memset(&tab->render, 0, sizeof(tab->render));
+	sigregion_init(&tab->region, sigregion_flags);
+
+	sigstats_stop(&timer, phase);
+	sigstats_start(&timer);
+	phase = SIGSTATS_PARSE;
+
+	if( tab->map_len >= sizeof(SIGIMAGE_MAGIC) - 1
+		&& 0 == memcmp(tab->map, SIGIMAGE_MAGIC, sizeof(SIGIMAGE_MAGIC) - 1) )
+	{
+		if( sigimage_attach(tab) != 0 ) goto unmap;
+	}
+	else if( budget != 0 )
+	{
+		madvise(tab->map, tab->map_len, MADV_SEQUENTIAL);
+		tab->pager = sigpager_create(fd, (const char *)tab->map, tab->map_len, budget, &tab->size);
+		if( tab->pager == NULL ) goto unmap;
+
+		/* only the page index is kept, records are read back on demand */
+		munmap(tab->map, tab->map_len);
+		tab->map = NULL;
+		tab->map_len = 0;
+		tab->arena = NULL;
+		tab->arena_len = 0;
+	}
+	else
+	{
+		madvise(tab->map, tab->map_len, MADV_SEQUENTIAL);
+		tab->hot = map_records_parallel_in((const char *)tab->map, tab->map_len, &tab->size, 0, &tab->region);
+		if( tab->hot == NULL ) goto unmap;
+	}
+	if( tab->map ) madvise(tab->map, tab->map_len, MADV_RANDOM);
+
+	sigstats_add(&sigstats.bytes_read, (uint64_t)st.st_size);
+	sigstats_add(&sigstats.records_parsed, tab->size);
+	sigstats_stop(&timer, phase);
+	close(fd);
+	return tab;
+
+unmap:
+	err = errno;
+	if( phase == SIGSTATS_PARSE ) sigstats_add(&sigstats.records_rejected, 1);
+	sigregion_free(&tab->region);
+	munmap(tab->map, tab->map_len);
+	errno = err;
+free_tab:
+	free(tab);
+	tab = NULL;
+close_fd:
+	err = errno;
+	sigstats_stop(&timer, phase);
+	if( fd >= 0 ) close(fd);
+	errno = err;
+	return NULL;
+}
+
+/** \brief A shard of a table loaded by sigtable_map_shards(), placed at \p slot of the arena. */
+struct sigshard {
+	const char *path;
+	int fd;
+	size_t len;
+	size_t slot;
+	struct sighot *recs;
+	size_t size;
+	int err;
+};
+
+/** \brief The work the threads of sigtable_map_shards() share.
+
+    Shards are parsed in the order they are queued. Mapped shards are all queued at
+    once, largest first; shards read with \p copy are queued as their reads complete.
+*/
+struct sigshard_load {
+	char *base;
+	struct sigshard *shards;
+	struct sigshard **order;
+	struct sigio_file *files;
+	struct sigshard **queue;
+	size_t n;
+	size_t queued;
+	size_t next;
+	bool copy;
+	unsigned threads;
+	pthread_mutex_t lock;
+	pthread_cond_t ready;
+};
+
+static void sigshard_queue( struct sigshard_load *load, struct sigshard *shard )
+{
+	pthread_mutex_lock(&load->lock);
+	load->queue[load->queued++] = shard;
+	pthread_cond_broadcast(&load->ready);
+	pthread_mutex_unlock(&load->lock);
+}
+
+/** \brief Queues the shard of \p file, which sigio_read() has read, for parsing. */
+static void sigshard_read( void *arg, struct sigio_file *file )
+{
+	struct sigshard_load *load = (struct sigshard_load *)arg;
+	struct sigshard *shard = load->order[file - load->files];
+
+	shard->err = file->err;
+	sigshard_queue(load, shard);
+}
+
+/** \brief Maps queued shards into their slots if not read there and parses them until none are left. */
+static void *sigshard_run( void *arg )
+{
+	struct sigshard_load *load = (struct sigshard_load *)arg;
+
+	for( ;; )
+	{
+		struct sigshard *shard = NULL;
+		char *at;
+		unsigned threads = load->threads;
+
+		pthread_mutex_lock(&load->lock);
+		while( load->next == load->queued && load->queued < load->n ) pthread_cond_wait(&load->ready, &load->lock);
+		if( load->next < load->queued ) shard = load->queue[load->next++];
+		pthread_mutex_unlock(&load->lock);
+		if( shard == NULL ) break;
+		if( shard->err != 0 ) continue;
+
+		at = load->base + shard->slot;
+		if( !load->copy && mmap(at, shard->len, PROT_READ, MAP_PRIVATE | MAP_FIXED, shard->fd, 0) == MAP_FAILED )
+		{
+			shard->err = errno;
+			continue;
+		}
+		/* images cannot share an arena */
+		if( shard->len >= sizeof(SIGIMAGE_MAGIC) - 1 && 0 == memcmp(at, SIGIMAGE_MAGIC, sizeof(SIGIMAGE_MAGIC) - 1) )
+		{
+			shard->err = EINVAL;
+			continue;
+		}
+
+		if( shard->len / PARSE_CHUNK_MIN < threads ) threads = (unsigned)(shard->len / PARSE_CHUNK_MIN);
+		madvise(at, shard->len, MADV_SEQUENTIAL);
+		shard->recs = map_records_parallel_in(at, shard->len, &shard->size, threads ? threads : 1, NULL);
+		if( shard->recs == NULL ) shard->err = errno;
+	}
+	return NULL;
+}
+
+/** \brief Reads all shards of \p load into their slots with sigio_read(), queueing each when done. */
+static void sigshards_read( struct sigshard_load *load )
+{
+	size_t k;
+	int err;
+
+	for( k = 0; k < load->n; k++ )
+	{
+		load->files[k].fd = load->order[k]->fd;
+		load->files[k].buf = load->base + load->order[k]->slot;
+		load->files[k].len = load->order[k]->len;
+	}
+	if( sigio_read(load->files, load->n, sigshard_read, load) == 0 ) return;
+
+	/* no reads were made */
+	err = errno;
+	for( k = 0; k < load->n; k++ )
+	{
+		load->order[k]->err = err;
+		sigshard_queue(load, load->order[k]);
+	}
+}
+
+/** \brief Counts the records of \p shards that merge into one table, or copies them to \p out if not NULL.
+
+    A record is kept unless an earlier shard has a record of the same signal number.
+*/
+static size_t sigshards_merge( const struct sigshard *shards, size_t n, struct sighot *out )
+{
+	uint64_t seen[65536 / 64];
+	size_t kept = 0, i, k;
+
+	memset(seen, 0, sizeof(seen));
+	for( i = 0; i < n; i++ )
+	{
+		const struct sigshard *shard = &shards[i];
+
+		for( k = 0; k < shard->size; k++ )
+		{
+			uint16_t signum = shard->recs[k].signum;
+
+			if( seen[signum / 64] & (UINT64_C(1) << (signum % 64)) ) continue;
+			if( out )
+			{
+				out[kept] = shard->recs[k];
+				out[kept].off += shard->slot;
+			}
+			kept++;
+		}
+		for( k = 0; k < shard->size; k++ ) seen[shard->recs[k].signum / 64] |= UINT64_C(1) << (shard->recs[k].signum % 64);
+	}
+	return kept;
+}
+
+/** \brief Loads the text databases of \p shards side by side in one arena, in parallel.
+
+    Every shard gets a page aligned slot of one reserved range. The shards are mapped
+    into their slots and parsed by up to one thread per CPU, the largest first, so
+    that the load takes about as long as the largest shard. With \p copy the calling
+    thread reads them with sigio_read() instead, while the parsing threads take each
+    shard as soon as it is in. Their records are then merged in order, see
+    sigshards_merge().
+*/
+static struct sigtable *sigtable_map_shards( const struct sigshards *shards, bool copy, size_t budget )
+{
+	struct sigtable *tab = NULL;
+	struct sigshard_load load;
+	struct sigstats_timer timer;
+	enum sigstats_phase phase = SIGSTATS_OPEN;
+	pthread_t *threads = NULL;
+	size_t page = (size_t)sysconf(_SC_PAGESIZE), total = 0, bytes = 0, i, k;
+	unsigned cpus = online_cpus(), workers, started = 0;
+	int err;
+
+	sigstats_start(&timer);
+	memset(&load, 0, sizeof(load));
+	pthread_mutex_init(&load.lock, NULL);
+	pthread_cond_init(&load.ready, NULL);
+	if( budget != 0 )
+	{
+		/* a pager reads from one file */
+		errno = ENOTSUP;
+		goto fail;
+	}
+
+	load.n = shards->n;
+	load.copy = copy;
+	load.shards = (struct sigshard *) checked_malloc(load.n, sizeof(load.shards[0]));
+	load.order = (struct sigshard **) checked_malloc(load.n, sizeof(load.order[0]));
+	load.files = (struct sigio_file *) checked_malloc(load.n, sizeof(load.files[0]));
+	load.queue = (struct sigshard **) checked_malloc(load.n, sizeof(load.queue[0]));
+	if( load.shards == NULL || load.order == NULL || load.files == NULL || load.queue == NULL ) goto fail;
+	memset(load.shards, 0, load.n * sizeof(load.shards[0]));
+	for( i = 0; i < load.n; i++ ) load.shards[i].fd = -1;
+
+	for( i = 0; i < load.n; i++ )
+	{
+		struct sigshard *shard = &load.shards[i];
+		struct stat st;
+
+		shard->path = shards->paths[i];
+		if( (shard->fd = open(shard->path, O_RDONLY)) < 0 || fstat(shard->fd, &st) != 0 ) goto fail;
+		if( st.st_size <= 0 || (uintmax_t)st.st_size > SIZE_MAX - page )
+		{
+			errno = EINVAL;
+			goto fail;
+		}
+		shard->len = (size_t)st.st_size;
+		shard->slot = total;
+		total = checked_add(total, (shard->len + page - 1) / page * page);
+		if( total == 0 )
+		{
+			errno = EINVAL;
+			goto fail;
+		}
+		bytes += shard->len;
+
+		/* largest first */
+		for( k = i; k > 0 && load.order[k - 1]->len < shard->len; k-- ) load.order[k] = load.order[k - 1];
+		load.order[k] = shard;
+	}
+
+	tab = (struct sigtable *) checked_malloc(1, sizeof(*tab));
+	if( tab == NULL ) goto fail;
+	memset(tab, 0, sizeof(*tab));
+	sigregion_init(&tab->region, sigregion_flags);
+	tab->map_len = total;
+	tab->map = mmap(NULL, total, copy ? PROT_READ | PROT_WRITE : PROT_NONE,
+		MAP_PRIVATE | MAP_ANONYMOUS | (copy ? 0 : MAP_NORESERVE), -1, 0);
+	if( tab->map == MAP_FAILED )
+	{
+		tab->map = NULL;
+		goto fail;
+	}
+	load.base = (char *)tab->map;
+
+	sigstats_stop(&timer, phase);
+	sigstats_start(&timer);
+	phase = SIGSTATS_PARSE;
+
+	if( !copy )
+	{
+		memcpy(load.queue, load.order, load.n * sizeof(load.queue[0]));
+		load.queued = load.n;
+	}
+
+	/* while this thread reads, all workers parse */
+	workers = load.n < cpus ? (unsigned)load.n : cpus;
+	load.threads = cpus / workers;
+	if( !copy ) workers--;
+	threads = (pthread_t *) checked_malloc(workers ? workers : 1, sizeof(threads[0]));
+	while( threads && started < workers && pthread_create(&threads[started], NULL, sigshard_run, &load) == 0 ) started++;
+	if( copy ) sigshards_read(&load);
+	sigshard_run(&load);
+	for( i = 0; i < started; i++ ) pthread_join(threads[i], NULL);
+
+	for( i = 0; i < load.n; i++ )
+	{
+		if( load.shards[i].err != 0 )
+		{
+			errno = load.shards[i].err;
+			goto fail;
+		}
+	}
+
+	tab->size = sigshards_merge(load.shards, load.n, NULL);
+	tab->hot = (struct sighot *) sigregion_alloc(&tab->region, tab->size ? tab->size : 1, sizeof(tab->hot[0]), 64);
+	if( tab->hot == NULL ) goto fail;
+	sigshards_merge(load.shards, load.n, tab->hot);
+	tab->arena = (const char *)tab->map;
+	tab->arena_len = tab->map_len;
+	madvise(tab->map, tab->map_len, MADV_RANDOM);
+
+	sigstats_add(&sigstats.bytes_read, bytes);
+	sigstats_add(&sigstats.records_parsed, tab->size);
+	goto done;
+
+fail:
+	err = errno;
+	if( phase == SIGSTATS_PARSE ) sigstats_add(&sigstats.records_rejected, 1);
+	if( tab )
+	{
+		sigtable_close(tab);
+		tab = NULL;
+	}
+	errno = err;
+done:
+	err = errno;
+	sigstats_stop(&timer, phase);
+	for( i = 0; load.shards && i < load.n; i++ )
+	{
+		free(load.shards[i].recs);
+		if( load.shards[i].fd >= 0 ) close(load.shards[i].fd);
+	}
+	free(load.shards);
+	free(load.order);
+	free(load.files);
+	free(load.queue);
+	free(threads);
+	pthread_cond_destroy(&load.ready);
+	pthread_mutex_destroy(&load.lock);
+	errno = err;
+	return tab;
+}
+
+/** \brief Releases a table returned by sigtable_open(), sigtable_load(), sigtable_open_bounded(),
+    sigtable_attach() or sigtable_parse().
+*/
+void sigtable_close( struct sigtable *tab )
+{
+	if( tab )
+	{
+		sigregion_free(&tab->region);
+		sigpager_destroy(tab->pager);
+		if( tab->map ) munmap(tab->map, tab->map_len);
+		free(tab);
+	}
+}
+
+/* Size of the query buffer, a longer input line is answered in pieces like fgets() returns them */
+#define QUERY_MAX 10
+/* Size of the buffer for a text search or signal number query, which read on past QUERY_MAX to the end of their line */
+#define SEARCH_MAX 256
+
+/** \brief Output collected in memory and written out with few large write() calls. */
+struct outbuf {
+	int fd;
+	size_t used;
+	size_t cap;
+	char *data;
+};
+
+static int outbuf_init( struct outbuf *out, int fd, size_t cap )
+{
+	out->fd = fd;
+	out->used = 0;
+	out->cap = cap;
+	out->data = (char *) checked_malloc(cap, 1);
+	return out->data ? 0 : -1;
+}
+
+static int outbuf_flush( struct outbuf *out )
+{
+	size_t done = 0;
+
+	while( done < out->used )
+	{
+		ssize_t n = write(out->fd, out->data + done, out->used - done);
+		if( n < 0 )
+		{
+			if( errno == EINTR ) continue;
+			return -1;
+		}
+		done += (size_t)n;
+	}
+
+	out->used = 0;
+	return 0;
+}
+
+static void outbuf_free( struct outbuf *out )
+{
+	free(out->data);
+	out->data = NULL;
+}
+
+/** \brief Appends to \p out, flushing it when full. A buffer without a file descriptor grows instead. */
+static int outbuf_put( struct outbuf *out, const char *data, size_t len )
+{
+	if( out->fd < 0 && len > out->cap - out->used )
+	{
+		size_t cap = out->cap;
+		char *grown;
+
+		while( len > cap - out->used )
+		{
+			if( cap > SIZE_MAX / 2 )
+			{
+				errno = ENOMEM;
+				return -1;
+			}
+			cap *= 2;
+		}
+		if( (grown = (char *) realloc(out->data, cap)) == NULL ) return -1;
+		out->data = grown;
+		out->cap = cap;
+	}
+
+	while( len > out->cap - out->used )
+	{
+		size_t chunk = out->cap - out->used;
+
+		memcpy(out->data + out->used, data, chunk);
+		out->used += chunk;
+		if( outbuf_flush(out) != 0 ) return -1;
+		data += chunk;
+		len -= chunk;
+	}
+
+	memcpy(out->data + out->used, data, len);
+	out->used += len;
+	return 0;
+}
+
+static int outbuf_puts( struct outbuf *out, const char *str )
+{
+	return outbuf_put(out, str, strlen(str));
+}
+
+/* Longest line render_record() writes */
+#define RENDER_MAX (8 + SIGNAME_MAX + sizeof(((struct sigrecord *)0)->sigdesc))
+
+/** \brief Writes \p rec to \p line as printf("%d %s %s\n") would print it.
+
+    \returns The length of the line, at most RENDER_MAX.
+*/
+static size_t render_record( const struct sigview *rec, char *line )
+{
+	char digits[8];
+	size_t n = 0, d = 0, len;
+	unsigned num = rec->signum;
+
+	do
+	{
+		digits[d++] = (char)('0' + num % 10);
+		num /= 10;
+	} while( num > 0 );
+	while( d > 0 ) line[n++] = digits[--d];
+	line[n++] = ' ';
+
+	/* %.*s stops early at a NUL byte */
+	len = strnlen(rec->name, rec->name_len);
+	memcpy(line + n, rec->name, len);
+	n += len;
+	line[n++] = ' ';
+
+	len = strnlen(rec->desc, rec->desc_len);
+	memcpy(line + n, rec->desc, len);
+	n += len;
+	line[n++] = '\n';
+
+	return n;
+}
+
+/* Answer to a query for a record sigtable_get() cannot read */
+#define CORRUPT_RECORD "Corrupt record.\n"
+
+bool sigrender_on_load = false;
+
+/** \brief Renders the answer line of every record into one buffer, see struct sigrender.
+
+    A record that cannot be read is rendered as its answer would be. This costs
+    about as much memory again as the strings, and saves formatting every answer.
+    Does nothing if already rendered.
+
+    \returns 0 on success, -1 with errno set otherwise. errno is ENOTSUP for a table
+             opened with a budget.
+*/
+int sigtable_render( struct sigtable *tab )
+{
+	char *lines, line[RENDER_MAX];
+	uint64_t *off;
+	size_t total = 0, i;
+
+	if( tab->render.off ) return 0;
+	if( tab->pager )
+	{
+		errno = ENOTSUP;
+		return -1;
+	}
+
+	/* measure first, to render straight into the region */
+	for( i = 0; i < tab->size; i++ )
+	{
+		struct sigview view;
+		const struct sigview *rec = sigtable_get(tab, i, &view);
+
+		total += rec ? render_record(rec, line) : sizeof(CORRUPT_RECORD) - 1;
+	}
+
+	off = (uint64_t *) sigregion_alloc(&tab->region, tab->size + 1, sizeof(off[0]), 64);
+	lines = (char *) sigregion_alloc(&tab->region, total ? total : 1, 1, 64);
+	if( off == NULL || lines == NULL ) return -1;
+
+	for( i = 0, total = 0; i < tab->size; i++ )
+	{
+		struct sigview view;
+		const struct sigview *rec = sigtable_get(tab, i, &view);
+
+		off[i] = total;
+		if( rec ) total += render_record(rec, lines + total);
+		else
+		{
+			memcpy(lines + total, CORRUPT_RECORD, sizeof(CORRUPT_RECORD) - 1);
+			total += sizeof(CORRUPT_RECORD) - 1;
+		}
+	}
+	off[tab->size] = total;
+
+	tab->render.lines = lines;
+	tab->render.off = off;
+	return 0;
+}
+
+/** \brief Appends \p rec as printf("%d %s %s\n") would print it. */
+static int outbuf_record( struct outbuf *out, const struct sigview *rec )
+{
+	char line[RENDER_MAX];
+
+	return outbuf_put(out, line, render_record(rec, line));
+}
+
+static int outbuf_index( struct outbuf *out, const struct sigtable *tab, size_t idx )
+{
+	struct sigview view;
+	const struct sigview *rec;
+
+	if( tab->render.off && idx < tab->size )
+	{
+		const uint64_t *off = tab->render.off + idx;
+
+		return outbuf_put(out, tab->render.lines + off[0], (size_t)(off[1] - off[0]));
+	}
+
+	rec = sigtable_get(tab, idx, &view);
+	return rec ? outbuf_record(out, rec) : outbuf_puts(out, CORRUPT_RECORD);
+}
+
+#define SIGEXPORT_BLOCK (1 << 20)
+/* Longest record export_record() writes, every byte of the strings may become a \u00XX escape */
+#define SIGEXPORT_MAX (64 + 6 * (SIGNAME_MAX + sizeof(((struct sigrecord *)0)->sigdesc)))
+
+/* Writes \p value in decimal to \p out, returns the number of digits */
+static size_t export_number( uint64_t value, char *out )
+{
+	char digits[20];
+	size_t d = 0, n = 0;
+
+	do
+	{
+		digits[d++] = (char)('0' + value % 10);
+		value /= 10;
+	} while( value > 0 );
+	while( d > 0 ) out[n++] = digits[--d];
+	return n;
+}
+
+/** \brief The length of the well-formed UTF-8 sequence of 2 to 4 bytes at \p str, 0 if there is none. */
+static size_t utf8_length( const unsigned char *str, size_t len )
+{
+	unsigned char lo = 0x80, hi = 0xbf;
+	size_t n, i;
+
+	if( str[0] >= 0xc2 && str[0] <= 0xdf ) n = 2;
+	else if( str[0] >= 0xe0 && str[0] <= 0xef ) n = 3;
+	else if( str[0] >= 0xf0 && str[0] <= 0xf4 ) n = 4;
+	else return 0;
+
+	/* no overlong forms, surrogates or code points past U+10FFFF */
+	if( str[0] == 0xe0 ) lo = 0xa0;
+	else if( str[0] == 0xed ) hi = 0x9f;
+	else if( str[0] == 0xf0 ) lo = 0x90;
+	else if( str[0] == 0xf4 ) hi = 0x8f;
+
+	if( n > len ) return 0;
+	for( i = 1; i < n; i++ )
+	{
+		if( str[i] < lo || str[i] > hi ) return 0;
+		lo = 0x80;
+		hi = 0xbf;
+	}
+	return n;
+}
+
+/** \brief Writes \p str as a JSON string, quotes included, or as a CSV field if \p csv.
+
+    Like the answers, the string ends at a NUL byte. A CSV field is quoted only if it
+    holds a comma, a quote or a line break. In JSON, a byte that is not part of
+    well-formed UTF-8 is escaped as the code point of the same value, like control
+    bytes, so that the output is valid whatever the encoding of the database.
+
+    \returns The number of bytes written to \p out.
+*/
+static size_t export_string( const char *str, size_t len, bool csv, char *out )
+{
+	static const char hex[] = "0123456789abcdef";
+	size_t n = 0, i, k;
+	bool quote = !csv;
+
+	/* the view need not be terminated, so only its own bytes are looked at */
+	len = strnlen(str, len);
+	for( i = 0; i < len && !quote; i++ )
+	{
+		quote = str[i] == ',' || str[i] == '"' || str[i] == '\r' || str[i] == '\n';
+	}
+	if( !quote )
+	{
+		memcpy(out, str, len);
+		return len;
+	}
+
+	out[n++] = '"';
+	for( i = 0; i < len; i++ )
+	{
+		unsigned char c = (unsigned char)str[i];
+
+		if( c == '"' ) out[n++] = csv ? '"' : '\\';
+		else if( c == '\\' && !csv ) out[n++] = '\\';
+		else if( c >= 0x80 && !csv && (k = utf8_length((const unsigned char *)str + i, len - i)) != 0 )
+		{
+			memcpy(out + n, str + i, k);
+			n += k;
+			i += k - 1;
+			continue;
+		}
+		else if( (c < 0x20 || c >= 0x80) && !csv )
+		{
+			memcpy(out + n, "\\u00", 4);
+			out[n + 4] = hex[c >> 4];
+			out[n + 5] = hex[c & 15];
+			n += 6;
+			continue;
+		}
+		out[n++] = (char)c;
+	}
+	out[n++] = '"';
+	return n;
+}
+
+/** \brief Writes record \p idx of \p tab in \p format to \p out, which has room for SIGEXPORT_MAX bytes.
+
+    A record that cannot be read is written as its answer would be, and is an error
+    for the other formats.
+
+    \returns The number of bytes written, 0 with errno set on error.
+*/
+static size_t export_record( const struct sigtable *tab, size_t idx, enum sigexport_format format, char *out )
+{
+	struct sigview view;
+	const struct sigview *rec = sigtable_get(tab, idx, &view);
+	size_t n = 0;
+
+	if( rec == NULL )
+	{
+		if( format != SIGEXPORT_LINE ) return 0;
+		memcpy(out, CORRUPT_RECORD, sizeof(CORRUPT_RECORD) - 1);
+		return sizeof(CORRUPT_RECORD) - 1;
+	}
+
+	switch( format )
+	{
+	case SIGEXPORT_LINE:
+		return render_record(rec, out);
+
+	case SIGEXPORT_JSONL:
+		memcpy(out, "{\"index\":", 9);
+		n = 9 + export_number(idx, out + 9);
+		memcpy(out + n, ",\"signum\":", 10);
+		n += 10 + export_number(rec->signum, out + n + 10);
+		memcpy(out + n, ",\"name\":", 8);
+		n += 8 + export_string(rec->name, rec->name_len, false, out + n + 8);
+		memcpy(out + n, ",\"description\":", 15);
+		n += 15 + export_string(rec->desc, rec->desc_len, false, out + n + 15);
+		out[n++] = '}';
+		out[n++] = '\n';
+		return n;
+
+	case SIGEXPORT_CSV:
+		n = export_number(idx, out);
+		out[n++] = ',';
+		n += export_number(rec->signum, out + n);
+		out[n++] = ',';
+		n += export_string(rec->name, rec->name_len, true, out + n);
+		out[n++] = ',';
+		n += export_string(rec->desc, rec->desc_len, true, out + n);
+		out[n++] = '\r';
+		out[n++] = '\n';
+		return n;
+	}
+
+	errno = EINVAL;
+	return 0;
+}
+
+/** \brief Writes \p len bytes at \p data to \p fd, spliced into it if it is a \p pipe.
+
+    vmsplice() hands the pages over to the pipe instead of copying them, so the
+    bytes must never change afterwards. Only the rendered lines of a table are
+    written this way: they are not written again once rendered, and the pipe keeps
+    its pages even when the table is closed before they are read.
+*/
+static int export_span( int fd, const char *data, size_t len, bool pipe )
+{
+	while( len > 0 )
+	{
+		struct iovec iov;
+		ssize_t n;
+
+		iov.iov_base = (void *)data;
+		iov.iov_len = len;
+		n = pipe ? vmsplice(fd, &iov, 1, 0) : write(fd, data, len);
+		if( n < 0 && pipe && (errno == EINVAL || errno == ENOSYS) )
+		{
+			pipe = false;
+			continue;
+		}
+		if( n < 0 )
+		{
+			if( errno == EINTR ) continue;
+			return -1;
+		}
+		data += n;
+		len -= (size_t)n;
+	}
+	return 0;
+}
+
+/** \brief Writes the records from \p first up to \p end of \p tab to \p fd in \p format.
+
+    \p end is cut to the size of the table. SIGEXPORT_LINE writes every record as
+    the query for its index answers it. SIGEXPORT_JSONL writes one object per record
+    with its index, signum, name and description, and SIGEXPORT_CSV a header line
+    and one row per record with the same fields, ending lines with CRLF as RFC 4180 does.
+
+    Records are formatted straight into a large buffer and written in SIGEXPORT_BLOCK
+    pieces. The lines of a table rendered by sigtable_render() are already there and
+    are written as they are, without a copy, and spliced into a pipe, whose size is
+    raised to SIGEXPORT_BLOCK if allowed.
+
+    \returns 0 on success, -1 with errno set on error. errno is EINVAL for an unknown
+             format or a record that cannot be read in a format other than SIGEXPORT_LINE.
+*/
+int sigtable_export( const struct sigtable *tab, size_t first, size_t end, enum sigexport_format format, int fd )
+{
+	struct outbuf out;
+	struct stat st;
+	bool pipe;
+	int ret = 0;
+
+	if( format != SIGEXPORT_LINE && format != SIGEXPORT_JSONL && format != SIGEXPORT_CSV )
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	if( end > tab->size ) end = tab->size;
+	if( first > end ) first = end;
+
+	pipe = fstat(fd, &st) == 0 && S_ISFIFO(st.st_mode);
+	if( pipe ) fcntl(fd, F_SETPIPE_SZ, SIGEXPORT_BLOCK);
+
+	if( format == SIGEXPORT_LINE && tab->render.off )
+	{
+		const uint64_t *off = tab->render.off;
+		return export_span(fd, tab->render.lines + off[first], (size_t)(off[end] - off[first]), pipe);
+	}
+
+	if( outbuf_init(&out, fd, SIGEXPORT_BLOCK) != 0 ) return -1;
+	if( format == SIGEXPORT_CSV ) ret = outbuf_puts(&out, "index,signum,name,description\r\n");
+
+	for( ; first < end && ret == 0; first++ )
+	{
+		size_t n;
+
+		if( out.cap - out.used < SIGEXPORT_MAX && outbuf_flush(&out) != 0 ) ret = -1;
+		else if( (n = export_record(tab, first, format, out.data + out.used)) == 0 ) ret = -1;
+		else out.used += n;
+	}
+
+	if( ret == 0 && outbuf_flush(&out) != 0 ) ret = -1;
+	outbuf_free(&out);
+	return ret;
+}
+
+/** \brief Parses an index like sscanf("%zu") without going through stdio or the locale.
+
+    Leading whitespace and a sign are accepted, a minus sign negates modulo SIZE_MAX + 1
+    and too many digits saturate at SIZE_MAX, as strtoul() does.
+
+    \returns true if a number was found.
+*/
+static bool scan_index( const char *pos, const char *end, size_t *idx )
+{
+	size_t value = 0;
+	bool negative = false, overflow = false;
+	const char *digits;
+
+	pos = skip_space(pos, end);
+	if( pos < end && (*pos == '+' || *pos == '-') )
+	{
+		negative = *pos == '-';
+		pos++;
+	}
+
+	digits = pos;
+	while( pos < end && *pos >= '0' && *pos <= '9' )
+	{
+		size_t digit = (size_t)(*pos - '0');
+		if( value > (SIZE_MAX - digit) / 10 ) overflow = true;
+		value = value * 10 + digit;
+		pos++;
+	}
+
+	if( pos == digits ) return false;
+
+	*idx = overflow ? SIZE_MAX : negative ? (size_t)0 - value : value;
+	return true;
+}
+
+/** \brief Where answer_search() prints the matches. */
+struct search_out {
+	const struct sigtable *tab;
+	struct outbuf *out;
+};
+
+static int search_match( void *arg, size_t rec )
+{
+	struct search_out *ctx = (struct search_out *)arg;
+
+	return outbuf_index(ctx->out, ctx->tab, rec);
+}
+
+/** \brief Answers a text search, the input after its leading '/'. */
+static int answer_search( struct sigtable *tab, const char *input, size_t len, struct outbuf *out )
+{
+	struct search_out ctx;
+	ssize_t n;
+
+	/* a table paged within a memory budget only answers index queries */
+	if( tab->pager ) return outbuf_puts(out, "Invalid argument.\n");
+	if( sigtable_index_text(tab) != 0 ) return -1;
+
+	ctx.tab = tab;
+	ctx.out = out;
+	n = sigtable_search(tab, input, len, search_match, &ctx);
+	if( n < 0 ) return errno == EINVAL ? outbuf_puts(out, "Invalid argument.\n") : -1;
+	return n == 0 ? outbuf_puts(out, "No such signal.\n") : 0;
+}
+
+/* Parses the digits of a signal number query, values past USHRT_MAX stay past it */
+static const char *scan_signum( const char *pos, const char *end, unsigned long *value )
+{
+	const char *digits = pos;
+
+	*value = 0;
+	for( ; pos < end && *pos >= '0' && *pos <= '9'; pos++ )
+	{
+		if( *value <= USHRT_MAX ) *value = *value * 10 + (unsigned long)(*pos - '0');
+	}
+	return pos == digits ? NULL : pos;
+}
+
+/** \brief Answers a signal number query, the input after its leading '#'.
+
+    The input is a number N, a range A-B, or one of >=N, >N, <=N and <N. Matching
+    records are printed in signal number order.
+*/
+static int answer_signums( struct sigtable *tab, const char *input, size_t len, struct outbuf *out )
+{
+	const char *pos = input, *end = input + len;
+	unsigned long value, upper;
+	bool inclusive = true;
+	struct search_out ctx;
+	unsigned lo, hi;
+	char op = '\0';
+	ssize_t n;
+
+	while( end > pos && is_space(end[-1]) ) end--;
+	if( pos < end && (*pos == '<' || *pos == '>') )
+	{
+		op = *pos++;
+		inclusive = pos < end && *pos == '=';
+		if( inclusive ) pos++;
+	}
+
+	pos = scan_signum(pos, end, &value);
+	upper = value;
+	if( pos != NULL && op == '\0' && pos < end && *pos == '-' ) pos = scan_signum(pos + 1, end, &upper);
+	if( pos != end || upper < value || tab->pager ) return outbuf_puts(out, "Invalid argument.\n");
+	if( upper > USHRT_MAX ) return outbuf_puts(out, "Value out of range.\n");
+
+	if( op == '<' && !inclusive && value == 0 ) return outbuf_puts(out, "No such signal.\n");
+	lo = op == '<' ? 0 : (unsigned)value + (op == '>' && !inclusive);
+	hi = op == '>' ? USHRT_MAX : (unsigned)upper - (op == '<' && !inclusive);
+
+	if( sigtable_index_signums(tab) != 0 ) return -1;
+
+	ctx.tab = tab;
+	ctx.out = out;
+	n = sigtable_find_signums(tab, lo, hi, search_match, &ctx);
+	if( n < 0 ) return -1;
+	return n == 0 ? outbuf_puts(out, "No such signal.\n") : 0;
+}
+
+/* Text searches and signal number queries read on to the end of their line */
+static bool long_query( char first )
+{
+	return first == '/' || first == '#';
+}
+
+/** \brief Answers a query for the record at \p idx. */
+static int answer_index( const struct sigtable *tab, size_t idx, struct outbuf *out )
+{
+	if( idx < tab->size ) return outbuf_index(out, tab, idx);
+	return outbuf_puts(out, "Value out of range.\n");
+}
+
+/** \brief Answers one query as handed out by fgets() into a QUERY_MAX buffer.
+
+    A query is a record index, a signal name, a name prefix ending in '*', a text
+    search of the descriptions: '/' followed by words, or by a "quoted phrase", or a
+    signal number query: '#' followed by a number or a range, see answer_signums().
+
+    \returns 1 if the query asks to quit, 0 when answered, -1 with errno set on error.
+*/
+static int answer_one( struct sigtable *tab, const char *input, size_t len, struct outbuf *out )
+{
+	const uint32_t *recs = NULL;
+	size_t idx, n, k;
+	bool prefix;
+
+	/* the C string functions of the original loop stop at a NUL byte */
+	len = strnlen(input, len);
+
+	if( len == 2 && input[0] == 'q' && input[1] == '\n' ) return 1;
+
+	if( len > 0 && input[0] == '/' ) return answer_search(tab, input + 1, len - 1, out);
+	if( len > 0 && input[0] == '#' ) return answer_signums(tab, input + 1, len - 1, out);
+
+	if( scan_index(input, input + len, &idx) ) return answer_index(tab, idx, out);
+
+	/* Look up by name, a trailing '*' matches names starting with the input */
+	if( len > 0 && input[len - 1] == '\n' ) len--;
+	prefix = len > 0 && input[len - 1] == '*';
+	if( prefix ) len--;
+
+	if( (len == 0 && !prefix) || !valid_name(input, len) || tab->pager )
+	{
+		return outbuf_puts(out, "Invalid argument.\n");
+	}
+
+	if( sigtable_index_names(tab) != 0 ) return -1;
+
+	n = prefix ? sigtable_find_prefix(tab, input, len, &recs)
+		: sigtable_find_name(tab, input, len, &recs);
+	if( n == 0 ) return outbuf_puts(out, "No such signal.\n");
+
+	for( k = 0; k < n; k++ )
+	{
+		if( outbuf_index(out, tab, recs[k]) != 0 ) return -1;
+	}
+	return 0;
+}
+
+/* Counts a query of \p len bytes at \p input that took \p ns */
+static void sigstats_query( const char *input, size_t len, uint64_t ns )
+{
+	enum sigstats_query kind = SIGSTATS_QUERY_NAME;
+	size_t idx, bucket = 0;
+
+	len = strnlen(input, len);
+	if( len > 0 && input[0] == '/' ) kind = SIGSTATS_QUERY_SEARCH;
+	else if( len > 0 && input[0] == '#' ) kind = SIGSTATS_QUERY_SIGNUM;
+	else if( scan_index(input, input + len, &idx) ) kind = SIGSTATS_QUERY_INDEX;
+
+	if( ns >> 8 != 0 ) bucket = (size_t)(64 - __builtin_clzll(ns >> 8));
+	if( bucket >= SIGSTATS_BUCKETS ) bucket = SIGSTATS_BUCKETS - 1;
+
+	sigstats_add(&sigstats.queries[kind], 1);
+	sigstats_add(&sigstats.latency[bucket], 1);
+	sigstats_add(&sigstats.latency_sum_ns, ns);
+}
+
+/** \brief Answers one query with answer_one(), timing it if stats are enabled. */
+static int answer_query( struct sigtable *tab, const char *input, size_t len, struct outbuf *out )
+{
+	uint64_t start;
+	int ret;
+
+	if( !sigstats.enabled ) return answer_one(tab, input, len, out);
+
+	start = clock_ns(CLOCK_MONOTONIC);
+	ret = answer_one(tab, input, len, out);
+	if( ret == 0 ) sigstats_query(input, len, clock_ns(CLOCK_MONOTONIC) - start);
+	return ret;
+}
+
+/** \brief Answers queries read line by line from \p in until 'q' or end of input.
+
+    Every answer is written out before the next query is read.
+
+    \returns 0 on success, -1 with errno set on error.
+*/
+int run_interactive( struct sigtable *tab, FILE *in, int out_fd )
+{
+	char input[SEARCH_MAX];
+	struct sigstats_timer timer;
+	struct outbuf out;
+	int ret = 0;
+
+	if( outbuf_init(&out, out_fd, 4096) != 0 ) return -1;
+	sigstats_start(&timer);
+
+	while( ret == 0 && NULL != fgets(input, QUERY_MAX, in) )
+	{
+		size_t len = strlen(input);
+
+		while( long_query(input[0]) && input[len - 1] != '\n' && len < sizeof(input) - 1
+			&& NULL != fgets(input + len, (int)(sizeof(input) - len), in) )
+		{
+			len += strlen(input + len);
+		}
+
+		ret = answer_query(tab, input, len, &out);
+		if( outbuf_flush(&out) != 0 ) ret = -1;
+	}
+
+	sigstats_stop(&timer, SIGSTATS_QUERIES);
+	outbuf_free(&out);
+	return ret < 0 ? -1 : 0;
+}
+
+#define BATCH_BLOCK (1 << 20)
+
+/** \brief A query of run_batch(), \p len bytes at \p start of its buffer. */
+struct batch_query {
+	size_t start;
+	size_t len;
+};
+
+/** \brief Answers the \p n queries of \p group in order, stopping at the first that does not return 0.
+
+    The records of index queries are prefetched for the whole group first, see
+    sigtable_prefetch_addr(), so their cache misses overlap instead of following one another.
+    Their numbers are parsed for that once, and unless queries are timed for the stats
+    they are answered from it.
+*/
+static int answer_group( struct sigtable *tab, const char *buf, const struct batch_query *group, size_t n,
+	struct outbuf *out )
+{
+	size_t idx[SIGPREFETCH_MAX * 2], k;
+	bool indexed[SIGPREFETCH_MAX * 2];
+	int stage, ret = 0;
+
+	for( k = 0; k < n; k++ )
+	{
+		const char *input = buf + group[k].start;
+		size_t len = strnlen(input, group[k].len);
+
+		indexed[k] = sigprefetch_distance && len > 0 && !long_query(input[0]) && scan_index(input, input + len, &idx[k]);
+		if( !indexed[k] ) idx[k] = SIZE_MAX;
+	}
+	for( stage = 0; sigprefetch_distance && stage < 2; stage++ )
+	{
+		for( k = 0; k < n; k++ ) __builtin_prefetch(sigtable_prefetch_addr(tab, idx[k], stage));
+	}
+
+	for( k = 0; k < n && ret == 0; k++ )
+	{
+		ret = indexed[k] && !sigstats.enabled ? answer_index(tab, idx[k], out)
+			: answer_query(tab, buf + group[k].start, group[k].len, out);
+	}
+	return ret;
+}
+
+/** \brief Answers the queries read from \p in_fd in large blocks.
+
+    Input is cut into the same pieces fgets() would return for the interactive loop and
+    every answer is collected in a large output buffer, so the output is byte for byte
+    what run_interactive() writes, with a few large reads and writes. Queries are
+    answered in groups of twice sigprefetch_distance, see answer_group().
+
+    \returns 0 on success, -1 with errno set on error.
+*/
+int run_batch( struct sigtable *tab, int in_fd, int out_fd )
+{
+	struct sigstats_timer timer;
+	struct outbuf out;
+	struct batch_query group[SIGPREFETCH_MAX * 2];
+	char *buf;
+	size_t start = 0, end = 0, queued = 0;
+	size_t group_max = sigprefetch_distance == 0 ? 1
+		: sigprefetch_distance < SIGPREFETCH_MAX ? 2 * (size_t)sigprefetch_distance : 2 * SIGPREFETCH_MAX;
+	bool eof = false;
+	int ret = 0;
+
+	if( outbuf_init(&out, out_fd, BATCH_BLOCK) != 0 ) return -1;
+	buf = (char *) checked_malloc(BATCH_BLOCK, 1);
+	if( buf == NULL )
+	{
+		outbuf_free(&out);
+		return -1;
+	}
+
+	sigstats_start(&timer);
+	while( ret == 0 )
+	{
+		size_t avail = end - start;
+		size_t limit = avail > 0 && long_query(buf[start]) ? SEARCH_MAX - 1 : QUERY_MAX - 1;
+		size_t piece = avail < limit ? avail : limit;
+		const char *nl = (const char *)memchr(buf + start, '\n', piece);
+
+		if( nl )
+		{
+			piece = (size_t)(nl - (buf + start)) + 1;
+		}
+		else if( avail < limit && !eof )
+		{
+			ssize_t n;
+
+			/* the queued queries point into the part of buf that is moved */
+			ret = answer_group(tab, buf, group, queued, &out);
+			queued = 0;
+			if( ret != 0 ) break;
+
+			memmove(buf, buf + start, avail);
+			start = 0;
+			end = avail;
+			n = read(in_fd, buf + end, BATCH_BLOCK - end);
+			if( n < 0 )
+			{
+				if( errno != EINTR ) ret = -1;
+				continue;
+			}
+			end += (size_t)n;
+			eof = n == 0;
+			continue;
+		}
+
+		if( piece == 0 ) break;
+
+		group[queued].start = start;
+		group[queued].len = piece;
+		start += piece;
+		if( ++queued == group_max )
+		{
+			ret = answer_group(tab, buf, group, queued, &out);
+			queued = 0;
+		}
+	}
+	if( ret == 0 ) ret = answer_group(tab, buf, group, queued, &out);
+
+	if( outbuf_flush(&out) != 0 ) ret = -1;
+	sigstats_stop(&timer, SIGSTATS_QUERIES);
+
+	free(buf);
+	outbuf_free(&out);
+	return ret < 0 ? -1 : 0;
+}
+
+/** \brief Publishes \p tab, which must already have been indexed with sigtable_index().
+
+    Load tables published this way with sigtable_load(), so they do not depend on the
+    file staying as it was.
+*/
+int sigrcu_init( struct sigrcu *rcu, struct sigtable *tab )
+{
+	rcu->current = tab;
+	rcu->epoch = 1;
+	rcu->readers = NULL;
+	return pthread_mutex_init(&rcu->lock, NULL) == 0 ? 0 : -1;
+}
+
+/** \brief Closes the published table. No reader may be registered any more. */
+void sigrcu_destroy( struct sigrcu *rcu )
+{
+	sigtable_close(rcu->current);
+	rcu->current = NULL;
+	pthread_mutex_destroy(&rcu->lock);
+}
+
+/** \brief Adds a reader. Registration takes a lock, read sections do not. */
+void sigrcu_register( struct sigrcu *rcu, struct sigrcu_reader *reader )
+{
+	reader->active = 0;
+	pthread_mutex_lock(&rcu->lock);
+	reader->next = rcu->readers;
+	rcu->readers = reader;
+	pthread_mutex_unlock(&rcu->lock);
+}
+
+void sigrcu_unregister( struct sigrcu *rcu, struct sigrcu_reader *reader )
+{
+	struct sigrcu_reader **pos;
+
+	pthread_mutex_lock(&rcu->lock);
+	for( pos = &rcu->readers; *pos != NULL; pos = &(*pos)->next )
+	{
+		if( *pos == reader )
+		{
+			*pos = reader->next;
+			break;
+		}
+	}
+	pthread_mutex_unlock(&rcu->lock);
+}
+
+/** \brief Enters a read section and returns the table to use until sigrcu_read_unlock().
+
+    Announcing the epoch before loading the table pointer is what lets a writer tell
+    whether this reader may still hold the previous table.
+*/
+struct sigtable *sigrcu_read_lock( struct sigrcu *rcu, struct sigrcu_reader *reader )
+{
+	__atomic_store_n(&reader->active, __atomic_load_n(&rcu->epoch, __ATOMIC_SEQ_CST), __ATOMIC_SEQ_CST);
+	return __atomic_load_n(&rcu->current, __ATOMIC_SEQ_CST);
+}
+
+void sigrcu_read_unlock( struct sigrcu_reader *reader )
+{
+	__atomic_store_n(&reader->active, 0, __ATOMIC_RELEASE);
+}
+
+/** \brief Replaces the published table with \p tab and closes the old one.
+
+    Only the caller waits for readers of the old table to leave their read sections,
+    new read sections already see \p tab. Call this from a background thread.
+*/
+void sigrcu_publish( struct sigrcu *rcu, struct sigtable *tab )
+{
+	struct sigtable *old;
+	struct sigrcu_reader *reader;
+	uint64_t epoch;
+
+	pthread_mutex_lock(&rcu->lock);
+
+	old = __atomic_exchange_n(&rcu->current, tab, __ATOMIC_SEQ_CST);
+	epoch = __atomic_add_fetch(&rcu->epoch, 1, __ATOMIC_SEQ_CST);
+
+	for( reader = rcu->readers; reader != NULL; reader = reader->next )
+	{
+		for( ;; )
+		{
+			uint64_t active = __atomic_load_n(&reader->active, __ATOMIC_SEQ_CST);
+			if( active == 0 || active >= epoch ) break;
+			sched_yield();
+		}
+	}
+
+	pthread_mutex_unlock(&rcu->lock);
+
+	sigtable_close(old);
+}
+
+/** \brief Loads the data file again and publishes it, keeping the old table on error.
+
+    A journal that has grown past SIGJOURNAL_COMPACT_MIN is then folded into the file.
+*/
+static void sigwatch_reload( struct sigwatch *watch )
+{
+	struct sigsource source;
+	struct sigtable *tab = sigtable_map(watch->path_arg, true, 0, &source);
+
+	if( tab == NULL || sigtable_index(tab) != 0 )
+	{
+		fprintf(stderr, "Cannot reload %s, keeping the loaded database: %m\n", watch->path_arg);
+		sigtable_close(tab);
+		watch->failures++;
+		return;
+	}
+
+	sigrcu_publish(watch->rcu, tab);
+	watch->reloads++;
+
+	/* the table just published is written out, it stays open since only this thread
+	   replaces it; the rename then causes one more reload, which has nothing to fold */
+	if( source.journal_len >= SIGJOURNAL_COMPACT_MIN && sigjournal_fold(watch->path_arg, tab, &source) != 0 )
+	{
+		fprintf(stderr, "Cannot compact the journal of %s: %m\n", watch->path_arg);
+	}
+}
+
+/** \brief Whether \p name is the data file of \p watch, one of its shards or its journal. */
+static bool sigwatch_match( const struct sigwatch *watch, const char *name )
+{
+	size_t len = strlen(watch->name);
+
+	if( 0 == fnmatch(watch->name, name, FNM_PERIOD) ) return true;
+	return !is_pattern(watch->name) && 0 == strncmp(name, watch->name, len) && 0 == strcmp(name + len, SIGJOURNAL_SUFFIX);
+}
+
+static void *sigwatch_run( void *arg )
+{
+	struct sigwatch *watch = (struct sigwatch *)arg;
+	struct pollfd fds[2];
+	char events[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+
+	fds[0].fd = watch->inotify_fd;
+	fds[0].events = POLLIN;
+	fds[1].fd = watch->stop[0];
+	fds[1].events = POLLIN;
+
+	for( ;; )
+	{
+		bool changed = false;
+		ssize_t n;
+		char *pos;
+
+		if( poll(fds, 2, -1) < 0 )
+		{
+			if( errno == EINTR ) continue;
+			break;
+		}
+		if( fds[1].revents ) break;
+
+		n = read(watch->inotify_fd, events, sizeof(events));
+		if( n <= 0 ) continue;
+
+		/* several events for the file in one read cause one reload */
+		for( pos = events; pos < events + n; )
+		{
+			const struct inotify_event *ev = (const struct inotify_event *)pos;
+
+			if( ev->len > 0 && sigwatch_match(watch, ev->name) ) changed = true;
+			pos += sizeof(*ev) + ev->len;
+		}
+
+		if( changed ) sigwatch_reload(watch);
+	}
+
+	return NULL;
+}
+
+/** \brief Starts watching the data file of \p path_arg, resolved like datafile_open().
+
+    The directory is watched rather than the file, so editors that write a new file and
+    rename it over the old one are picked up too. For shards named by a pattern, a
+    change of any file the pattern matches in that directory reloads the table; the
+    shards a manifest lists are not watched, only the manifest. Appends to the journal
+    of a database file reload it too.
+
+    \returns 0 on success, -1 with errno set otherwise.
+*/
+int sigwatch_start( struct sigwatch *watch, struct sigrcu *rcu, const char *path_arg )
+{
+	char full_path[MAX_PATH];
+	char *slash;
+	int sret = handle_path_arg(sizeof(full_path), full_path, path_arg), err;
+
+	if( sret <= 0 || sret >= MAX_PATH || strlen(path_arg) >= sizeof(watch->path_arg) )
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	watch->rcu = rcu;
+	watch->reloads = watch->failures = 0;
+	strcpy(watch->path_arg, path_arg);
+
+	slash = strrchr(full_path, *OS_PATH_SEP);
+	strcpy(watch->name, slash ? slash + 1 : full_path);
+	if( slash == full_path ) slash[1] = '\0';
+	else if( slash ) *slash = '\0';
+	else strcpy(full_path, ".");
+
+	watch->inotify_fd = inotify_init1(IN_CLOEXEC | IN_NONBLOCK);
+	if( watch->inotify_fd < 0 ) return -1;
+
+	if( inotify_add_watch(watch->inotify_fd, full_path, IN_CLOSE_WRITE | IN_MOVED_TO) < 0 ) goto fail;
+	if( pipe(watch->stop) != 0 ) goto fail;
+
+	if( (err = pthread_create(&watch->thread, NULL, sigwatch_run, watch)) != 0 )
+	{
+		close(watch->stop[0]);
+		close(watch->stop[1]);
+		errno = err;
+		goto fail;
+	}
+	return 0;
+
+fail:
+	err = errno;
+	close(watch->inotify_fd);
+	errno = err;
+	return -1;
+}
+
+/** \brief Stops the watcher thread, waiting for a reload in progress. */
+void sigwatch_stop( struct sigwatch *watch )
+{
+	if( write(watch->stop[1], "", 1) == 1 ) pthread_join(watch->thread, NULL);
+	close(watch->stop[0]);
+	close(watch->stop[1]);
+	close(watch->inotify_fd);
+}
+
+/* Longest request line the server accepts */
+#define REQUEST_MAX 256
+/* Stop reading from a client while this much output waits for it */
+#define CONN_OUT_HIGH (1 << 20)
+
+/** \brief A client of run_server(). */
+struct conn {
+	int fd;
+	bool closing;
+	size_t in_len;
+	char in[REQUEST_MAX];
+	size_t sent;
+	struct outbuf out;
+};
+
+/** \brief Creates a listening Unix domain socket at \p path, replacing a stale socket.
+
+    \returns The socket or -1 with errno set on error.
+*/
+int server_listen( const char *path )
+{
+	struct sockaddr_un addr;
+	struct stat st;
+	int fd, err;
+
+	if( strlen(path) >= sizeof(addr.sun_path) )
+	{
+		errno = ENAMETOOLONG;
+		return -1;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	/* only ever remove a socket, never a regular file given by mistake */
+	if( lstat(path, &st) == 0 && S_ISSOCK(st.st_mode) ) unlink(path);
+
+	fd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+	if( fd < 0 ) return -1;
+
+	if( bind(fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 || listen(fd, SOMAXCONN) != 0 )
+	{
+		err = errno;
+		close(fd);
+		errno = err;
+		return -1;
+	}
+
+	return fd;
+}
+
+static void conn_close( int epfd, struct conn *conn )
+{
+	epoll_ctl(epfd, EPOLL_CTL_DEL, conn->fd, NULL);
+	close(conn->fd);
+	outbuf_free(&conn->out);
+	free(conn);
+}
+
+/** \brief The server thread as a reader of the published table. */
+struct server {
+	struct sigrcu *rcu;
+	struct sigrcu_reader reader;
+};
+
+/** \brief Answers every complete request line in the input buffer of \p conn.
+
+    Each answer is the output of the interactive loop followed by an empty line.
+    Every request is answered from the table published when it is taken up.
+*/
+static void conn_answer( struct server *srv, struct conn *conn )
+{
+	char *nl;
+
+	while( !conn->closing && conn->out.used < CONN_OUT_HIGH
+		&& NULL != (nl = (char *)memchr(conn->in, '\n', conn->in_len)) )
+	{
+		size_t len = (size_t)(nl - conn->in) + 1;
+		struct sigtable *tab = sigrcu_read_lock(srv->rcu, &srv->reader);
+		int ret = answer_query(tab, conn->in, len, &conn->out);
+
+		sigrcu_read_unlock(&srv->reader);
+
+		if( ret != 0 || outbuf_put(&conn->out, "\n", 1) != 0 ) conn->closing = true;
+
+		conn->in_len -= len;
+		memmove(conn->in, nl + 1, conn->in_len);
+	}
+
+	if( conn->in_len == sizeof(conn->in) && NULL == memchr(conn->in, '\n', conn->in_len) )
+	{
+		outbuf_puts(&conn->out, "Invalid argument.\n\n");
+		conn->closing = true;
+	}
+}
+
+/** \brief Reads, answers and writes for \p conn as far as the socket allows.
+
+    \returns false once the connection is finished.
+*/
+static bool conn_service( int epfd, struct server *srv, struct conn *conn )
+{
+	struct epoll_event ev;
+
+	for( ;; )
 	{
-		if ( 0 == strcmp( input, "q\n" ) )
+		while( !conn->closing && conn->out.used < CONN_OUT_HIGH && conn->in_len < sizeof(conn->in) )
 		{
-			break;
+			ssize_t n = read(conn->fd, conn->in + conn->in_len, sizeof(conn->in) - conn->in_len);
+
+			if( n > 0 )
+			{
+				conn->in_len += (size_t)n;
+				conn_answer(srv, conn);
+			}
+			else if( n == 0 )
+			{
+				conn->closing = true;
+			}
+			else if( errno == EAGAIN || errno == EWOULDBLOCK )
+			{
+				break;
+			}
+			else if( errno != EINTR )
+			{
+				return false;
+			}
+		}
+
+		while( conn->sent < conn->out.used )
+		{
+			ssize_t n = send(conn->fd, conn->out.data + conn->sent, conn->out.used - conn->sent, MSG_NOSIGNAL);
+
+			if( n < 0 )
+			{
+				if( errno == EAGAIN || errno == EWOULDBLOCK ) break;
+				if( errno != EINTR ) return false;
+				continue;
+			}
+			conn->sent += (size_t)n;
+		}
+
+		if( conn->sent < conn->out.used ) break;
+
+		conn->sent = conn->out.used = 0;
+		if( conn->closing ) return false;
+
+		/* requests held back by a full output buffer */
+		conn_answer(srv, conn);
+		if( conn->out.used == 0 ) break;
+	}
+
+	ev.events = (conn->closing || conn->out.used >= CONN_OUT_HIGH ? 0 : (uint32_t)EPOLLIN)
+		| (conn->sent < conn->out.used ? (uint32_t)EPOLLOUT : 0);
+	ev.data.ptr = conn;
+	return epoll_ctl(epfd, EPOLL_CTL_MOD, conn->fd, &ev) == 0;
+}
+
+static void server_accept( int epfd, int listen_fd )
+{
+	for( ;; )
+	{
+		struct epoll_event ev;
+		struct conn *conn;
+		int fd = accept4(listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+
+		if( fd < 0 ) return;
+
+		conn = (struct conn *) checked_malloc(1, sizeof(*conn));
+		if( conn == NULL || outbuf_init(&conn->out, -1, 4096) != 0 )
+		{
+			free(conn);
+			close(fd);
+			continue;
+		}
+		conn->fd = fd;
+		conn->closing = false;
+		conn->in_len = 0;
+		conn->sent = 0;
+
+		ev.events = EPOLLIN;
+		ev.data.ptr = conn;
+		if( epoll_ctl(epfd, EPOLL_CTL_ADD, fd, &ev) != 0 )
+		{
+			outbuf_free(&conn->out);
+			free(conn);
+			close(fd);
+		}
+	}
+}
+
+/** \brief Answers queries from any number of clients of \p listen_fd until \p stop_fd is readable.
+
+    A single epoll loop serves all clients. Each request is one line, answered like the
+    interactive loop would answer it and terminated by an empty line. A "q" request
+    closes the connection. Tables published to \p rcu must have their name index built.
+
+    \returns 0 on success, -1 with errno set on error.
+*/
+int run_server( struct sigrcu *rcu, int listen_fd, int stop_fd )
+{
+	static char listen_tag, stop_tag;
+	struct epoll_event ev, events[64];
+	struct sigstats_timer timer;
+	struct server srv;
+	int epfd, n, i, ret = -1, err;
+	bool stop = false;
+
+	epfd = epoll_create1(EPOLL_CLOEXEC);
+	if( epfd < 0 ) return -1;
+
+	srv.rcu = rcu;
+	sigrcu_register(rcu, &srv.reader);
+
+	ev.events = EPOLLIN;
+	ev.data.ptr = &listen_tag;
+	if( epoll_ctl(epfd, EPOLL_CTL_ADD, listen_fd, &ev) != 0 ) goto done;
+	ev.data.ptr = &stop_tag;
+	if( epoll_ctl(epfd, EPOLL_CTL_ADD, stop_fd, &ev) != 0 ) goto done;
+
+	sigstats_start(&timer);
+	while( !stop )
+	{
+		n = epoll_wait(epfd, events, sizeof(events) / sizeof(events[0]), -1);
+		if( n < 0 )
+		{
+			if( errno == EINTR ) continue;
+			goto done;
 		}
 
-		if( 1 == sscanf(input, "%zu", &idx) )
+		for( i = 0; i < n; i++ )
 		{
-			if (idx < size)
+			if( events[i].data.ptr == &stop_tag )
+			{
+				stop = true;
+			}
+			else if( events[i].data.ptr == &listen_tag )
 			{
-				printf("%d %s %s\n", sigdb[idx].signum, sigdb[idx].signame, sigdb[idx].sigdesc);
+				server_accept(epfd, listen_fd);
 			}
 			else
 			{
-				printf("Value out of range.\n");
+				struct conn *conn = (struct conn *)events[i].data.ptr;
+				if( !conn_service(epfd, &srv, conn) ) conn_close(epfd, conn);
 			}
 		}
+	}
+	sigstats_stop(&timer, SIGSTATS_QUERIES);
+	ret = 0;
+
+done:
+	/* connections still open are dropped with the process */
+	err = errno;
+	sigrcu_unregister(rcu, &srv.reader);
+	close(epfd);
+	errno = err;
+	return ret;
+}
+
+static const char *const sigstats_phase_names[SIGSTATS_PHASES] = { "open", "parse", "index", "queries" };
+static const char *const sigstats_query_names[SIGSTATS_QUERY_KINDS] = { "index", "name", "search", "signum" };
+
+/** \brief Copies the counters of sigstats to \p out, each read atomically. */
+void sigstats_snapshot( struct sigstats *out )
+{
+	size_t i;
+
+	out->enabled = sigstats.enabled;
+	for( i = 0; i < SIGSTATS_PHASES; i++ )
+	{
+		out->wall_ns[i] = __atomic_load_n(&sigstats.wall_ns[i], __ATOMIC_RELAXED);
+		out->cpu_ns[i] = __atomic_load_n(&sigstats.cpu_ns[i], __ATOMIC_RELAXED);
+	}
+	out->bytes_read = __atomic_load_n(&sigstats.bytes_read, __ATOMIC_RELAXED);
+	out->records_parsed = __atomic_load_n(&sigstats.records_parsed, __ATOMIC_RELAXED);
+	out->records_rejected = __atomic_load_n(&sigstats.records_rejected, __ATOMIC_RELAXED);
+	for( i = 0; i < SIGSTATS_QUERY_KINDS; i++ )
+	{
+		out->queries[i] = __atomic_load_n(&sigstats.queries[i], __ATOMIC_RELAXED);
+	}
+	for( i = 0; i < SIGSTATS_BUCKETS; i++ )
+	{
+		out->latency[i] = __atomic_load_n(&sigstats.latency[i], __ATOMIC_RELAXED);
+	}
+	out->latency_sum_ns = __atomic_load_n(&sigstats.latency_sum_ns, __ATOMIC_RELAXED);
+}
+
+/** \brief Writes \p st as a JSON object.
+
+    \returns 0 on success, -1 with errno set on error.
+*/
+int sigstats_json( const struct sigstats *st, FILE *out )
+{
+	uint64_t total = 0;
+	size_t i;
+
+	fprintf(out, "{\n  \"phases\": {");
+	for( i = 0; i < SIGSTATS_PHASES; i++ )
+	{
+		fprintf(out, "%s\n    \"%s\": { \"wall_ns\": %llu, \"cpu_ns\": %llu }", i ? "," : "",
+			sigstats_phase_names[i], (unsigned long long)st->wall_ns[i], (unsigned long long)st->cpu_ns[i]);
+	}
+	fprintf(out, "\n  },\n  \"bytes_read\": %llu,\n  \"records_parsed\": %llu,\n  \"records_rejected\": %llu,\n"
+		"  \"queries\": {", (unsigned long long)st->bytes_read, (unsigned long long)st->records_parsed,
+		(unsigned long long)st->records_rejected);
+	for( i = 0; i < SIGSTATS_QUERY_KINDS; i++ )
+	{
+		fprintf(out, "%s \"%s\": %llu", i ? "," : "", sigstats_query_names[i], (unsigned long long)st->queries[i]);
+		total += st->queries[i];
+	}
+	fprintf(out, " },\n  \"latency\": {\n    \"count\": %llu,\n    \"sum_ns\": %llu,\n    \"buckets\": [",
+		(unsigned long long)total, (unsigned long long)st->latency_sum_ns);
+	for( i = 0; i < SIGSTATS_BUCKETS; i++ )
+	{
+		if( i + 1 < SIGSTATS_BUCKETS )
+		{
+			fprintf(out, "%s\n      { \"lt_ns\": %llu, \"count\": %llu }", i ? "," : "",
+				1ULL << (i + 8), (unsigned long long)st->latency[i]);
+		}
 		else
 		{
-			printf("Invalid argument.\n");
+			fprintf(out, ",\n      { \"lt_ns\": null, \"count\": %llu }", (unsigned long long)st->latency[i]);
+		}
+	}
+	fprintf(out, "\n    ]\n  }\n}\n");
+	return ferror(out) ? -1 : 0;
+}
+
+/** \brief Writes \p st in the Prometheus text exposition format.
+
+    \returns 0 on success, -1 with errno set on error.
+*/
+int sigstats_prometheus( const struct sigstats *st, FILE *out )
+{
+	uint64_t total = 0;
+	size_t i;
+
+	fprintf(out, "# HELP intexer_phase_seconds Wall clock time spent in each phase.\n"
+		"# TYPE intexer_phase_seconds counter\n");
+	for( i = 0; i < SIGSTATS_PHASES; i++ )
+	{
+		fprintf(out, "intexer_phase_seconds{phase=\"%s\"} %.9f\n", sigstats_phase_names[i], (double)st->wall_ns[i] / 1e9);
+	}
+	fprintf(out, "# HELP intexer_phase_cpu_seconds Process CPU time spent in each phase.\n"
+		"# TYPE intexer_phase_cpu_seconds counter\n");
+	for( i = 0; i < SIGSTATS_PHASES; i++ )
+	{
+		fprintf(out, "intexer_phase_cpu_seconds{phase=\"%s\"} %.9f\n", sigstats_phase_names[i], (double)st->cpu_ns[i] / 1e9);
+	}
+	fprintf(out, "# HELP intexer_bytes_read_total Bytes of databases read.\n"
+		"# TYPE intexer_bytes_read_total counter\nintexer_bytes_read_total %llu\n"
+		"# HELP intexer_records_parsed_total Records parsed from databases.\n"
+		"# TYPE intexer_records_parsed_total counter\nintexer_records_parsed_total %llu\n"
+		"# HELP intexer_records_rejected_total Records that failed to parse.\n"
+		"# TYPE intexer_records_rejected_total counter\nintexer_records_rejected_total %llu\n"
+		"# HELP intexer_queries_total Queries answered by kind.\n"
+		"# TYPE intexer_queries_total counter\n",
+		(unsigned long long)st->bytes_read, (unsigned long long)st->records_parsed,
+		(unsigned long long)st->records_rejected);
+	for( i = 0; i < SIGSTATS_QUERY_KINDS; i++ )
+	{
+		fprintf(out, "intexer_queries_total{kind=\"%s\"} %llu\n", sigstats_query_names[i], (unsigned long long)st->queries[i]);
+	}
+
+	fprintf(out, "# HELP intexer_query_duration_seconds Time to answer a query.\n"
+		"# TYPE intexer_query_duration_seconds histogram\n");
+	for( i = 0; i < SIGSTATS_BUCKETS; i++ )
+	{
+		total += st->latency[i];
+		if( i + 1 < SIGSTATS_BUCKETS )
+		{
+			fprintf(out, "intexer_query_duration_seconds_bucket{le=\"%.9f\"} %llu\n",
+				(double)(1ULL << (i + 8)) / 1e9, (unsigned long long)total);
 		}
 	}
+	fprintf(out, "intexer_query_duration_seconds_bucket{le=\"+Inf\"} %llu\n"
+		"intexer_query_duration_seconds_sum %.9f\nintexer_query_duration_seconds_count %llu\n",
+		(unsigned long long)total, (double)st->latency_sum_ns / 1e9, (unsigned long long)total);
+	return ferror(out) ? -1 : 0;
+}
+
+/** \brief Writes the Prometheus text of sigstats to every client of \p listen_fd, until
+    \p stop_fd is readable.
+
+    Each client gets one dump and is disconnected, which is how a scraper that speaks
+    to a Unix socket, or socat, reads it.
+
+    \returns 0 on success, -1 with errno set on error.
+*/
+int run_metrics( int listen_fd, int stop_fd )
+{
+	struct pollfd fds[2];
+
+	fds[0].fd = listen_fd;
+	fds[1].fd = stop_fd;
+	fds[0].events = fds[1].events = POLLIN;
+
+	for( ;; )
+	{
+		struct sigstats st;
+		char *text = NULL;
+		size_t len = 0;
+		FILE *mem;
+		int fd;
+
+		if( poll(fds, 2, -1) < 0 )
+		{
+			if( errno == EINTR ) continue;
+			return -1;
+		}
+		if( fds[1].revents != 0 ) return 0;
+
+		fd = accept4(listen_fd, NULL, NULL, SOCK_CLOEXEC);
+		if( fd < 0 ) continue;
+
+		sigstats_snapshot(&st);
+		mem = open_memstream(&text, &len);
+		if( mem != NULL )
+		{
+			bool ok = sigstats_prometheus(&st, mem) == 0;
+			size_t done = 0;
+
+			if( fclose(mem) != 0 || !ok ) done = len;
+			while( done < len )
+			{
+				ssize_t n = send(fd, text + done, len - done, MSG_NOSIGNAL);
+				if( n < 0 && errno == EINTR ) continue;
+				if( n <= 0 ) break;
+				done += (size_t)n;
+			}
+		}
+		free(text);
+		close(fd);
+	}
+}
+
+#ifndef TEST
+static void usage(const char *prog)
+{
+	printf("Usage: %s [--batch] [--mem-report] [--stats] [--budget size[K|M|G]] [--hugepages off|thp|hugetlb]\n"
+		"       [--compress] [--render] [--io map|auto|uring|pread] [--prefetch distance] [--serve socket] data_base\n"
+		"       %s --update|--compact data_base\n"
+		"       %s --export line|jsonl|csv [--range first[-last]] [--budget size[K|M|G]] [--render] data_base\n"
+		"data_base may be a quoted pattern or a manifest of shards, DATA_PATH a list of directories\n"
+		"--update appends the changes read from stdin to the journal of data_base as one batch,\n"
+		"\"+ signum name description\" to add or replace and \"- signum\" to remove a signal\n"
+		"--prefetch sets how many index queries ahead --batch fetches records, 0 for none\n"
+		"--export writes the records with indexes first to last, all by default, to stdout\n", prog, prog, prog);
+}
+
+/** \brief Reads changes from \p in and appends them to the journal of \p db_arg in one batch. */
+static int run_update(const char *db_arg, FILE *in)
+{
+	struct sigchange *changes = NULL;
+	size_t n = 0, cap = 0, lineno = 0;
+	char line[SEARCH_MAX];
+	int ret = -1;
+
+	while (fgets(line, sizeof(line), in)) {
+		size_t len = strcspn(line, "\r\n");
+
+		lineno++;
+		if (len == 0) continue;
+		if (n == cap) {
+			struct sigchange *grown;
+			cap = cap ? cap * 2 : 64;
+			grown = (struct sigchange *) realloc(changes, cap * sizeof(changes[0]));
+			if (grown == NULL) goto done;
+			changes = grown;
+		}
+		if (sigchange_parse(line, len, &changes[n]) != 0) {
+			fprintf(stderr, "Invalid change on line %zu\n", lineno);
+			goto done;
+		}
+		n++;
+	}
+	if (ferror(in) || sigjournal_append(db_arg, changes, n) != 0) {
+		fprintf(stderr, "Cannot update %s: %m\n", db_arg);
+		goto done;
+	}
+	ret = 0;
+
+done:
+	free(changes);
+	return ret;
+}
+
+/** \brief Parses the region flags named by \p arg into \p flags, -1 on error. */
+static int parse_hugepages(const char *arg, unsigned *flags)
+{
+	if (0 == strcmp(arg, "off")) *flags = 0;
+	else if (0 == strcmp(arg, "thp")) *flags = SIGREGION_THP;
+	else if (0 == strcmp(arg, "hugetlb")) *flags = SIGREGION_HUGETLB;
+	else return -1;
+	return 0;
+}
+
+/** \brief Parses the prefetch distance \p arg into \p distance, -1 on error. */
+static int parse_prefetch(const char *arg, unsigned *distance)
+{
+	char *end;
+	unsigned long value;
+
+	errno = 0;
+	value = strtoul(arg, &end, 10);
+	if (end == arg || *end != '\0' || errno != 0 || value > SIGPREFETCH_MAX || arg[0] == '-') return -1;
+	*distance = (unsigned)value;
+	return 0;
+}
+
+/** \brief Parses the export format \p arg into \p format, -1 on error. */
+static int parse_export(const char *arg, enum sigexport_format *format)
+{
+	if (0 == strcmp(arg, "line")) *format = SIGEXPORT_LINE;
+	else if (0 == strcmp(arg, "jsonl")) *format = SIGEXPORT_JSONL;
+	else if (0 == strcmp(arg, "csv")) *format = SIGEXPORT_CSV;
+	else return -1;
+	return 0;
+}
+
+/** \brief Parses "first", "first-last" or "first-" into the records from \p first up to \p end, -1 on error. */
+static int parse_range(const char *arg, size_t *first, size_t *end)
+{
+	char *pos;
+	unsigned long long lo, hi;
 
-	free(sigdb);
+	if (!isdigit((unsigned char)arg[0])) return -1;
+	errno = 0;
+	lo = strtoull(arg, &pos, 10);
+	hi = lo;
+	if (*pos == '-' && pos[1] == '\0') {
+		hi = SIZE_MAX - 1;
+		pos++;
+	} else if (*pos == '-' && isdigit((unsigned char)pos[1])) {
+		hi = strtoull(pos + 1, &pos, 10);
+	}
+	if (*pos != '\0' || errno != 0 || hi < lo || hi >= SIZE_MAX) return -1;
+	*first = (size_t)lo;
+	*end = (size_t)hi + 1;
+	return 0;
+}
 
-close_files:
-	fclose(in);
+/** \brief Parses how to load the database, -1 on error. \p read is false for "map". */
+static int parse_io(const char *arg, bool *read)
+{
+	*read = true;
+	if (0 == strcmp(arg, "map")) *read = false;
+	else if (0 == strcmp(arg, "auto")) sigio_backend = SIGIO_AUTO;
+	else if (0 == strcmp(arg, "uring")) sigio_backend = SIGIO_URING;
+	else if (0 == strcmp(arg, "pread")) sigio_backend = SIGIO_PREAD;
+	else return -1;
 	return 0;
 }
+
+/** \brief Parses a byte count with an optional K, M or G suffix, 0 on error. */
+static size_t parse_budget(const char *arg)
+{
+	char *end;
+	unsigned long long value = strtoull(arg, &end, 10);
+	unsigned shift = 0;
+
+	if (end == arg || arg[0] == '-') return 0;
+	switch (*end) {
+	case 'K': case 'k': shift = 10; end++; break;
+	case 'M': case 'm': shift = 20; end++; break;
+	case 'G': case 'g': shift = 30; end++; break;
+	default: break;
+	}
+	if (*end != '\0' || value > (SIZE_MAX >> shift)) return 0;
+	return (size_t)value << shift;
+}
+
+static int stop_pipe[2] = { -1, -1 };
+
+static void stop_handler(int sig)
+{
+	int err = errno;
+	(void)sig;
+	if (write(stop_pipe[1], "", 1) < 0) { /* already stopping */ }
+	errno = err;
+}
+
+static void dump_stats(void)
+{
+	struct sigstats st;
+
+	sigstats_snapshot(&st);
+	sigstats_json(&st, stderr);
+}
+
+static void *metrics_thread(void *arg)
+{
+	if (run_metrics(*(int *)arg, stop_pipe[0]) != 0) {
+		fprintf(stderr, "Metrics server failed: %m\n");
+	}
+	return NULL;
+}
+
+/** \brief Serves \p tab on the socket at \p path until SIGINT or SIGTERM.
+
+    Changes to the data file of \p db_arg are loaded in the background and replace
+    \p tab without interrupting the server. With stats enabled, the socket at \p path
+    with ".metrics" appended serves them as Prometheus text.
+*/
+static int serve(struct sigtable *tab, const char *db_arg, const char *path)
+{
+	char metrics_path[MAX_PATH];
+	struct sigaction sa;
+	struct sigrcu rcu;
+	struct sigwatch watch;
+	pthread_t metrics;
+	bool watching, exporting = false;
+	int listen_fd, metrics_fd = -1, ret;
+
+	if (sigtable_index(tab) != 0) {
+		fprintf(stderr, "Cannot index the database: %m\n");
+		sigtable_close(tab);
+		return -1;
+	}
+
+	if (pipe(stop_pipe) != 0 || (listen_fd = server_listen(path)) < 0) {
+		fprintf(stderr, "Cannot listen on %s: %m\n", path);
+		sigtable_close(tab);
+		return -1;
+	}
+
+	memset(&sa, 0, sizeof(sa));
+	sa.sa_handler = stop_handler;
+	sigaction(SIGINT, &sa, NULL);
+	sigaction(SIGTERM, &sa, NULL);
+
+	if (sigstats.enabled) {
+		ret = snprintf(metrics_path, sizeof(metrics_path), "%s.metrics", path);
+		if (ret > 0 && ret < (int)sizeof(metrics_path)) metrics_fd = server_listen(metrics_path);
+		exporting = metrics_fd >= 0 && pthread_create(&metrics, NULL, metrics_thread, &metrics_fd) == 0;
+		if (!exporting) {
+			fprintf(stderr, "Cannot serve metrics on %s.metrics: %m\n", path);
+		}
+	}
+
+	sigrcu_init(&rcu, tab);
+	watching = sigwatch_start(&watch, &rcu, db_arg) == 0;
+	if (!watching) {
+		fprintf(stderr, "Cannot watch %s, changes will not be loaded: %m\n", db_arg);
+	}
+
+	ret = run_server(&rcu, listen_fd, stop_pipe[0]);
+	if (ret != 0) {
+		fprintf(stderr, "Server failed: %m\n");
+	}
+
+	if (watching) sigwatch_stop(&watch);
+	if (exporting) {
+		pthread_join(metrics, NULL);
+		unlink(metrics_path);
+	}
+	if (metrics_fd >= 0) close(metrics_fd);
+	sigrcu_destroy(&rcu);
+	close(listen_fd);
+	unlink(path);
+	return ret;
+}
+
+int main(int argc, char* argv[]) {
+	const char *db_arg = NULL, *socket_path = NULL;
+	bool mem_report = false, batch = false, stats = false, read = false, update = false, compact = false;
+	bool exporting = false, range = false;
+	enum sigexport_format format = SIGEXPORT_LINE;
+	struct sigtable *tab;
+	size_t budget = 0, first = 0, end = SIZE_MAX;
+	int i, ret;
+
+	for (i = 1; i < argc; i++) {
+		if (0 == strcmp(argv[i], "--mem-report")) {
+			mem_report = true;
+		} else if (0 == strcmp(argv[i], "--batch")) {
+			batch = true;
+		} else if (0 == strcmp(argv[i], "--stats")) {
+			stats = true;
+		} else if (0 == strcmp(argv[i], "--update")) {
+			update = true;
+		} else if (0 == strcmp(argv[i], "--compact")) {
+			compact = true;
+		} else if (0 == strcmp(argv[i], "--compress")) {
+			/* applies to every table loaded from here on, reloads included */
+			sigpack_on_load = true;
+		} else if (0 == strcmp(argv[i], "--render")) {
+			/* answers are copied from lines rendered at load time */
+			sigrender_on_load = true;
+		} else if (0 == strcmp(argv[i], "--serve") && i + 1 < argc) {
+			socket_path = argv[++i];
+		} else if (0 == strcmp(argv[i], "--budget") && i + 1 < argc
+			&& (budget = parse_budget(argv[++i])) != 0) {
+			/* records are read on demand within budget bytes */
+		} else if (0 == strcmp(argv[i], "--hugepages") && i + 1 < argc
+			&& parse_hugepages(argv[++i], &sigregion_flags) == 0) {
+			/* applies to every table loaded from here on, reloads included */
+		} else if (0 == strcmp(argv[i], "--io") && i + 1 < argc
+			&& parse_io(argv[++i], &read) == 0) {
+			/* reads the file instead of mapping it, a server always does */
+		} else if (0 == strcmp(argv[i], "--export") && i + 1 < argc
+			&& parse_export(argv[++i], &format) == 0) {
+			exporting = true;
+		} else if (0 == strcmp(argv[i], "--range") && i + 1 < argc
+			&& parse_range(argv[++i], &first, &end) == 0) {
+			range = true;
+		} else if (0 == strcmp(argv[i], "--prefetch") && i + 1 < argc
+			&& parse_prefetch(argv[++i], &sigprefetch_distance) == 0) {
+			/* index queries of a batch are answered in groups of twice this many */
+		} else if (db_arg == NULL && argv[i][0] != '-') {
+			db_arg = argv[i];
+		} else {
+			db_arg = NULL;
+			break;
+		}
+	}
+
+	/* a server needs the name and text indexes a bounded table cannot have, nor can it be packed, rendered or read whole */
+	if (db_arg == NULL || (budget && (socket_path || sigpack_on_load || sigrender_on_load || read))) {
+		usage(argv[0]);
+		return 0;
+	}
+	/* an export writes the records and exits, a range selects the records to export */
+	if ((exporting && (socket_path || batch || mem_report || update || compact)) || (range && !exporting)) {
+		usage(argv[0]);
+		return 0;
+	}
+
+	/* changes go to the journal, the database is not loaded for them */
+	if (update) {
+		return run_update(db_arg, stdin) != 0;
+	}
+	if (compact) {
+		if (sigjournal_compact(db_arg) != 0) {
+			fprintf(stderr, "Cannot compact %s: %m\n", db_arg);
+			return 1;
+		}
+		return 0;
+	}
+
+	/* --stats reports on stderr however the program ends, stdout has the answers */
+	if (stats) {
+		sigstats.enabled = true;
+		atexit(dump_stats);
+	}
+
+	/* a server must not depend on the file, it is reloaded when rewritten */
+	tab = socket_path || read ? sigtable_load(db_arg)
+		: budget ? sigtable_open_bounded(db_arg, budget) : sigtable_open(db_arg);
+	if (tab == NULL) {
+		printf("Cannot open input file: %m\n");
+		return 1;
+	}
+
+	if (mem_report) {
+		if (!budget && sigtable_index(tab) != 0) {
+			fprintf(stderr, "Cannot index the database: %m\n");
+		}
+		sigtable_mem_report(tab, stdout);
+		sigtable_close(tab);
+		return 0;
+	}
+
+	if (exporting) {
+		ret = sigtable_export(tab, first, end, format, STDOUT_FILENO);
+		if (ret != 0) {
+			fprintf(stderr, "Cannot export the database: %m\n");
+		}
+		sigtable_close(tab);
+		return ret != 0;
+	}
+
+	if (socket_path) {
+		/* the server owns the table from here on */
+		return serve(tab, db_arg, socket_path) != 0;
+	}
+
+	/* Loop until 'q' and print out signal information */
+	ret = batch ? run_batch(tab, STDIN_FILENO, STDOUT_FILENO)
+		: run_interactive(tab, stdin, STDOUT_FILENO);
+	if (ret != 0) {
+		fprintf(stderr, "Cannot answer queries: %m\n");
+	}
+	if (budget && tab->pager) sigpager_report(tab->pager, stderr);
+
+	sigtable_close(tab);
+	return ret != 0;
+}
 #endif
@@ -0,0 +1,169 @@
+/** \file Header and library for clients of an intexer server (intexer --serve socket)
+
+    A request is one query line. The server answers it with the lines the interactive
+    intexer would print, followed by an empty line.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/types.h>
+#include <sys/un.h>
+
+/** \file intexer-client.h */
+
+#ifndef INTEXER_CLIENT_H
+#define INTEXER_CLIENT_H
+
+struct intexer_client {
+	int fd;
+	size_t used;
+	char buf[4096];
+};
+
+struct intexer_client *intexer_client_open( const char *path );
+ssize_t intexer_client_query( struct intexer_client *cl, const char *query, char *resp, size_t size );
+void intexer_client_close( struct intexer_client *cl );
+
+#endif /* end file intexer-client.h */
+
+/** \brief Connects to the server listening at \p path.
+
+    \returns A client the user must release with intexer_client_close() upon successful
+             completion. Otherwise, NULL is returned and errno is set to indicate the error.
+*/
+struct intexer_client *intexer_client_open( const char *path )
+{
+	struct sockaddr_un addr;
+	struct intexer_client *cl;
+	int err;
+
+	if( strlen(path) >= sizeof(addr.sun_path) )
+	{
+		errno = ENAMETOOLONG;
+		return NULL;
+	}
+
+	memset(&addr, 0, sizeof(addr));
+	addr.sun_family = AF_UNIX;
+	strcpy(addr.sun_path, path);
+
+	cl = (struct intexer_client *) malloc(sizeof(*cl));
+	if( cl == NULL ) return NULL;
+	cl->used = 0;
+
+	cl->fd = socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	if( cl->fd < 0 )
+	{
+		free(cl);
+		return NULL;
+	}
+
+	if( connect(cl->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0 )
+	{
+		err = errno;
+		close(cl->fd);
+		free(cl);
+		errno = err;
+		return NULL;
+	}
+
+	return cl;
+}
+
+static int send_all( int fd, const char *data, size_t len )
+{
+	while( len > 0 )
+	{
+		ssize_t n = send(fd, data, len, MSG_NOSIGNAL);
+		if( n < 0 )
+		{
+			if( errno == EINTR ) continue;
+			return -1;
+		}
+		data += n;
+		len -= (size_t)n;
+	}
+	return 0;
+}
+
+/** \brief Sends \p query and waits for the answer.
+
+    \p query must not contain a newline. The answer lines, without the terminating empty
+    line, are copied to \p resp and NUL terminated.
+
+    \returns The length of the answer or -1 with errno set on error. errno is ENOBUFS if
+             the answer did not fit into \p size bytes; the connection stays usable.
+*/
+ssize_t intexer_client_query( struct intexer_client *cl, const char *query, char *resp, size_t size )
+{
+	size_t len = strlen(query), total = 0;
+	bool overflow = false;
+	char prev = '\0';
+
+	if( size == 0 || memchr(query, '\n', len) != NULL )
+	{
+		errno = EINVAL;
+		return -1;
+	}
+
+	if( send_all(cl->fd, query, len) != 0 || send_all(cl->fd, "\n", 1) != 0 ) return -1;
+
+	for( ;; )
+	{
+		size_t i;
+		ssize_t n;
+
+		/* the answer ends at the first empty line, answer lines are never empty */
+		for( i = 0; i < cl->used; i++ )
+		{
+			if( cl->buf[i] == '\n' && prev == '\n' )
+			{
+				cl->used -= i + 1;
+				memmove(cl->buf, cl->buf + i + 1, cl->used);
+				resp[total] = '\0';
+				if( overflow )
+				{
+					errno = ENOBUFS;
+					return -1;
+				}
+				return (ssize_t)total;
+			}
+
+			if( total < size - 1 )
+			{
+				resp[total++] = cl->buf[i];
+			}
+			else
+			{
+				overflow = true;
+			}
+			prev = cl->buf[i];
+		}
+		cl->used = 0;
+
+		n = recv(cl->fd, cl->buf, sizeof(cl->buf), 0);
+		if( n < 0 && errno == EINTR ) continue;
+		if( n <= 0 )
+		{
+			if( n == 0 ) errno = ECONNRESET;
+			return -1;
+		}
+		cl->used = (size_t)n;
+	}
+}
+
+/** \brief Says goodbye to the server and releases \p cl. */
+void intexer_client_close( struct intexer_client *cl )
+{
+	if( cl )
+	{
+		send_all(cl->fd, "q\n", 2);
+		close(cl->fd);
+		free(cl);
+	}
+}
@@ -0,0 +1,123 @@
+/** \file Compiles a text signal database into a binary image that intexer opens without parsing.
+
+    Usage: intexer-compile data_base image
+           intexer-compile --verify image
+           intexer-compile --header data_base header
+
+    The data base and a verified image are resolved against DATA_PATH like intexer does,
+    the output image path is used as is. --header writes a C++ header instead, which
+    intexer-embedded.cpp builds into the program.
+*/
+
+/* Use the intexer library without its main() */
+#define TEST
+#include "better-intexer.c"
+
+static int verify_image( const char *path )
+{
+	struct sigtable *tab = sigtable_open(path);
+
+	if( tab == NULL || !tab->image || sigimage_verify(tab) != 0 )
+	{
+		fprintf(stderr, "%s: not a valid image\n", path);
+		sigtable_close(tab);
+		return 1;
+	}
+
+	printf("%s: %zu records, checksums ok\n", path, tab->size);
+	sigtable_close(tab);
+	return 0;
+}
+
+static int write_header( const char *db, const char *path, const char *tmp_path )
+{
+	struct sigtable *tab = sigtable_open(db);
+	FILE *out;
+
+	if (tab == NULL) {
+		fprintf(stderr, "Cannot open input file: %m\n");
+		return 1;
+	}
+
+	if ((out = fopen(tmp_path, "w")) == NULL) {
+		fprintf(stderr, "Cannot create %s: %m\n", tmp_path);
+		sigtable_close(tab);
+		return 1;
+	}
+
+	if (sigembed_write(tab, db, out) != 0 || fflush(out) != 0 || fsync(fileno(out)) != 0) {
+		fprintf(stderr, "Cannot write %s: %m\n", tmp_path);
+		fclose(out);
+		unlink(tmp_path);
+		sigtable_close(tab);
+		return 1;
+	}
+
+	fclose(out);
+	sigtable_close(tab);
+
+	if (rename(tmp_path, path) != 0) {
+		fprintf(stderr, "Cannot rename %s to %s: %m\n", tmp_path, path);
+		unlink(tmp_path);
+		return 1;
+	}
+
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	char tmp_path[MAX_PATH];
+	FILE *in;
+	int fd, sret;
+
+	if (argc == 3 && 0 == strcmp(argv[1], "--verify")) {
+		return verify_image(argv[2]);
+	}
+
+	if (argc != 3 && !(argc == 4 && 0 == strcmp(argv[1], "--header"))) {
+		printf("Usage: %s data_base image\n       %s --verify image\n"
+			"       %s --header data_base header\n", argv[0], argv[0], argv[0]);
+		return 0;
+	}
+
+	sret = snprintf(tmp_path, sizeof(tmp_path), "%s.tmp", argv[argc - 1]);
+	if (sret <= 0 || sret >= (int)sizeof(tmp_path)) {
+		fprintf(stderr, "Output path too long\n");
+		return 1;
+	}
+
+	if (argc == 4) {
+		return write_header(argv[2], argv[3], tmp_path);
+	}
+
+	if ((in = datafile_open(argv[1])) == NULL) {
+		fprintf(stderr, "Cannot open input file: %m\n");
+		return 1;
+	}
+
+	/* Write to a temporary file and rename it so readers never see a partial image */
+	if ((fd = open(tmp_path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+		fprintf(stderr, "Cannot create %s: %m\n", tmp_path);
+		fclose(in);
+		return 1;
+	}
+
+	if (sigimage_compile(in, fd) != 0 || fsync(fd) != 0) {
+		fprintf(stderr, "Cannot compile %s: %m\n", argv[1]);
+		close(fd);
+		unlink(tmp_path);
+		fclose(in);
+		return 1;
+	}
+
+	close(fd);
+	fclose(in);
+
+	if (rename(tmp_path, argv[2]) != 0) {
+		fprintf(stderr, "Cannot rename %s to %s: %m\n", tmp_path, argv[2]);
+		unlink(tmp_path);
+		return 1;
+	}
+
+	return 0;
+}
@@ -0,0 +1,174 @@
+/* Generated by intexer-compile --header from data.txt, do not edit.
+
+   Include after better-intexer.c, compile as C++17. */
+
+#ifndef INTEXER_DATA_H
+#define INTEXER_DATA_H
+
+#include <string_view>
+
+static constexpr char sigembed_source[] = "data.txt";
+
+/* Name, a space and the description of every record, one per line */
+static constexpr char sigembed_arena[] =
+	"HUP Hangup\015\n"
+	"INT Interrupt\015\n"
+	"QUIT Quit\015\n"
+	"ILL Illegal instruction\015\n"
+	"TRAP Trace trap\015\n"
+	"ABRT Abort    \015\n"
+	"EMT EMT trap  \015\n"
+	"FPE Floating point exception\015\n"
+	"KILL Killed \015\n"
+	"BUS Bus error\015\n"
+	"SEGV Memory fault                                      \015\n"
+	"SYS Bad system call                              \015\n"
+	"PIPE Broken pipe                       \015\n"
+	"ALRM Alarm clock   \015\n"
+	"TERM Terminated  \015\n"
+	"URG Urgent I/O condition   \015\n"
+	"STOP Stopped (signal)     \015\n"
+	"TSTP Stopped     \015\n"
+	"CONT Continued  \015\n"
+	"CHLD Child exited \015\n"
+	"TTIN Stopped (tty input) \015\n"
+	"TTOU Stopped (tty output) \015\n"
+	"IO I/O possible          \015\n"
+	"XCPU CPU time limit exceeded                                               \015\n"
+	"XFSZ File size limit exceeded                       \015\n"
+	"VTALRM Virtual timer expired                        \015\n"
+	"PROF Profiling timer expired                                 \015\n"
+	"WINCH Window size change                                    \015\n"
+	"INFO Information request                 \015\n"
+	"USR1 User defined signal 1                                \015\n"
+	"USR2 User defined signal 2                               \015\n";
+
+/* off, signum, name_len, desc_len */
+static constexpr struct sighot sigembed_hot[] = {
+	{ 0, 1, 3, 7, 0 },
+	{ 12, 2, 3, 10, 0 },
+	{ 27, 3, 4, 5, 0 },
+	{ 38, 4, 3, 20, 0 },
+	{ 63, 5, 4, 11, 0 },
+	{ 80, 6, 4, 10, 0 },
+	{ 96, 7, 3, 11, 0 },
+	{ 112, 8, 3, 25, 0 },
+	{ 142, 9, 4, 8, 0 },
+	{ 156, 10, 3, 10, 0 },
+	{ 171, 11, 4, 51, 0 },
+	{ 228, 12, 3, 46, 0 },
+	{ 279, 13, 4, 35, 0 },
+	{ 320, 14, 4, 15, 0 },
+	{ 341, 15, 4, 13, 0 },
+	{ 360, 16, 3, 24, 0 },
+	{ 389, 17, 4, 22, 0 },
+	{ 417, 18, 4, 13, 0 },
+	{ 436, 19, 4, 12, 0 },
+	{ 454, 20, 4, 14, 0 },
+	{ 474, 21, 4, 21, 0 },
+	{ 501, 22, 4, 22, 0 },
+	{ 529, 23, 2, 23, 0 },
+	{ 556, 24, 4, 71, 0 },
+	{ 633, 25, 4, 48, 0 },
+	{ 687, 26, 6, 46, 0 },
+	{ 741, 27, 4, 57, 0 },
+	{ 804, 28, 5, 55, 0 },
+	{ 866, 29, 4, 37, 0 },
+	{ 909, 30, 4, 54, 0 },
+	{ 969, 31, 4, 53, 0 },
+};
+
+static constexpr size_t sigembed_size = 31;
+
+/** \brief A record of sigembed_hot by its name_key(). */
+struct sigembed_name {
+	uint64_t key;
+	uint32_t rec;
+};
+
+/** \brief A run of sigembed_names, empty if \p begin == \p end. */
+struct sigembed_range {
+	size_t begin;
+	size_t end;
+};
+
+/* Every record by name_key(), records sharing a name in database order */
+static constexpr struct sigembed_name sigembed_names[] = {
+	{ UINT64_C(0x0041425254000004), 5 },
+	{ UINT64_C(0x00414c524d000004), 13 },
+	{ UINT64_C(0x0042555300000003), 9 },
+	{ UINT64_C(0x0043484c44000004), 19 },
+	{ UINT64_C(0x00434f4e54000004), 18 },
+	{ UINT64_C(0x00454d5400000003), 6 },
+	{ UINT64_C(0x0046504500000003), 7 },
+	{ UINT64_C(0x0048555000000003), 0 },
+	{ UINT64_C(0x00494c4c00000003), 3 },
+	{ UINT64_C(0x00494e464f000004), 28 },
+	{ UINT64_C(0x00494e5400000003), 1 },
+	{ UINT64_C(0x00494f0000000002), 22 },
+	{ UINT64_C(0x004b494c4c000004), 8 },
+	{ UINT64_C(0x0050495045000004), 12 },
+	{ UINT64_C(0x0050524f46000004), 26 },
+	{ UINT64_C(0x0051554954000004), 2 },
+	{ UINT64_C(0x0053454756000004), 10 },
+	{ UINT64_C(0x0053544f50000004), 16 },
+	{ UINT64_C(0x0053595300000003), 11 },
+	{ UINT64_C(0x005445524d000004), 14 },
+	{ UINT64_C(0x0054524150000004), 4 },
+	{ UINT64_C(0x0054535450000004), 17 },
+	{ UINT64_C(0x005454494e000004), 20 },
+	{ UINT64_C(0x0054544f55000004), 21 },
+	{ UINT64_C(0x0055524700000003), 15 },
+	{ UINT64_C(0x0055535231000004), 29 },
+	{ UINT64_C(0x0055535232000004), 30 },
+	{ UINT64_C(0x005654414c524d06), 25 },
+	{ UINT64_C(0x0057494e43480005), 27 },
+	{ UINT64_C(0x0058435055000004), 23 },
+	{ UINT64_C(0x005846535a000004), 24 },
+};
+
+/** \brief name_key() for use in constant expressions. */
+constexpr uint64_t sigembed_key( std::string_view name )
+{
+	uint64_t key = 0;
+
+	for( size_t i = 0; i < SIGNAME_MAX; i++ )
+	{
+		unsigned char c = i < name.size() ? (unsigned char)name[i] : 0;
+		key = key << 8 | (c >= 'a' && c <= 'z' ? c - 'a' + 'A' : c);
+	}
+	return key << 8 | name.size();
+}
+
+/** \brief Looks up the records named \p name ignoring case, like sigtable_find_name(). */
+constexpr struct sigembed_range sigembed_find( std::string_view name )
+{
+	size_t lo = 0, hi = sizeof(sigembed_names) / sizeof(sigembed_names[0]), end = 0;
+	uint64_t key = sigembed_key(name);
+
+	if( name.empty() || name.size() > SIGNAME_MAX ) return { 0, 0 };
+	for( size_t i = 0; i < name.size(); i++ )
+	{
+		if( name[i] == ' ' || name[i] == '\0' || (name[i] >= '\t' && name[i] <= '\r') ) return { 0, 0 };
+	}
+
+	while( lo < hi )
+	{
+		size_t mid = lo + (hi - lo) / 2;
+		if( sigembed_names[mid].key < key ) lo = mid + 1;
+		else hi = mid;
+	}
+	for( end = lo; end < sizeof(sigembed_names) / sizeof(sigembed_names[0]) && sigembed_names[end].key == key; end++ );
+	return { lo, end };
+}
+
+/** \brief Record \p idx as sigtable_get() returns it, \p idx must be in range. */
+constexpr struct sigview sigembed_get( size_t idx )
+{
+	const struct sighot &hot = sigembed_hot[idx];
+
+	return { sigembed_arena + hot.off, sigembed_arena + hot.off + hot.name_len + 1,
+		hot.signum, hot.name_len, hot.desc_len, {} };
+}
+
+#endif /* INTEXER_DATA_H */
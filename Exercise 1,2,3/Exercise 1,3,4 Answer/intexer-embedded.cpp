@@ -0,0 +1,75 @@
+/** \file intexer with its database compiled in
+
+    Usage: intexer-embedded [--batch] [data_base]
+
+    Build:  intexer-compile --header data.txt intexer-data.h
+            g++ -std=c++17 -O2 -o intexer-embedded intexer-embedded.cpp -pthread
+
+    The records of intexer-data.h are served as they are, without opening or parsing
+    a file. A data_base argument, or DATA_PATH with the database the header was made
+    from, loads that file at run time instead, as intexer does.
+*/
+
+#include "intexer-sigdb.hpp"
+
+#include "intexer-data.h"
+
+/* Checks the generated tables against each other, at compile time */
+static constexpr bool sigembed_consistent( void )
+{
+	for( size_t i = 0; i < sigembed_size; i++ )
+	{
+		struct sigview view = sigembed_get(i);
+		struct sigembed_range range = sigembed_find(std::string_view(view.name, view.name_len));
+		bool found = false;
+
+		for( size_t k = range.begin; k < range.end; k++ ) found |= sigembed_names[k].rec == i;
+		if( !found || view.desc[view.desc_len] != '\n' ) return false;
+	}
+	return sizeof(sigembed_names) / sizeof(sigembed_names[0]) == sigembed_size;
+}
+
+static_assert(sigembed_size > 0 && sigembed_consistent(), "intexer-data.h is inconsistent, regenerate it");
+
+static void usage( const char *prog )
+{
+	printf("Usage: %s [--batch] [data_base]\n", prog);
+}
+
+int main(int argc, char* argv[]) {
+	const char *db_arg = NULL, *data_path = getenv("DATA_PATH");
+	bool batch = false;
+	std::unique_ptr<SigDb> db;
+	int i, ret;
+
+	for (i = 1; i < argc; i++) {
+		if (0 == strcmp(argv[i], "--batch")) {
+			batch = true;
+		} else if (db_arg == NULL && argv[i][0] != '-') {
+			db_arg = argv[i];
+		} else {
+			usage(argv[0]);
+			return 0;
+		}
+	}
+
+	/* DATA_PATH asks for the file the compiled in table was made from */
+	if (db_arg == NULL && data_path != NULL && data_path[0] != '\0') {
+		db_arg = sigembed_source;
+	}
+
+	db = db_arg ? SigDb::open(db_arg)
+		: SigDb::attach(sigembed_hot, sigembed_size, sigembed_arena, sizeof(sigembed_arena) - 1);
+	if (db == nullptr) {
+		printf("Cannot open input file: %m\n");
+		return 1;
+	}
+
+	/* Loop until 'q' and print out signal information */
+	ret = batch ? run_batch(db->table(), STDIN_FILENO, STDOUT_FILENO)
+		: run_interactive(db->table(), stdin, STDOUT_FILENO);
+	if (ret != 0) {
+		fprintf(stderr, "Cannot answer queries: %m\n");
+	}
+	return ret != 0;
+}
@@ -0,0 +1,343 @@
+/** \file Header, library and main program for generating synthetic intexer databases
+
+    Usage: intexer-gen [-n records] [-s seed] [-N min-max] [-D min-max] [-l uniform|short]
+                       [-S dense|sparse] [-r] [-m rate] [-o file]
+
+    The output only depends on the options, the same seed always gives the same bytes.
+    Descriptions are made of words from a vocabulary of signal terms, names of capital
+    letters and digits. -l short makes short names and descriptions more likely than
+    long ones, -S sparse draws signal numbers at random instead of counting up, -r ends
+    lines with CRLF and -m breaks the given fraction of lines in one of several ways.
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <stdbool.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/** \file intexer-gen.h */
+
+#ifndef INTEXER_GEN_H
+#define INTEXER_GEN_H
+
+/** \brief What siggen_write() generates. */
+struct siggen_opts {
+	uint64_t count;
+	uint64_t seed;
+	unsigned name_min;
+	unsigned name_max;
+	unsigned desc_min;
+	unsigned desc_max;
+	bool short_bias;
+	bool sparse;
+	bool crlf;
+	double malformed;
+};
+
+void siggen_defaults( struct siggen_opts *opts );
+int siggen_write( int fd, const struct siggen_opts *opts, uint64_t *malformed );
+
+#endif /* end file intexer-gen.h */
+
+/* Longest name and description a valid record can have */
+#define SIGGEN_NAME_MAX 6
+#define SIGGEN_DESC_MAX 99
+
+static const char *const siggen_words[] = {
+	"hangup", "detected", "on", "controlling", "terminal", "or", "death", "of", "process",
+	"interrupt", "from", "keyboard", "quit", "illegal", "instruction", "trace", "breakpoint",
+	"trap", "abort", "signal", "bus", "error", "bad", "memory", "access", "floating", "point",
+	"exception", "kill", "user", "defined", "invalid", "reference", "broken", "pipe", "write",
+	"to", "with", "no", "readers", "timer", "alarm", "termination", "child", "stopped",
+	"terminated", "continue", "if", "stop", "typed", "at", "input", "for", "background",
+	"output", "urgent", "condition", "socket", "cpu", "time", "limit", "exceeded", "file",
+	"size", "virtual", "clock", "profiling", "window", "resize", "now", "possible", "power",
+	"failure", "system", "call", "argument", "routine"
+};
+
+/** \brief Sets the defaults: 1000 records of any valid length, dense numbers, LF, all valid. */
+void siggen_defaults( struct siggen_opts *opts )
+{
+	memset(opts, 0, sizeof(*opts));
+	opts->count = 1000;
+	opts->seed = 1;
+	opts->name_min = 1;
+	opts->name_max = SIGGEN_NAME_MAX;
+	opts->desc_min = 0;
+	opts->desc_max = SIGGEN_DESC_MAX;
+}
+
+/** \brief splitmix64, small and fast, with a full 64-bit period. */
+static uint64_t siggen_next( uint64_t *state )
+{
+	uint64_t z = (*state += UINT64_C(0x9e3779b97f4a7c15));
+
+	z = (z ^ (z >> 30)) * UINT64_C(0xbf58476d1ce4e5b9);
+	z = (z ^ (z >> 27)) * UINT64_C(0x94d049bb133111eb);
+	return z ^ (z >> 31);
+}
+
+/** \brief A length in [min, max], biased toward min if \p short_bias. */
+static unsigned siggen_len( uint64_t *state, unsigned min, unsigned max, bool short_bias )
+{
+	uint64_t span = (uint64_t)(max - min) + 1;
+	uint64_t r = siggen_next(state);
+
+	if( short_bias )
+	{
+		/* the smaller of two draws, so short lengths are the most common */
+		uint64_t other = siggen_next(state);
+		if( other < r ) r = other;
+		return min + (unsigned)((r >> 32) * span >> 32);
+	}
+	return min + (unsigned)(r % span);
+}
+
+/** \brief Output collected into large writes. */
+struct siggen_buf {
+	int fd;
+	size_t used;
+	char data[1 << 20];
+};
+
+static int siggen_flush( struct siggen_buf *buf )
+{
+	size_t done = 0;
+
+	while( done < buf->used )
+	{
+		ssize_t n = write(buf->fd, buf->data + done, buf->used - done);
+		if( n < 0 )
+		{
+			if( errno == EINTR ) continue;
+			return -1;
+		}
+		done += (size_t)n;
+	}
+
+	buf->used = 0;
+	return 0;
+}
+
+static char *siggen_number( char *pos, uint64_t value )
+{
+	char digits[24];
+	size_t n = 0;
+
+	do
+	{
+		digits[n++] = (char)('0' + value % 10);
+		value /= 10;
+	} while( value > 0 );
+	while( n > 0 ) *pos++ = digits[--n];
+	return pos;
+}
+
+static char *siggen_name( char *pos, uint64_t *state, unsigned len )
+{
+	static const char chars[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789";
+	unsigned i;
+
+	for( i = 0; i < len; i++ ) *pos++ = chars[siggen_next(state) % (sizeof(chars) - 1)];
+	return pos;
+}
+
+/** \brief Writes \p len characters of words separated by single spaces. */
+static char *siggen_desc( char *pos, uint64_t *state, unsigned len )
+{
+	const size_t nwords = sizeof(siggen_words) / sizeof(siggen_words[0]);
+	char *end = pos + len;
+
+	while( pos < end )
+	{
+		/* the smaller of two draws makes the words at the front more common */
+		uint64_t a = siggen_next(state) % nwords, b = siggen_next(state) % nwords;
+		const char *word = siggen_words[a < b ? a : b];
+		size_t n = strlen(word);
+
+		if( n > (size_t)(end - pos) ) n = (size_t)(end - pos);
+		memcpy(pos, word, n);
+		pos += n;
+		if( pos < end ) *pos++ = ' ';
+	}
+	return end;
+}
+
+/** \brief Breaks a line in one of the ways read_records() must reject. */
+static char *siggen_malformed( char *pos, uint64_t *state, uint64_t signum )
+{
+	switch( siggen_next(state) % 5 )
+	{
+	case 0: /* name too long */
+		pos = siggen_number(pos, signum);
+		*pos++ = ' ';
+		pos = siggen_name(pos, state, SIGGEN_NAME_MAX + 1 + (unsigned)(siggen_next(state) % 4));
+		*pos++ = ' ';
+		return siggen_desc(pos, state, 10);
+	case 1: /* no description separator */
+		pos = siggen_number(pos, signum);
+		*pos++ = ' ';
+		return siggen_name(pos, state, 3);
+	case 2: /* number out of range */
+		pos = siggen_number(pos, 65536 + siggen_next(state) % 100000);
+		*pos++ = ' ';
+		pos = siggen_name(pos, state, 3);
+		*pos++ = ' ';
+		return siggen_desc(pos, state, 10);
+	case 3: /* not a number */
+		*pos++ = 'x';
+		*pos++ = ' ';
+		pos = siggen_name(pos, state, 3);
+		*pos++ = ' ';
+		return siggen_desc(pos, state, 10);
+	default: /* longer than a line may be, the rest would be read as the next record */
+		pos = siggen_number(pos, signum);
+		*pos++ = ' ';
+		pos = siggen_name(pos, state, 3);
+		*pos++ = ' ';
+		return siggen_desc(pos, state, 120);
+	}
+}
+
+/** \brief Writes a database as described by \p opts to \p fd.
+
+    The number of lines broken on purpose is stored in \p *malformed if not NULL.
+
+    \returns 0 on success, -1 with errno set on error. errno is EINVAL for options
+             that cannot make valid records.
+*/
+int siggen_write( int fd, const struct siggen_opts *opts, uint64_t *malformed )
+{
+	struct siggen_buf *buf;
+	uint64_t state = opts->seed, broken = 0, i;
+	uint64_t threshold = (uint64_t)(opts->malformed * 18446744073709551615.0);
+	char *pos;
+	int ret = 0;
+
+	if( opts->count == 0 || opts->name_min == 0 || opts->name_min > opts->name_max
+		|| opts->name_max > SIGGEN_NAME_MAX || opts->desc_min > opts->desc_max
+		|| opts->desc_max > SIGGEN_DESC_MAX || !(opts->malformed >= 0.0 && opts->malformed <= 1.0) )
+	{
+		errno = EINVAL;
+		return -1;
+	}
+	if( opts->malformed >= 1.0 ) threshold = UINT64_MAX;
+
+	buf = (struct siggen_buf *) malloc(sizeof(*buf));
+	if( buf == NULL ) return -1;
+	buf->fd = fd;
+
+	pos = siggen_number(buf->data, opts->count);
+	if( opts->crlf ) *pos++ = '\r';
+	*pos++ = '\n';
+	buf->used = (size_t)(pos - buf->data);
+
+	for( i = 0; i < opts->count; i++ )
+	{
+		uint64_t signum = opts->sparse ? siggen_next(&state) % 65536 : i % 65536;
+
+		/* room for the longest line, broken ones included */
+		if( sizeof(buf->data) - buf->used < 256 && siggen_flush(buf) != 0 )
+		{
+			ret = -1;
+			break;
+		}
+		pos = buf->data + buf->used;
+
+		if( threshold != 0 && siggen_next(&state) <= threshold )
+		{
+			pos = siggen_malformed(pos, &state, signum);
+			broken++;
+		}
+		else
+		{
+			pos = siggen_number(pos, signum);
+			*pos++ = ' ';
+			pos = siggen_name(pos, &state, siggen_len(&state, opts->name_min, opts->name_max, opts->short_bias));
+			*pos++ = ' ';
+			pos = siggen_desc(pos, &state, siggen_len(&state, opts->desc_min, opts->desc_max, opts->short_bias));
+		}
+
+		if( opts->crlf ) *pos++ = '\r';
+		*pos++ = '\n';
+		buf->used = (size_t)(pos - buf->data);
+	}
+
+	if( ret == 0 ) ret = siggen_flush(buf);
+	free(buf);
+	if( malformed ) *malformed = broken;
+	return ret;
+}
+
+#ifndef TEST
+static int parse_range( const char *arg, unsigned *min, unsigned *max )
+{
+	char *end;
+	unsigned long lo = strtoul(arg, &end, 10), hi = lo;
+
+	if( end == arg ) return -1;
+	if( *end == '-' )
+	{
+		const char *start = end + 1;
+		hi = strtoul(start, &end, 10);
+		if( end == start ) return -1;
+	}
+	if( *end != '\0' || lo > hi || hi > 1000 ) return -1;
+
+	*min = (unsigned)lo;
+	*max = (unsigned)hi;
+	return 0;
+}
+
+int main(int argc, char* argv[]) {
+	struct siggen_opts opts;
+	const char *out_path = NULL;
+	uint64_t broken;
+	int opt, fd = STDOUT_FILENO, bad = 0;
+
+	siggen_defaults(&opts);
+
+	while ((opt = getopt(argc, argv, "n:s:N:D:l:S:rm:o:")) != -1) {
+		switch (opt) {
+		case 'n': opts.count = strtoull(optarg, NULL, 10); break;
+		case 's': opts.seed = strtoull(optarg, NULL, 10); break;
+		case 'N': bad |= parse_range(optarg, &opts.name_min, &opts.name_max); break;
+		case 'D': bad |= parse_range(optarg, &opts.desc_min, &opts.desc_max); break;
+		case 'l': opts.short_bias = 0 == strcmp(optarg, "short"); bad |= !opts.short_bias && 0 != strcmp(optarg, "uniform"); break;
+		case 'S': opts.sparse = 0 == strcmp(optarg, "sparse"); bad |= !opts.sparse && 0 != strcmp(optarg, "dense"); break;
+		case 'r': opts.crlf = true; break;
+		case 'm': opts.malformed = strtod(optarg, NULL); break;
+		case 'o': out_path = optarg; break;
+		default: bad = 1; break;
+		}
+	}
+
+	if (bad || optind != argc) {
+		printf("Usage: %s [-n records] [-s seed] [-N min-max] [-D min-max] [-l uniform|short]\n"
+			"       [-S dense|sparse] [-r] [-m rate] [-o file]\n", argv[0]);
+		return 0;
+	}
+
+	if (out_path && (fd = open(out_path, O_WRONLY | O_CREAT | O_TRUNC, 0644)) < 0) {
+		fprintf(stderr, "Cannot create %s: %m\n", out_path);
+		return 1;
+	}
+
+	if (siggen_write(fd, &opts, &broken) != 0) {
+		fprintf(stderr, "Cannot generate: %m\n");
+		return 1;
+	}
+
+	if (out_path && close(fd) != 0) {
+		fprintf(stderr, "Cannot write %s: %m\n", out_path);
+		return 1;
+	}
+
+	if (broken > 0) fprintf(stderr, "%llu malformed lines\n", (unsigned long long)broken);
+	return 0;
+}
+#endif
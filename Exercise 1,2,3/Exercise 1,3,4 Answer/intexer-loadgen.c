@@ -0,0 +1,147 @@
+/** \file Load generator for an intexer server
+
+    Usage: intexer-loadgen [-c clients] [-n requests] [-r range] socket
+
+    Every client thread opens its own connection and sends \p requests random index
+    queries in [0, range), one at a time. Latencies of the answered queries are
+    reported as percentiles.
+*/
+
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "intexer-client.c"
+
+struct loadgen_worker {
+	pthread_t thread;
+	const char *path;
+	size_t requests;
+	size_t range;
+	unsigned seed;
+	size_t errors;
+	/* answered queries, their latencies are the first done of latency_ns */
+	size_t done;
+	uint64_t *latency_ns;
+	/* errno of opening the connection, 0 if it was opened */
+	int open_err;
+};
+
+static uint64_t now_ns( void )
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (uint64_t)ts.tv_sec * 1000000000u + (uint64_t)ts.tv_nsec;
+}
+
+static void *loadgen_run( void *arg )
+{
+	struct loadgen_worker *w = (struct loadgen_worker *)arg;
+	struct intexer_client *cl = intexer_client_open(w->path);
+	char query[32], resp[4096];
+	size_t i;
+
+	if( cl == NULL )
+	{
+		w->open_err = errno;
+		w->errors = w->requests;
+		return NULL;
+	}
+
+	for( i = 0; i < w->requests; i++ )
+	{
+		uint64_t start;
+
+		snprintf(query, sizeof(query), "%zu", (size_t)rand_r(&w->seed) % w->range);
+		start = now_ns();
+		if( intexer_client_query(cl, query, resp, sizeof(resp)) < 0 ) w->errors++;
+		else w->latency_ns[w->done++] = now_ns() - start;
+	}
+
+	intexer_client_close(cl);
+	return NULL;
+}
+
+static int cmp_u64( const void *lhs, const void *rhs )
+{
+	uint64_t a = *(const uint64_t *)lhs, b = *(const uint64_t *)rhs;
+	return a < b ? -1 : a > b;
+}
+
+static uint64_t percentile( const uint64_t *sorted, size_t n, double p )
+{
+	size_t idx = (size_t)(p * (double)(n - 1) + 0.5);
+	return sorted[idx];
+}
+
+int main(int argc, char* argv[]) {
+	struct loadgen_worker *workers;
+	uint64_t *latency, start, elapsed;
+	size_t clients = 8, requests = 10000, range = 31, errors = 0, done = 0, total, i;
+	int opt;
+
+	while ((opt = getopt(argc, argv, "c:n:r:")) != -1) {
+		switch (opt) {
+		case 'c': clients = strtoul(optarg, NULL, 10); break;
+		case 'n': requests = strtoul(optarg, NULL, 10); break;
+		case 'r': range = strtoul(optarg, NULL, 10); break;
+		default: optind = argc + 1; break;
+		}
+	}
+
+	if (optind != argc - 1 || clients == 0 || requests == 0 || range == 0
+		|| requests > SIZE_MAX / sizeof(uint64_t) / clients) {
+		printf("Usage: %s [-c clients] [-n requests] [-r range] socket\n", argv[0]);
+		return 0;
+	}
+
+	total = clients * requests;
+	workers = (struct loadgen_worker *) calloc(clients, sizeof(workers[0]));
+	latency = (uint64_t *) malloc(total * sizeof(latency[0]));
+	if (workers == NULL || latency == NULL) {
+		fprintf(stderr, "Cannot allocate memory: %m\n");
+		return 1;
+	}
+
+	start = now_ns();
+	for (i = 0; i < clients; i++) {
+		workers[i].path = argv[optind];
+		workers[i].requests = requests;
+		workers[i].range = range;
+		workers[i].seed = (unsigned)i + 1;
+		workers[i].latency_ns = latency + i * requests;
+		if (pthread_create(&workers[i].thread, NULL, loadgen_run, &workers[i]) != 0) {
+			fprintf(stderr, "Cannot start client thread\n");
+			return 1;
+		}
+	}
+	for (i = 0; i < clients; i++) {
+		pthread_join(workers[i].thread, NULL);
+		errors += workers[i].errors;
+		if (workers[i].open_err != 0) {
+			fprintf(stderr, "Client %zu cannot connect to %s: %s\n", i, argv[optind], strerror(workers[i].open_err));
+		}
+		/* only answered queries have a latency, gather them at the front */
+		memmove(latency + done, workers[i].latency_ns, workers[i].done * sizeof(latency[0]));
+		done += workers[i].done;
+	}
+	elapsed = now_ns() - start;
+
+	printf("clients:    %zu\n", clients);
+	printf("requests:   %zu (%zu errors)\n", total, errors);
+	printf("throughput: %.0f requests/s\n", (double)done * 1e9 / (double)elapsed);
+	if (done > 0) {
+		qsort(latency, done, sizeof(latency[0]), cmp_u64);
+		printf("p50:        %.1f us\n", (double)percentile(latency, done, 0.50) / 1e3);
+		printf("p99:        %.1f us\n", (double)percentile(latency, done, 0.99) / 1e3);
+		printf("p99.9:      %.1f us\n", (double)percentile(latency, done, 0.999) / 1e3);
+		printf("max:        %.1f us\n", (double)latency[done - 1] / 1e3);
+	} else {
+		printf("latency:    no query was answered\n");
+	}
+
+	free(latency);
+	free(workers);
+	return errors != 0;
+}
@@ -0,0 +1,222 @@
+/** \file C++ interface to the intexer library
+
+    Include this instead of better-intexer.c, or after it, in one translation unit:
+
+            #include "intexer-sigdb.hpp"
+
+            auto db = SigDb::open("data.txt");
+            for( const SigDb::Record &rec : db->find("SIGINT") ) ...
+
+    Needs C++17 for std::string_view. A SigDb is fully indexed when it is made and
+    never changes afterwards, so any number of threads can look records up at the
+    same time, without locks or any writes to shared memory. Records are views into
+    the table, they stay valid as long as the SigDb.
+*/
+
+#ifndef INTEXER_SIGDB_HPP
+#define INTEXER_SIGDB_HPP
+
+#include <cstring>
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#ifndef INTEXER_H
+extern "C"
+{
+/* The intexer library without its main() */
+#ifndef TEST
+#define TEST
+#endif
+#include "better-intexer.c"
+}
+#endif
+
+/** \brief A loaded and indexed signal database, safe to read from many threads. */
+class SigDb
+{
+public:
+	/** \brief A record, its strings point into the database. */
+	struct Record
+	{
+		size_t index;
+		unsigned short signum;
+		std::string_view name;
+		std::string_view desc;
+	};
+
+	/** \brief Iterates over records given by number, either all of them or those of a lookup. */
+	class Iterator
+	{
+	public:
+		using iterator_category = std::forward_iterator_tag;
+		using value_type = Record;
+		using difference_type = std::ptrdiff_t;
+		using pointer = const Record *;
+		using reference = Record;
+
+		Iterator( const SigDb *db, const uint32_t *recs, size_t pos ) : db_(db), recs_(recs), pos_(pos) {}
+
+		Record operator*() const { return db_->record(recs_ ? recs_[pos_] : pos_); }
+		Iterator &operator++() { ++pos_; return *this; }
+		Iterator operator++( int ) { Iterator old = *this; ++pos_; return old; }
+		bool operator==( const Iterator &other ) const { return pos_ == other.pos_; }
+		bool operator!=( const Iterator &other ) const { return pos_ != other.pos_; }
+
+	private:
+		const SigDb *db_;
+		const uint32_t *recs_;
+		size_t pos_;
+	};
+
+	/** \brief The records a lookup found, in database order. */
+	class Range
+	{
+	public:
+		Range( const SigDb *db, const uint32_t *recs, size_t n ) : db_(db), recs_(recs), n_(n) {}
+
+		Iterator begin() const { return Iterator(db_, recs_, 0); }
+		Iterator end() const { return Iterator(db_, recs_, n_); }
+		size_t size() const { return n_; }
+		bool empty() const { return n_ == 0; }
+		Record operator[]( size_t i ) const { return db_->record(recs_[i]); }
+
+	private:
+		const SigDb *db_;
+		const uint32_t *recs_;
+		size_t n_;
+	};
+
+	/** \brief Maps the database at \p path, resolved like sigtable_open().
+
+	    \returns The database, or nullptr with errno set on error.
+	*/
+	static std::unique_ptr<SigDb> open( const char *path )
+	{
+		return adopt(sigtable_open(path));
+	}
+
+	/** \brief Like open(), but reads the file into private memory, see sigtable_load(). */
+	static std::unique_ptr<SigDb> load( const char *path )
+	{
+		return adopt(sigtable_load(path));
+	}
+
+	/** \brief Copies and parses the text database or image in \p buf, see sigtable_parse(). */
+	static std::unique_ptr<SigDb> parse( std::string_view buf )
+	{
+		return adopt(sigtable_parse(buf.data(), buf.size()));
+	}
+
+	/** \brief Serves records the caller owns, see sigtable_attach(). */
+	static std::unique_ptr<SigDb> attach( const struct sighot *hot, size_t size, const char *arena, size_t arena_len )
+	{
+		return adopt(sigtable_attach(hot, size, arena, arena_len));
+	}
+
+	/** \brief Takes over \p tab, which is indexed and checked first.
+
+	    Every record is bounds checked once here, so lookups cannot fail later. The
+	    strings of a packed table only exist decoded, those of such a table are
+	    decoded here into memory the SigDb keeps, with their exact lengths. A table
+	    opened with a memory budget cannot be shared and is refused with ENOTSUP.
+
+	    \returns The database, or nullptr with errno set on error, \p tab is closed then.
+	*/
+	static std::unique_ptr<SigDb> adopt( struct sigtable *tab )
+	{
+		std::unique_ptr<SigDb> db;
+		struct sigview view;
+		int err = ENOTSUP;
+
+		if( tab == NULL ) return nullptr;
+		if( tab->pager != NULL || sigtable_index(tab) != 0 ) goto fail;
+		db.reset(new SigDb(tab));
+		for( size_t i = 0; i < tab->size; i++ )
+		{
+			if( sigtable_get(tab, i, &view) == NULL )
+			{
+				err = errno;
+				db.reset();
+				errno = err;
+				return nullptr;
+			}
+			if( tab->pack != NULL )
+			{
+				db->decoded_off_.push_back(db->decoded_.size());
+				db->decoded_.append(view.name, (size_t)view.name_len + 1 + view.desc_len);
+			}
+		}
+		return db;
+
+	fail:
+		if( tab->pager == NULL ) err = errno;
+		sigtable_close(tab);
+		errno = err;
+		return nullptr;
+	}
+
+	~SigDb() { sigtable_close(tab_); }
+	SigDb( const SigDb & ) = delete;
+	SigDb &operator=( const SigDb & ) = delete;
+
+	size_t size() const { return tab_->size; }
+	Iterator begin() const { return Iterator(this, nullptr, 0); }
+	Iterator end() const { return Iterator(this, nullptr, tab_->size); }
+
+	/** \brief The record at \p index, which must be below size(). */
+	Record operator[]( size_t index ) const { return record(index); }
+
+	/** \brief The records numbered \p signum. */
+	Range find( unsigned signum ) const
+	{
+		const uint32_t *recs = nullptr;
+		size_t n = sigtable_find_signum(tab_, signum, &recs);
+
+		return Range(this, recs, n);
+	}
+
+	/** \brief The records named \p name, ignoring case. */
+	Range find( std::string_view name ) const
+	{
+		const uint32_t *recs = nullptr;
+		size_t n = sigtable_find_name(tab_, name.data(), name.size(), &recs);
+
+		return Range(this, recs, n);
+	}
+
+	/** \brief The records whose name starts with \p prefix, ignoring case, ordered by name. */
+	Range find_prefix( std::string_view prefix ) const
+	{
+		const uint32_t *recs = nullptr;
+		size_t n = sigtable_find_prefix(tab_, prefix.data(), prefix.size(), &recs);
+
+		return Range(this, recs, n);
+	}
+
+	/** \brief The table, for the C functions such as run_batch(). It must not be closed. */
+	struct sigtable *table() const { return tab_; }
+
+private:
+	explicit SigDb( struct sigtable *tab ) : tab_(tab) {}
+
+	/* The name is at off in the arena, or in decoded_ for a packed table, and the
+	   description one byte after it */
+	Record record( size_t index ) const
+	{
+		const struct sighot &hot = tab_->hot[index];
+		const char *name = tab_->pack != NULL ? decoded_.data() + decoded_off_[index] : tab_->arena + hot.off;
+
+		return Record{ index, hot.signum, std::string_view(name, hot.name_len),
+			std::string_view(name + hot.name_len + 1, hot.desc_len) };
+	}
+
+	struct sigtable *tab_;
+	/* the strings of a packed table as they are in an arena, and where each record starts */
+	std::string decoded_;
+	std::vector<size_t> decoded_off_;
+};
+
+#endif /* INTEXER_SIGDB_HPP */